@@ -0,0 +1,79 @@
+/**
+ * @file examples/core/metrics.c
+ * @brief Driver for lock-free histograms: concurrent recording, percentiles and dumps.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#include "core/metrics.h"
+
+#define N_THREADS 8
+#define N_VALUES 1000000
+
+static Histogram* latency;
+
+// Every thread records 1..N_VALUES once
+static void* record(void* arg) {
+    (void) arg;
+    for (uint64_t i = 1; i <= N_VALUES; i++) {
+        histogram_record(latency, i);
+    }
+    return NULL;
+}
+
+int main(void) {
+    latency = metrics_histogram(&metrics_global, "latency_us", "us");
+    Histogram* same = metrics_histogram(&metrics_global, "latency_us", "us");
+    assert(latency && latency == same);
+    assert(metrics_find(&metrics_global, "latency_us") == latency);
+
+    // Bucket boundaries: exact below 16, then 16 sub-buckets per power of two
+    assert(histogram_bucket(15) == 15);
+    assert(histogram_bucket(16) == 16);
+    assert(histogram_bucket(32) == histogram_bucket(33));
+    assert(histogram_bucket(UINT64_MAX) == HISTOGRAM_BUCKETS - 1);
+
+    pthread_t threads[N_THREADS];
+    uint64_t start = metrics_now_ns();
+    for (int i = 0; i < N_THREADS; i++) {
+        pthread_create(&threads[i], NULL, record, NULL);
+    }
+    for (int i = 0; i < N_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    uint64_t elapsed = metrics_now_ns() - start;
+
+    HistogramSnapshot s = histogram_snapshot(latency);
+    assert(s.count == (uint64_t) N_THREADS * N_VALUES);
+    assert(s.min == 1 && s.max == N_VALUES);
+
+    // Percentiles of a uniform distribution, within the bucket resolution
+    double error = (s.p50 - N_VALUES / 2.0) / (N_VALUES / 2.0);
+    assert(error >= 0.0 && error < 1.0 / HISTOGRAM_SUB_COUNT);
+    error = (s.p99 - N_VALUES * 0.99) / (N_VALUES * 0.99);
+    assert(error >= 0.0 && error < 1.0 / HISTOGRAM_SUB_COUNT);
+
+    printf(
+        "%d threads recorded %llu values in %.1f ms (%.2f ns per record)\n",
+        N_THREADS,
+        (unsigned long long) s.count,
+        (double) elapsed / 1e6,
+        (double) elapsed / (double) s.count
+    );
+
+    Histogram* tps = metrics_histogram(&metrics_global, METRIC_DECODE_TOK_S, "tok/s");
+    histogram_record(tps, 120);
+    histogram_record(tps, 250);
+    histogram_record(tps, 180);
+
+    printf("\ntext:\n");
+    metrics_dump_text(&metrics_global, stdout);
+    printf("\njson:\n");
+    metrics_dump_json(&metrics_global, stdout);
+
+    metrics_reset(&metrics_global);
+    assert(histogram_snapshot(latency).count == 0);
+    return 0;
+}
@@ -0,0 +1,53 @@
+/**
+ * @file examples/model/beam.c
+ * @brief Beam search with shared prompt blocks and copy-on-write divergence.
+ * @copyright Copyright © 2025 Austin Berrio
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "core/logger.h"
+#include "linear/lehmer.h"
+#include "linear/type.h"
+#include "tokenizer/model.h"
+#include "model/valerie.h"
+#include "model/paged.h"
+#include "model/beam.h"
+
+int main(void) {
+    lehmer_init(1337);
+
+    Tokenizer t = tokenizer_load("models/tokenizer.model");
+    Params p = v_params_new(t.vocab_size);
+    Valerie v = v_model_new(t, p, TYPE_Q8);
+
+    int n_ids = 0;
+    int* ids = tokenizer_encode(&v.t, "The quick brown fox jumps over the lazy dog.", &n_ids, true, false);
+
+    const int width = 4;
+    BeamSearch bs = beam_new(&v, width, 24);
+    int best = beam_search(&bs, ids, n_ids);
+    if (best < 0) {
+        LOG_ERROR("Beam search failed.");
+        return EXIT_FAILURE;
+    }
+
+    for (int i = 0; i < bs.n_beams; i++) {
+        Beam* beam = &bs.beams[i];
+        char* text = tokenizer_decode(&v.t, beam->ids, beam->n);
+        printf("%c beam %d (% .3f): %s\n", i == best ? '*' : ' ', i, (double) beam->score,
+               text ? text : "");
+        free(text);
+    }
+
+    // Full copies would need width caches of (prompt + generated) positions
+    int full = width * ((n_ids + bs.max_tokens + KV_BLOCK_SIZE - 1) / KV_BLOCK_SIZE);
+    printf("blocks: peak %d, copy-on-write %d, full copies would use %d\n", bs.pool.peak,
+           bs.pool.copies, full);
+
+    beam_free(&bs);
+    free(ids);
+    v_model_free(&v);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,57 @@
+/**
+ * @file examples/model/chat.c
+ * @brief Multi-turn chat driver: each turn only prefills the new message.
+ * @copyright Copyright © 2025 Austin Berrio
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "core/logger.h"
+#include "linear/lehmer.h"
+#include "linear/type.h"
+#include "tokenizer/model.h"
+#include "model/valerie.h"
+#include "model/chat.h"
+
+bool print_token(int id, void* ctx) {
+    Tokenizer* t = ctx;
+    printf("%s", t->id_to_token[id]);
+    fflush(stdout);
+    return true;
+}
+
+int main(void) {
+    lehmer_init(1337);
+
+    Tokenizer t = tokenizer_load("models/tokenizer.model");
+    Params p = v_params_new(t.vocab_size);
+    Valerie v = v_model_new(t, p, TYPE_Q8);
+
+    Chat c = chat_new(&v);
+    if (!c.session.ids) {
+        v_model_free(&v);
+        return EXIT_FAILURE;
+    }
+    c.max_tokens = 16;
+    chat_add_stop(&c, "\n\n");
+    chat_push(&c, CHAT_ROLE_SYSTEM, "You are a helpful assistant.");
+
+    const char* turns[] = {"Hello!", "How are you?"};
+    for (size_t i = 0; i < sizeof(turns) / sizeof(turns[0]); i++) {
+        int start = c.session.pos;
+        printf("user: %s\nassistant: ", turns[i]);
+        int n = chat_reply(&c, CHAT_ROLE_USER, turns[i], print_token, &v.t);
+        printf("\n");
+        if (n < 0) {
+            LOG_ERROR("Context is full.");
+            break;
+        }
+        LOG_INFO("turn %zu: prefilled from pos %d, generated %d, pos=%d", i, start, n, c.session.pos);
+    }
+
+    chat_free(&c);
+    v_model_free(&v);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,130 @@
+/**
+ * @file examples/model/checkpoint.c
+ * @brief Save an f32 model, convert it to q8 and load both back.
+ * @copyright Copyright © 2025 Austin Berrio
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "core/logger.h"
+#include "core/metrics.h"
+#include "linear/lehmer.h"
+#include "linear/type.h"
+#include "tokenizer/model.h"
+#include "model/valerie.h"
+#include "model/blocks.h"
+#include "model/checkpoint.h"
+
+#define F32_PATH "models/valerie-f32.ckpt"
+#define Q8_PATH "models/valerie-q8.ckpt"
+#define N_TOKENS 8
+
+// Decode N_TOKENS positions, keep the last logits
+static void decode(Valerie* v, float* out) {
+    float* logits = NULL;
+    for (int pos = 0; pos < N_TOKENS; pos++) {
+        logits = forward(v, pos % v->dim.vocab_size, pos);
+    }
+    memcpy(out, logits, sizeof(float) * v->dim.vocab_size);
+}
+
+static float max_diff(const float* a, const float* b, int n) {
+    float diff = 0.0f;
+    for (int i = 0; i < n; i++) {
+        diff = fmaxf(diff, fabsf(a[i] - b[i]));
+    }
+    return diff;
+}
+
+int main(void) {
+    lehmer_init(1337);
+
+    Tokenizer t = tokenizer_load("models/tokenizer.model");
+    Params p = v_params_new(t.vocab_size);
+    Valerie v = v_model_new(t, p, TYPE_F32);
+
+    const int n_vocab = v.dim.vocab_size;
+    float* ref = malloc(sizeof(float) * n_vocab);
+    float* out = malloc(sizeof(float) * n_vocab);
+    decode(&v, ref);
+
+    uint64_t start = metrics_now_ns();
+    if (!v_model_save(&v, F32_PATH)) {
+        LOG_ERROR("Failed to save %s", F32_PATH);
+        return EXIT_FAILURE;
+    }
+    printf("saved %s in %.1f ms\n", F32_PATH, (double) (metrics_now_ns() - start) / 1e6);
+
+    // Same conversion as the convert tool: layer matrices only
+    Checkpoint* src = checkpoint_open(F32_PATH);
+    CheckpointWriter* w = src ? checkpoint_writer_new(Q8_PATH, src->header.params, TYPE_Q8) : NULL;
+    if (!w) {
+        return EXIT_FAILURE;
+    }
+    start = metrics_now_ns();
+    for (int i = 0; i < src->header.n_tensors; i++) {
+        const CheckpointEntry* e = &src->entries[i];
+        const bool convert = e->is_mat && 0 == strncmp(e->name, "layers.", 7);
+        checkpoint_convert(w, src, e, convert ? TYPE_Q8 : (TypeId) e->dtype);
+    }
+    printf("converted %d tensors (%zu MiB) in %.1f ms\n", src->header.n_tensors, src->size >> 20, (double) (metrics_now_ns() - start) / 1e6);
+    checkpoint_writer_close(w);
+    checkpoint_close(src);
+
+    // Full verification on demand
+    src = checkpoint_open(F32_PATH);
+    start = metrics_now_ns();
+    int corrupt = checkpoint_verify_all(src);
+    printf("verified %s: %d corrupt in %.1f ms\n", F32_PATH, corrupt, (double) (metrics_now_ns() - start) / 1e6);
+    checkpoint_close(src);
+
+    // Flip one byte of a weight: open succeeds, the tensor fails verification
+    FILE* file = fopen(Q8_PATH, "r+b");
+    src = checkpoint_open(Q8_PATH);
+    const CheckpointEntry* victim = checkpoint_find(src, "layers.3.ffn.W2");
+    const long at = (long) (victim->offset + victim->size / 2);
+    fseek(file, at, SEEK_SET);
+    int byte = fgetc(file);
+    fseek(file, -1, SEEK_CUR);
+    fputc(byte ^ 0x10, file);
+    fclose(file);
+    printf("corrupted layers.3.ffn.W2: %d corrupt\n", checkpoint_verify_all(src));
+    checkpoint_close(src);
+    Valerie bad = v_model_load(tokenizer_load("models/tokenizer.model"), Q8_PATH);
+    printf("loading it %s\n", bad.layers ? "succeeded (unexpected)" : "failed");
+    v_model_free(&bad);
+
+    // Restore the byte
+    file = fopen(Q8_PATH, "r+b");
+    fseek(file, at, SEEK_SET);
+    fputc(byte, file);
+    fclose(file);
+
+    // f32 round trip is lossless
+    start = metrics_now_ns();
+    Valerie f32 = v_model_load(tokenizer_load("models/tokenizer.model"), F32_PATH);
+    if (!f32.layers) {
+        return EXIT_FAILURE;
+    }
+    printf("loaded %s in %.1f ms\n", F32_PATH, (double) (metrics_now_ns() - start) / 1e6);
+    decode(&f32, out);
+    printf("f32 reload: max |diff| %g\n", (double) max_diff(out, ref, n_vocab));
+
+    // q8 weights: close to the f32 master
+    Valerie q8 = v_model_load(tokenizer_load("models/tokenizer.model"), Q8_PATH);
+    if (!q8.layers || q8.dtype != TYPE_Q8) {
+        return EXIT_FAILURE;
+    }
+    decode(&q8, out);
+    printf("q8 convert: max |diff| %g\n", (double) max_diff(out, ref, n_vocab));
+
+    free(ref);
+    free(out);
+    v_model_free(&q8);
+    v_model_free(&f32);
+    v_model_free(&v);
+    return EXIT_SUCCESS;
+}
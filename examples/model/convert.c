@@ -0,0 +1,162 @@
+/**
+ * @file      examples/model/convert.c
+ * @brief     Re-encode a model checkpoint to another weight type.
+ * @copyright Copyright © 2025 Austin Berrio
+ *
+ * Tensors are streamed from the mapped source one at a time and their rows are
+ * converted in parallel, so only one output tensor is held in memory. Layer
+ * weight matrices take the target type; the token embedding (also the output
+ * projection) and the RMSNorm weights stay f32, as the kernels require.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "core/metrics.h"
+#include "core/path.h"
+#include "linear/type.h"
+#include "model/checkpoint.h"
+
+/**
+ * @struct CLIParams
+ * @brief Command-line parameters for checkpoint conversion.
+ */
+struct CLIParams {
+    const char** argv;
+    int argc;
+
+    const char* input_path;  ///< Source checkpoint
+    const char* output_path;  ///< Converted checkpoint
+    TypeId dtype;  ///< Target weight type
+    bool verify;  ///< Only check the input's checksums
+    bool verbose;  ///< Print every tensor
+};
+
+void cli_usage(const char* prog) {
+    printf("Usage: %s --input S (--output S [--type S] | --verify) [--verbose]\n", prog);
+    printf("  --input    -i  Source checkpoint (required)\n");
+    printf("  --output   -o  Output checkpoint (required unless --verify)\n");
+    printf("  --type     -t  Weight type: f32, e5m10, e8m7, e4m3 or q8 (default: q8)\n");
+    printf("  --verify   -c  Check every tensor checksum of the input and exit\n");
+    printf("  --verbose  -v  Print every converted tensor\n");
+    printf("  --help     -h  Show this help message\n");
+}
+
+bool cli_is_arg(const char* argv, const char* l, const char* s, int argc, int i) {
+    return (strcmp(argv, l) == 0 || strcmp(argv, s) == 0) && i + 1 < argc;
+}
+
+bool cli_is_flag(const char* argv, const char* l, const char* s) {
+    return strcmp(argv, l) == 0 || strcmp(argv, s) == 0;
+}
+
+void cli_parse(struct CLIParams* cli) {
+    cli->dtype = TYPE_Q8;
+
+    for (int i = 1; i < cli->argc; ++i) {
+        if (cli_is_arg(cli->argv[i], "--input", "-i", cli->argc, i)) {
+            cli->input_path = cli->argv[++i];
+        } else if (cli_is_arg(cli->argv[i], "--output", "-o", cli->argc, i)) {
+            cli->output_path = cli->argv[++i];
+        } else if (cli_is_arg(cli->argv[i], "--type", "-t", cli->argc, i)) {
+            cli->dtype = type_id(cli->argv[++i]);
+            if (cli->dtype == TYPE_COUNT) {
+                fprintf(stderr, "Unknown type: %s\n", cli->argv[i]);
+                exit(EXIT_FAILURE);
+            }
+        } else if (cli_is_flag(cli->argv[i], "--verify", "-c")) {
+            cli->verify = true;
+        } else if (cli_is_flag(cli->argv[i], "--verbose", "-v")) {
+            cli->verbose = true;
+        } else if (cli_is_flag(cli->argv[i], "--help", "-h")) {
+            cli_usage(cli->argv[0]);
+            exit(EXIT_SUCCESS);
+        } else {
+            fprintf(stderr, "Unknown or incomplete option: %s\n", cli->argv[i]);
+            cli_usage(cli->argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (!cli->input_path || (!cli->output_path && !cli->verify)) {
+        fprintf(stderr, "Error: --input and --output are required.\n");
+        cli_usage(cli->argv[0]);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Layer weight matrices are converted; embeddings and norms stay as stored
+static bool is_layer_weight(const CheckpointEntry* e) {
+    return e->is_mat && 0 == strncmp(e->name, "layers.", 7);
+}
+
+int main(int argc, const char* argv[]) {
+    struct CLIParams cli = {.argc = argc, .argv = argv};
+    cli_parse(&cli);
+
+    if (!path_is_file(cli.input_path)) {
+        fprintf(stderr, "Error: Input file '%s' does not exist.\n", cli.input_path);
+        return EXIT_FAILURE;
+    }
+
+    Checkpoint* src = checkpoint_open(cli.input_path);
+    if (!src) {
+        return EXIT_FAILURE;
+    }
+
+    if (cli.verify) {
+        uint64_t start = metrics_now_ns();
+        int corrupt = checkpoint_verify_all(src);
+        printf(
+            "%s: %d of %d tensors corrupt (%.1f MiB checked in %.1f ms)\n",
+            cli.input_path,
+            corrupt,
+            src->header.n_tensors,
+            (double) src->size / (1 << 20),
+            (double) (metrics_now_ns() - start) / 1e6
+        );
+        checkpoint_close(src);
+        return corrupt ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    CheckpointWriter* w = checkpoint_writer_new(cli.output_path, src->header.params, cli.dtype);
+    if (!w) {
+        checkpoint_close(src);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t start = metrics_now_ns();
+    uint64_t bytes_in = 0;
+    bool ok = true;
+    for (int i = 0; ok && i < src->header.n_tensors; i++) {
+        const CheckpointEntry* e = &src->entries[i];
+        const TypeId dtype = is_layer_weight(e) ? cli.dtype : (TypeId) e->dtype;
+        ok = checkpoint_convert(w, src, e, dtype);
+        bytes_in += e->size;
+        if (cli.verbose) {
+            printf("%-24s (%5d, %5d) %-5s -> %s\n", e->name, e->rows, e->cols, type_name((TypeId) e->dtype), type_name(dtype));
+        }
+    }
+    const uint64_t bytes_out = w->offset;
+    ok = checkpoint_writer_close(w) && ok;
+    checkpoint_close(src);
+
+    if (!ok) {
+        fprintf(stderr, "Error: Conversion failed.\n");
+        return EXIT_FAILURE;
+    }
+
+    double seconds = (double) (metrics_now_ns() - start) / 1e9;
+    printf(
+        "%s -> %s (%s): %.1f MiB -> %.1f MiB in %.2f s\n",
+        cli.input_path,
+        cli.output_path,
+        type_name(cli.dtype),
+        (double) bytes_in / (1 << 20),
+        (double) bytes_out / (1 << 20),
+        seconds
+    );
+    return EXIT_SUCCESS;
+}
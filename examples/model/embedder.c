@@ -0,0 +1,109 @@
+/**
+ * @file examples/model/embedder.c
+ * @brief Batched sentence embeddings without the vocabulary projection.
+ * @copyright Copyright © 2025 Austin Berrio
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+#include "core/logger.h"
+#include "linear/lehmer.h"
+#include "linear/type.h"
+#include "tokenizer/model.h"
+#include "model/valerie.h"
+#include "model/embedder.h"
+
+#define N_TEXTS 6
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+static float dot(const float* a, const float* b, int n) {
+    float sum = 0.0f;
+    for (int i = 0; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+int main(void) {
+    lehmer_init(1337);
+
+    Tokenizer t = tokenizer_load("models/tokenizer.model");
+    Params p = v_params_new(t.vocab_size);
+    Valerie v = v_model_new(t, p, TYPE_Q8);
+    const int d_model = v.dim.d_model;
+
+    const char* texts[N_TEXTS] = {
+        "The quick brown fox jumps over the lazy dog.",
+        "A fast brown fox leaps over a sleepy dog.",
+        "Rust and C both compile to native code.",
+        "Hello, world!",
+        "Once upon a time, there was a little robot.",
+        "",
+    };
+
+    int* ids[N_TEXTS];
+    int lens[N_TEXTS];
+    int total = 0;
+    for (int i = 0; i < N_TEXTS; i++) {
+        ids[i] = NULL;
+        lens[i] = 0;  // the empty text stays empty and embeds to zero
+        if (texts[i][0]) {
+            ids[i] = tokenizer_encode(&v.t, (char*) texts[i], &lens[i], true, false);
+        }
+        total += lens[i];
+    }
+
+    float* out = calloc((size_t) N_TEXTS * d_model, sizeof(float));
+    Embedder e = embedder_new(&v, 4, 64, EMBED_POOL_MEAN);
+    if (!out || 0 == e.n_seqs) {
+        LOG_ERROR("Failed to create the embedder.");
+        return EXIT_FAILURE;
+    }
+
+    double start = now();
+    if (!embedder_encode(&e, (const int* const*) ids, lens, N_TEXTS, out)) {
+        LOG_ERROR("Embedding failed.");
+        return EXIT_FAILURE;
+    }
+    double elapsed = now() - start;
+
+    printf("embedded %d texts (%d tokens) in %.3f s, %.1f tok/s\n", N_TEXTS, total, elapsed,
+           (double) total / elapsed);
+    printf("state logits allocated: %s\n", v.state.logits.data ? "yes" : "no");
+    printf("batch logits allocated: %s\n", e.batch.logits.data ? "yes" : "no");
+
+    // Cosine similarity (vectors are unit length)
+    printf("\ncosine similarity (mean pooling):\n");
+    for (int i = 0; i < N_TEXTS; i++) {
+        printf("  [%d]", i);
+        for (int j = 0; j < N_TEXTS; j++) {
+            float* a = out + (size_t) i * d_model;
+            float* b = out + (size_t) j * d_model;
+            printf(" % .3f", (double) dot(a, b, d_model));
+        }
+        printf("  %s\n", texts[i]);
+    }
+
+    // Last-token pooling of a single text in a fresh session
+    e.pooling = EMBED_POOL_LAST;
+    embedder_encode(&e, (const int* const*) ids, lens, 1, out);
+    float norm = sqrtf(dot(out, out, d_model));
+    printf("\nlast-token pooling of [0]: |v| = %.3f, v[0..3] = % .4f % .4f % .4f % .4f\n",
+           (double) norm, (double) out[0], (double) out[1], (double) out[2], (double) out[3]);
+
+    embedder_free(&e);
+    for (int i = 0; i < N_TEXTS; i++) {
+        free(ids[i]);
+    }
+    free(out);
+    v_model_free(&v);
+    return EXIT_SUCCESS;
+}
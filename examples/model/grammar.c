@@ -0,0 +1,106 @@
+/**
+ * @file examples/model/grammar.c
+ * @brief Constrained generation: every sampled token keeps the output in the grammar.
+ * @copyright Copyright © 2025 Austin Berrio
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "core/logger.h"
+#include "linear/lehmer.h"
+#include "linear/type.h"
+#include "tokenizer/model.h"
+#include "tokenizer/decoder.h"
+#include "model/valerie.h"
+#include "model/blocks.h"
+#include "model/chat.h"
+#include "model/grammar.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+// Sample up to max_tokens constrained tokens; returns false on a grammar violation
+static bool generate(Valerie* v, Grammar* g, int max_tokens) {
+    Decoder d = decoder_new(&v->t);
+    d.skip_special = true;
+
+    double t_forward = 0.0;
+    double t_mask = 0.0;
+    int n = 0;
+    int id = 0;  // <bos>
+    for (int pos = 0; pos < max_tokens && pos < v->dim.seq_len; pos++) {
+        double start = now();
+        float* logits = forward(v, id, pos);
+        double mid = now();
+        bool any = grammar_apply(g, logits);
+        t_mask += now() - mid;
+        t_forward += mid - start;
+        if (!any) {
+            break;
+        }
+
+        id = chat_sample(logits, v->dim.vocab_size, 0.8f);
+        if (!grammar_accept(g, id)) {
+            LOG_ERROR("sampled a disallowed token: %d", id);
+            decoder_free(&d);
+            return false;
+        }
+        if (grammar_is_done(g)) {
+            break;
+        }
+
+        size_t len = 0;
+        const char* piece = decoder_push(&d, id, &len);
+        fwrite(piece, 1, len, stdout);
+        n++;
+    }
+
+    printf("\n  %d tokens, accepting: %s, forward %.3f ms/token, mask %.3f ms/token\n", n,
+           grammar_is_accepting(g) ? "yes" : "no", t_forward * 1e3 / (n ? n : 1),
+           t_mask * 1e3 / (n ? n : 1));
+    decoder_free(&d);
+    return true;
+}
+
+int main(void) {
+    lehmer_init(1337);
+
+    Tokenizer t = tokenizer_load("models/tokenizer.model");
+    Params p = v_params_new(t.vocab_size);
+    Valerie v = v_model_new(t, p, TYPE_Q8);
+
+    const char* patterns[] = {
+        "[0-9]{3}-[0-9]{4}",
+        "(yes|no|maybe)",
+        "[a-z]+(, [a-z]+)*\\.",
+    };
+
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++) {
+        Grammar* g = grammar_new(&v.t, patterns[i]);
+        if (!g) {
+            return EXIT_FAILURE;
+        }
+        printf("%s\n  ", patterns[i]);
+        ok &= generate(&v, g, 32);
+        grammar_free(g);
+    }
+
+    Grammar* json = grammar_json(&v.t, 2);
+    if (!json) {
+        return EXIT_FAILURE;
+    }
+    printf("json (depth 2)\n  ");
+    ok &= generate(&v, json, 64);
+    grammar_free(json);
+
+    v_model_free(&v);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
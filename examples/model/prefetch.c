@@ -0,0 +1,98 @@
+/**
+ * @file examples/model/prefetch.c
+ * @brief Decode with row prefetch off/on and with the layer warm-up thread.
+ * @copyright Copyright © 2025 Austin Berrio
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "core/metrics.h"
+#include "linear/lehmer.h"
+#include "linear/type.h"
+#include "tokenizer/model.h"
+#include "model/valerie.h"
+#include "model/blocks.h"
+#include "model/prefetch.h"
+#include "model/tune.h"
+
+#define N_TOKENS 32
+
+// Decode N_TOKENS positions, keep the last logits
+static double decode(Valerie* v, float* out) {
+    uint64_t start = metrics_now_ns();
+    float* logits = NULL;
+    for (int pos = 0; pos < N_TOKENS; pos++) {
+        logits = forward(v, pos % v->dim.vocab_size, pos);
+    }
+    memcpy(out, logits, sizeof(float) * v->dim.vocab_size);
+    return (double) (metrics_now_ns() - start) / 1e6;
+}
+
+// Same prefetch distance for every weight shape of the model
+static void set_distance(Valerie* v, int prefetch) {
+    Layer* L = &v->layers[0];
+    Tensor* weights[] = {&L->attn.Wq, &L->attn.Wk, &L->attn.Wo, &L->ffn.W1, &L->ffn.W2, &v->embed.token};
+    for (size_t i = 0; i < sizeof(weights) / sizeof(weights[0]); i++) {
+        TuneEntry e = {
+            .op = TUNE_OP_MATMUL,
+            .dtype = weights[i]->id,
+            .rows = (int) tensor_rows(weights[i]),
+            .cols = (int) tensor_cols(weights[i]),
+            .config = {.prefetch = prefetch},
+        };
+        tune_set(&e);
+    }
+}
+
+static float max_diff(const float* a, const float* b, int n) {
+    float diff = 0.0f;
+    for (int i = 0; i < n; i++) {
+        diff = fmaxf(diff, fabsf(a[i] - b[i]));
+    }
+    return diff;
+}
+
+int main(void) {
+    lehmer_init(1337);
+
+    Tokenizer t = tokenizer_load("models/tokenizer.model");
+    Params p = v_params_new(t.vocab_size);
+    Valerie v = v_model_new(t, p, TYPE_Q8);
+
+    const int n_vocab = v.dim.vocab_size;
+    float* ref = malloc(sizeof(float) * n_vocab);
+    float* out = malloc(sizeof(float) * n_vocab);
+
+    set_distance(&v, -1);
+    double t_off = decode(&v, ref);
+    printf("prefetch off:        %7.1f ms\n", t_off);
+
+    int distances[] = {1, 4, 16};
+    for (size_t i = 0; i < sizeof(distances) / sizeof(distances[0]); i++) {
+        set_distance(&v, distances[i]);
+        double ms = decode(&v, out);
+        printf("prefetch %2d rows:    %7.1f ms, max |diff| %g\n", distances[i], ms, (double) max_diff(out, ref, n_vocab));
+    }
+
+    // Kernel defaults plus the next-layer warm-up thread
+    tune_clear();
+    v.prefetch = prefetch_new(&v);
+    if (!v.prefetch) {
+        return EXIT_FAILURE;
+    }
+    double t_helper = decode(&v, out);
+    printf(
+        "warm-up thread:      %7.1f ms, max |diff| %g, %zu layers warmed\n",
+        t_helper,
+        (double) max_diff(out, ref, n_vocab),
+        atomic_load(&v.prefetch->warmed)
+    );
+
+    free(ref);
+    free(out);
+    v_model_free(&v);
+    return EXIT_SUCCESS;
+}
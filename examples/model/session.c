@@ -0,0 +1,67 @@
+/**
+ * @file examples/model/session.c
+ * @brief Snapshot a conversation and resume it without replaying the prompt.
+ * @copyright Copyright © 2025 Austin Berrio
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "core/logger.h"
+#include "linear/lehmer.h"
+#include "linear/type.h"
+#include "tokenizer/model.h"
+#include "model/valerie.h"
+#include "model/blocks.h"
+#include "model/session.h"
+
+int main(void) {
+    lehmer_init(1337);
+
+    Tokenizer t = tokenizer_load("models/tokenizer.model");
+    Params p = v_params_new(t.vocab_size);
+    Valerie v = v_model_new(t, p, TYPE_Q8);
+    Session s = v_session_new(&v.dim);
+
+    // Prefill a short prompt
+    int n_ids = 0;
+    int* ids = tokenizer_encode(&v.t, "Hello, world!", &n_ids, true, false);
+    for (int i = 0; i < n_ids; i++) {
+        forward(&v, ids[i], s.pos);
+        v_session_push(&s, ids[i]);
+    }
+    free(ids);
+
+    // Reference logits for the next token
+    int next = 0;
+    float* logits = forward(&v, next, s.pos);
+    float expected = logits[0];
+
+    const char* path = "models/session.bin";
+    if (!v_session_save(&v, &s, TYPE_F32, path)) {
+        LOG_ERROR("Failed to save session.");
+        return EXIT_FAILURE;
+    }
+
+    // Clobber the caches, then resume from disk
+    for (int l = 0; l < v.dim.layers; l++) {
+        tensor_zeros(&v.layers[l].cache.K);
+        tensor_zeros(&v.layers[l].cache.V);
+    }
+    s.pos = 0;
+
+    if (!v_session_restore(&v, &s, path)) {
+        LOG_ERROR("Failed to restore session.");
+        return EXIT_FAILURE;
+    }
+
+    logits = forward(&v, next, s.pos);
+    float restored = logits[0];
+    printf("restored pos=%d, logit[0]: expected % .5f, got % .5f\n",
+           s.pos, (double) expected, (double) restored);
+
+    v_session_free(&s);
+    v_model_free(&v);
+    return expected == restored ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,166 @@
+/**
+ * @file examples/model/swap.c
+ * @brief Oversubscribed sessions: a small block pool backed by a swap file.
+ * @copyright Copyright © 2025 Austin Berrio
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "core/logger.h"
+#include "linear/lehmer.h"
+#include "linear/type.h"
+#include "tokenizer/model.h"
+#include "model/valerie.h"
+#include "model/paged.h"
+#include "model/batch.h"
+#include "model/swap.h"
+
+#define N_SESSIONS 6
+#define N_ROUNDS 4
+
+static int argmax(const float* x, int n) {
+    int best = 0;
+    for (int i = 1; i < n; i++) {
+        best = x[i] > x[best] ? i : best;
+    }
+    return best;
+}
+
+// Forward one row of a session and return the greedy next id
+static int step(Valerie* v, Batch* b, KVSeq* seq, const int* ids, int n, int pos0, float* max_logit) {
+    batch_clear(b);
+    for (int i = 0; i < n; i++) {
+        batch_push_paged(b, ids[i], pos0 + i, seq, i == n - 1);
+    }
+    if (!forward_batch(v, b)) {
+        return -1;
+    }
+    float* logits = batch_logits(b, n - 1);
+    int next = argmax(logits, v->dim.vocab_size);
+    *max_logit = logits[next];
+    return next;
+}
+
+/**
+ * Prefill every session, then decode N_ROUNDS tokens round-robin. With a swap
+ * the pool is too small for all sessions; the next session is prefetched
+ * while the current one runs.
+ */
+static bool run(Valerie* v, int max_blocks, bool use_swap, bool quantized, int* out, float* logits) {
+    const char* prompts[N_SESSIONS] = {
+        "The quick brown fox jumps over the lazy dog.",
+        "Once upon a time, there was a little robot.",
+        "Hello, world! This is a test of the swap file.",
+        "Rust and C both compile to native code.",
+        "A journey of a thousand miles begins with one step.",
+        "To be, or not to be, that is the question.",
+    };
+
+    KVPool pool = kv_pool_new(&v->dim, max_blocks, KV_BLOCK_SIZE);
+    Batch b = batch_new(&v->dim, 64);
+    b.pool = &pool;
+
+    KVSwap* sw = NULL;
+    if (use_swap) {
+        sw = kv_swap_new(&pool, "/tmp/valerie.kvswap", 64, N_SESSIONS, quantized);
+        if (!sw) {
+            return false;
+        }
+    }
+
+    KVSeq seqs[N_SESSIONS];
+    int handles[N_SESSIONS];
+    int pos[N_SESSIONS];
+    int last[N_SESSIONS];
+    bool ok = true;
+
+    for (int s = 0; s < N_SESSIONS && ok; s++) {
+        int n = 0;
+        int* ids = tokenizer_encode(&v->t, (char*) prompts[s], &n, true, false);
+        seqs[s] = kv_seq_new(&pool, &v->dim);
+        if (sw) {
+            // Admission: make room for the prompt before accepting the session
+            handles[s] = kv_swap_register(sw, &seqs[s], 0);
+            ok = kv_swap_reserve(sw, (n + KV_BLOCK_SIZE - 1) / KV_BLOCK_SIZE)
+                 && kv_swap_acquire(sw, handles[s]);
+        }
+        last[s] = ok ? step(v, &b, &seqs[s], ids, n, 0, &logits[s * (N_ROUNDS + 1)]) : -1;
+        out[s * (N_ROUNDS + 1)] = last[s];
+        pos[s] = n;
+        ok = ok && last[s] >= 0;
+        if (sw) {
+            kv_swap_release(sw, handles[s]);
+        }
+        free(ids);
+    }
+
+    for (int r = 1; r <= N_ROUNDS && ok; r++) {
+        for (int s = 0; s < N_SESSIONS && ok; s++) {
+            if (sw) {
+                ok = kv_swap_acquire(sw, handles[s]) && kv_swap_reserve(sw, 1);
+                kv_swap_prefetch(sw, handles[(s + 1) % N_SESSIONS]);  // overlap with this step
+            }
+            int id = last[s];
+            last[s] = ok ? step(v, &b, &seqs[s], &id, 1, pos[s]++, &logits[s * (N_ROUNDS + 1) + r]) : -1;
+            out[s * (N_ROUNDS + 1) + r] = last[s];
+            ok = ok && last[s] >= 0;
+            if (sw) {
+                kv_swap_release(sw, handles[s]);
+            }
+        }
+    }
+
+    if (sw) {
+        printf("  pool peak %d of %d blocks, %zu blocks swapped out, %zu paged in\n", pool.peak,
+               max_blocks, sw->swapped_out, sw->swapped_in);
+        kv_swap_free(sw);  // unregisters every session
+    }
+    for (int s = 0; s < N_SESSIONS; s++) {
+        kv_seq_free(&pool, &seqs[s]);
+    }
+    batch_free(&b);
+    kv_pool_free(&pool);
+    return ok;
+}
+
+int main(void) {
+    lehmer_init(1337);
+
+    Tokenizer t = tokenizer_load("models/tokenizer.model");
+    Params p = v_params_new(t.vocab_size);
+    Valerie v = v_model_new(t, p, TYPE_Q8);
+
+    const int n = N_SESSIONS * (N_ROUNDS + 1);
+    int ref[N_SESSIONS * (N_ROUNDS + 1)];
+    int got[N_SESSIONS * (N_ROUNDS + 1)];
+    float ref_logits[N_SESSIONS * (N_ROUNDS + 1)];
+    float got_logits[N_SESSIONS * (N_ROUNDS + 1)];
+
+    printf("reference (64 blocks, no swap)\n");
+    if (!run(&v, 64, false, false, ref, ref_logits)) {
+        LOG_ERROR("Reference run failed.");
+        return EXIT_FAILURE;
+    }
+
+    for (int q = 0; q < 2; q++) {
+        printf("%s swap (8 blocks)\n", q ? "Q8" : "F32");
+        if (!run(&v, 8, true, q, got, got_logits)) {
+            LOG_ERROR("Swap run failed.");
+            return EXIT_FAILURE;
+        }
+
+        int same = 0;
+        float diff = 0.0f;
+        for (int i = 0; i < n; i++) {
+            same += got[i] == ref[i];
+            diff = fmaxf(diff, fabsf(got_logits[i] - ref_logits[i]));
+        }
+        printf("  %d/%d greedy ids match, max top-logit difference %.6f\n", same, n, (double) diff);
+    }
+
+    v_model_free(&v);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file examples/model/tune.c
+ * @brief Autotune the matmul kernels of a model and compare against defaults.
+ * @copyright Copyright © 2025 Austin Berrio
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "core/logger.h"
+#include "core/metrics.h"
+#include "core/path.h"
+#include "linear/lehmer.h"
+#include "linear/type.h"
+#include "tokenizer/model.h"
+#include "model/valerie.h"
+#include "model/blocks.h"
+#include "model/tune.h"
+
+#define N_TOKENS 32
+
+// Decode N_TOKENS positions, keep the last logits
+static double decode(Valerie* v, float* out) {
+    uint64_t start = metrics_now_ns();
+    float* logits = NULL;
+    for (int pos = 0; pos < N_TOKENS; pos++) {
+        logits = forward(v, pos % v->dim.vocab_size, pos);
+    }
+    memcpy(out, logits, sizeof(float) * v->dim.vocab_size);
+    return (double) (metrics_now_ns() - start) / 1e6;
+}
+
+int main(int argc, char** argv) {
+    bool retune = argc > 1 && 0 == strcmp(argv[1], "--retune");
+    lehmer_init(1337);
+
+    Tokenizer t = tokenizer_load("models/tokenizer.model");
+    Params p = v_params_new(t.vocab_size);
+    Valerie v = v_model_new(t, p, TYPE_Q8);
+
+    const int n_vocab = v.dim.vocab_size;
+    float* ref = malloc(sizeof(float) * n_vocab);
+    float* out = malloc(sizeof(float) * n_vocab);
+
+    tune_clear();
+    double t_default = decode(&v, ref);
+
+    char* path = tune_cache_path();
+    printf("cache: %s\n", path ? path : "(none)");
+    path_free(path);
+
+    uint64_t start = metrics_now_ns();
+    if (!tune_init(&v, retune)) {
+        LOG_ERROR("Failed to write the tuning cache.");
+    }
+    printf("tune_init: %.1f ms\n\n", (double) (metrics_now_ns() - start) / 1e6);
+
+    int count = 0;
+    const TuneEntry* entries = tune_entries(&count);
+    printf(
+        "%-13s %-5s %6s %6s %7s %5s %4s %8s %10s\n", "op", "type", "rows", "cols", "threads", "chunk", "tile", "prefetch", "us"
+    );
+    for (int i = 0; i < count; i++) {
+        const TuneEntry* e = &entries[i];
+        printf(
+            "%-13s %-5s %6d %6d %7d %5d %4d %8d %10.1f\n",
+            tune_op_name(e->op),
+            type_name(e->dtype),
+            e->rows,
+            e->cols,
+            e->config.threads,
+            e->config.chunk,
+            e->config.tile,
+            e->config.prefetch,
+            e->ns / 1e3
+        );
+    }
+
+    // Tuning only changes scheduling, never the arithmetic
+    double t_tuned = decode(&v, out);
+    float max_diff = 0.0f;
+    for (int i = 0; i < n_vocab; i++) {
+        max_diff = fmaxf(max_diff, fabsf(out[i] - ref[i]));
+    }
+    printf("\n%d tokens: default %.1f ms, tuned %.1f ms, max |diff| %g\n", N_TOKENS, t_default, t_tuned, (double) max_diff);
+
+    free(ref);
+    free(out);
+    v_model_free(&v);
+    return max_diff == 0.0f ? EXIT_SUCCESS : EXIT_FAILURE;
+}
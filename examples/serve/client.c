@@ -0,0 +1,265 @@
+/**
+ * @file      examples/serve/client.c
+ * @brief     Completion client and load generator for valerie-serve.
+ * @copyright Copyright © 2025 Austin Berrio
+ *
+ * With a single client the completion is streamed to stdout. With several
+ * concurrent clients only a latency and throughput summary is printed.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "protocol.h"
+
+/**
+ * @struct CLIParams
+ * @brief Command-line parameters for the client.
+ */
+struct CLIParams {
+    const char** argv;
+    int argc;
+
+    const char* socket_path;  ///< Unix socket path
+    const char* prompt;  ///< Prompt text
+    int max_tokens;  ///< Generation limit per request
+    float temperature;  ///< Sampling temperature
+    int clients;  ///< Concurrent connections
+    int requests;  ///< Requests per connection
+};
+
+/**
+ * @struct Stats
+ * @brief Per-thread load test results.
+ */
+typedef struct Stats {
+    const struct CLIParams* cli;
+    int ok;  // completed requests
+    int failed;  // failed requests
+    long tokens;  // streamed tokens
+    double latency;  // summed request latency (seconds)
+    double ttft;  // summed time to first token (seconds)
+} Stats;
+
+void cli_usage(const char* prog) {
+    printf("Usage: %s [--socket S] [--prompt S] [--max-tokens N] [--temperature F]\n", prog);
+    printf("          [--clients N] [--requests N]\n");
+    printf("  --socket       -s  Unix socket path (default: %s)\n", SERVE_SOCKET);
+    printf("  --prompt       -p  Prompt text (default: \"Hello, world!\")\n");
+    printf("  --max-tokens   -m  Tokens to generate per request (default: 32)\n");
+    printf("  --temperature  -t  Sampling temperature (default: 0, greedy)\n");
+    printf("  --clients      -c  Concurrent connections (default: 1)\n");
+    printf("  --requests     -n  Requests per connection (default: 1)\n");
+    printf("  --help         -h  Show this help message\n");
+}
+
+bool cli_is_arg(const char* argv, const char* l, const char* s, int argc, int i) {
+    return (strcmp(argv, l) == 0 || strcmp(argv, s) == 0) && i + 1 < argc;
+}
+
+bool cli_is_flag(const char* argv, const char* l, const char* s) {
+    return strcmp(argv, l) == 0 || strcmp(argv, s) == 0;
+}
+
+void cli_parse(struct CLIParams* cli) {
+    cli->socket_path = SERVE_SOCKET;
+    cli->prompt = "Hello, world!";
+    cli->max_tokens = 32;
+    cli->temperature = 0.0f;
+    cli->clients = 1;
+    cli->requests = 1;
+
+    for (int i = 1; i < cli->argc; ++i) {
+        if (cli_is_arg(cli->argv[i], "--socket", "-s", cli->argc, i)) {
+            cli->socket_path = cli->argv[++i];
+        } else if (cli_is_arg(cli->argv[i], "--prompt", "-p", cli->argc, i)) {
+            cli->prompt = cli->argv[++i];
+        } else if (cli_is_arg(cli->argv[i], "--max-tokens", "-m", cli->argc, i)) {
+            cli->max_tokens = atoi(cli->argv[++i]);
+        } else if (cli_is_arg(cli->argv[i], "--temperature", "-t", cli->argc, i)) {
+            cli->temperature = strtof(cli->argv[++i], NULL);
+        } else if (cli_is_arg(cli->argv[i], "--clients", "-c", cli->argc, i)) {
+            cli->clients = atoi(cli->argv[++i]);
+        } else if (cli_is_arg(cli->argv[i], "--requests", "-n", cli->argc, i)) {
+            cli->requests = atoi(cli->argv[++i]);
+        } else if (cli_is_flag(cli->argv[i], "--help", "-h")) {
+            cli_usage(cli->argv[0]);
+            exit(EXIT_SUCCESS);
+        } else {
+            fprintf(stderr, "Unknown or incomplete option: %s\n", cli->argv[i]);
+            cli_usage(cli->argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    cli->max_tokens = cli->max_tokens < 1 ? 32 : cli->max_tokens;
+    cli->clients = cli->clients < 1 ? 1 : cli->clients;
+    cli->requests = cli->requests < 1 ? 1 : cli->requests;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+static int client_connect(const char* path) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (-1 == fd) {
+        return -1;
+    }
+    if (-1 == connect(fd, (struct sockaddr*) &addr, sizeof(addr))) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Send one request and consume its stream; echo text when requested
+static bool client_request(const struct CLIParams* cli, Stats* stats, bool echo) {
+    int fd = client_connect(cli->socket_path);
+    if (-1 == fd) {
+        fprintf(stderr, "Error: failed to connect to %s: %s\n", cli->socket_path, strerror(errno));
+        return false;
+    }
+
+    double start = now();
+    ServeRequest req = {
+        .len = strlen(cli->prompt),
+        .max_tokens = cli->max_tokens,
+        .temperature = cli->temperature,
+    };
+    bool ok = serve_write(fd, &req, sizeof(req)) && serve_write(fd, cli->prompt, req.len);
+
+    char text[256];
+    long tokens = 0;
+    double first = 0.0;
+    while (ok) {
+        ServeFrame frame;
+        if (!serve_read(fd, &frame, sizeof(frame))) {
+            ok = false;
+            break;
+        }
+
+        // Consume text in pieces; tokens are short, errors may not be
+        uint32_t left = frame.len;
+        while (ok && left > 0) {
+            uint32_t n = left < sizeof(text) - 1 ? left : sizeof(text) - 1;
+            ok = serve_read(fd, text, n);
+            text[n] = '\0';
+            left -= n;
+            if (ok && (echo || frame.id == SERVE_ERROR)) {
+                fputs(text, frame.id == SERVE_ERROR ? stderr : stdout);
+            }
+        }
+
+        if (frame.id == SERVE_END) {
+            break;
+        }
+        if (frame.id == SERVE_ERROR) {
+            fputc('\n', stderr);
+            ok = false;
+            break;
+        }
+
+        if (0 == tokens++) {
+            first = now();
+        }
+        if (echo) {
+            fflush(stdout);
+        }
+    }
+
+    close(fd);
+
+    if (!ok) {
+        stats->failed++;
+        return false;
+    }
+
+    double end = now();
+    stats->ok++;
+    stats->tokens += tokens;
+    stats->latency += end - start;
+    stats->ttft += (tokens > 0 ? first : end) - start;
+    return true;
+}
+
+static void* client_worker(void* arg) {
+    Stats* stats = arg;
+    for (int i = 0; i < stats->cli->requests; i++) {
+        client_request(stats->cli, stats, false);
+    }
+    return NULL;
+}
+
+int main(int argc, const char* argv[]) {
+    struct CLIParams cli = {.argc = argc, .argv = argv};
+    cli_parse(&cli);
+
+    // Interactive: stream a single completion
+    if (1 == cli.clients && 1 == cli.requests) {
+        Stats stats = {.cli = &cli};
+        bool ok = client_request(&cli, &stats, true);
+        printf("\n");
+        if (ok) {
+            fprintf(stderr, "%ld tokens in %.3fs (ttft %.3fs)\n",
+                    stats.tokens, stats.latency, stats.ttft);
+        }
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Load test: concurrent connections, summary only
+    Stats* stats = calloc(cli.clients, sizeof(Stats));
+    pthread_t* threads = calloc(cli.clients, sizeof(pthread_t));
+    if (!stats || !threads) {
+        fprintf(stderr, "Error: out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    double start = now();
+    for (int i = 0; i < cli.clients; i++) {
+        stats[i].cli = &cli;
+        pthread_create(&threads[i], NULL, client_worker, &stats[i]);
+    }
+
+    Stats total = {0};
+    for (int i = 0; i < cli.clients; i++) {
+        pthread_join(threads[i], NULL);
+        total.ok += stats[i].ok;
+        total.failed += stats[i].failed;
+        total.tokens += stats[i].tokens;
+        total.latency += stats[i].latency;
+        total.ttft += stats[i].ttft;
+    }
+    double elapsed = now() - start;
+
+    int n = total.ok > 0 ? total.ok : 1;
+    printf("clients:     %d\n", cli.clients);
+    printf("requests:    %d ok, %d failed\n", total.ok, total.failed);
+    printf("tokens:      %ld\n", total.tokens);
+    printf("elapsed:     %.3fs\n", elapsed);
+    printf("latency:     %.3fs mean\n", total.latency / n);
+    printf("ttft:        %.3fs mean\n", total.ttft / n);
+    printf("throughput:  %.1f tok/s, %.2f req/s\n",
+           (double) total.tokens / elapsed, (double) total.ok / elapsed);
+
+    free(stats);
+    free(threads);
+    return 0 == total.failed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,84 @@
+/**
+ * @file      examples/serve/protocol.h
+ * @brief     Wire format shared by valerie-serve and valerie-client.
+ * @copyright Copyright © 2025 Austin Berrio
+ *
+ * All integers are native-endian; both ends live on the same host.
+ *
+ * Request (client -> server), one per connection:
+ *   ServeRequest | prompt[len]
+ *
+ * Response (server -> client), repeated:
+ *   ServeFrame | text[len]
+ *
+ * Token frames carry the text completed by that token, which may be empty
+ * while a partial UTF-8 sequence is held back. A frame with id SERVE_END
+ * closes the stream and carries any remaining text. A frame with id
+ * SERVE_ERROR carries an error message and also closes the stream.
+ */
+
+#ifndef VALERIE_SERVE_PROTOCOL_H
+#define VALERIE_SERVE_PROTOCOL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#define SERVE_SOCKET "/tmp/valerie.sock"
+#define SERVE_MAX_PROMPT (1u << 20)  // 1 MiB
+
+#define SERVE_END (-1)
+#define SERVE_ERROR (-2)
+
+typedef struct ServeRequest {
+    uint32_t len;  // prompt length in bytes
+    uint32_t max_tokens;  // generation limit
+    float temperature;  // 0 selects greedy decoding
+} ServeRequest;
+
+typedef struct ServeFrame {
+    int32_t id;  // token id, SERVE_END, or SERVE_ERROR
+    uint32_t len;  // text length in bytes
+} ServeFrame;
+
+static inline bool serve_read(int fd, void* buf, size_t len) {
+    uint8_t* p = buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= (size_t) n;
+    }
+    return true;
+}
+
+static inline bool serve_write(int fd, const void* buf, size_t len) {
+    const uint8_t* p = buf;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= (size_t) n;
+    }
+    return true;
+}
+
+static inline bool serve_write_frame(int fd, int32_t id, const char* text, uint32_t len) {
+    ServeFrame frame = {.id = id, .len = len};
+    return serve_write(fd, &frame, sizeof(frame)) && (len == 0 || serve_write(fd, text, len));
+}
+
+#endif  // VALERIE_SERVE_PROTOCOL_H
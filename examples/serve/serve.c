@@ -0,0 +1,808 @@
+/**
+ * @file      examples/serve/serve.c
+ * @brief     Local completion daemon over a Unix domain socket.
+ * @copyright Copyright © 2025 Austin Berrio
+ *
+ * The tokenizer and model are loaded once. Each connection carries a single
+ * length-prefixed completion request (see protocol.h). Connection threads
+ * tokenize the prompt and enqueue a job; one engine thread owns the model and
+ * advances every active job per step with a single forward_batch() call:
+ * decode rows first, then prefill chunks to fill the remaining capacity.
+ * Sampled tokens are handed back to the connection threads, which detokenize
+ * them incrementally and stream only complete UTF-8 text.
+ *
+ * Request latencies and per-step throughput are recorded in metrics_global.
+ * SIGUSR1 dumps them to stderr (and to --metrics as JSON); both are also
+ * written on shutdown.
+ *
+ * On shutdown the engine aborts every queued and active job, so each client
+ * gets an error frame, and the model is freed only after the last connection
+ * thread has finished.
+ *
+ * @note Weights are randomly initialized until checkpoints can be loaded.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "core/logger.h"
+#include "core/metrics.h"
+#include "core/map.h"
+#include "core/path.h"
+#include "linear/lehmer.h"
+#include "linear/type.h"
+#include "tokenizer/model.h"
+#include "tokenizer/decoder.h"
+#include "model/valerie.h"
+#include "model/batch.h"
+#include "model/chat.h"
+#include "model/tune.h"
+
+#include "protocol.h"
+
+// Bounds reads and writes on client sockets so a stalled client cannot hold up shutdown
+#define SERVE_IO_TIMEOUT_S 30
+
+/**
+ * @struct Job
+ * @brief A completion request shared by its connection and the engine.
+ */
+typedef struct Job {
+    // Immutable after enqueue
+    int* prompt;  // prompt ids (n_prompt,)
+    int n_prompt;
+    int max_tokens;
+    float temperature;
+    uint64_t t_enqueue;  // metrics_now_ns() when queued
+
+    // Engine owned
+    int slot;  // active slot index
+    int pos;  // tokens fed to the model
+    int next;  // last sampled id (fed on the next step)
+    uint64_t t_last;  // time of the last sampled id
+
+    // Shared (guarded by lock)
+    int* out;  // sampled ids (max_tokens,)
+    int n_out;
+    bool done;
+    bool cancelled;
+    bool aborted;  // dropped on shutdown
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+
+    struct Job* link;  // queue link
+} Job;
+
+/**
+ * @struct Server
+ * @brief Model, batching queue, and active sequences.
+ */
+typedef struct Server {
+    Valerie v;
+    Batch batch;
+    Job** rows;  // batch row -> job (batch capacity,)
+    Cache** kv;  // per-slot layer caches (n_slots,)
+    Job** slots;  // active jobs (n_slots,)
+    int n_slots;
+    int chunk;  // max prefill tokens per job per step
+    int eos;
+
+    // Rows of the last schedule
+    int n_decode;
+    int n_prefill;
+
+    // Metrics (metrics_global)
+    Histogram* queue_us;
+    Histogram* ttft_us;
+    Histogram* itl_us;
+    Histogram* prefill_tok_s;
+    Histogram* decode_tok_s;
+    Histogram* occupancy;
+    Histogram* kv_util;
+
+    // Batching queue and connections (guarded by lock)
+    Job* head;
+    Job* tail;
+    bool stopping;  // engine has exited; no more jobs are accepted
+    int n_conns;  // live connection threads
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    pthread_cond_t idle;  // signalled when n_conns drops to zero
+} Server;
+
+/**
+ * @struct Conn
+ * @brief Connection thread arguments.
+ */
+typedef struct Conn {
+    Server* s;
+    int fd;
+} Conn;
+
+/**
+ * @struct CLIParams
+ * @brief Command-line parameters for the daemon.
+ */
+struct CLIParams {
+    const char** argv;
+    int argc;
+
+    const char* socket_path;  ///< Unix socket path
+    const char* tokenizer_path;  ///< Tokenizer model path
+    int batch;  ///< Maximum rows per forward step
+    int slots;  ///< Maximum concurrent sequences
+    int chunk;  ///< Prefill tokens per sequence per step
+    int seed;  ///< RNG seed
+    const char* metrics_path;  ///< JSON metrics dump path (optional)
+    bool tune;  ///< Load or create this machine's kernel tuning cache
+};
+
+static volatile sig_atomic_t serve_running = 1;
+static volatile sig_atomic_t serve_dump = 0;
+
+/**
+ * @section CLI
+ * @{
+ */
+
+void cli_usage(const char* prog) {
+    printf("Usage: %s [--socket S] [--tokenizer S] [--batch N] [--slots N] [--chunk N]\n", prog);
+    printf("  --socket     -s  Unix socket path (default: %s)\n", SERVE_SOCKET);
+    printf("  --tokenizer  -t  Tokenizer model (default: models/tokenizer.model)\n");
+    printf("  --batch      -b  Maximum rows per forward step (default: 32)\n");
+    printf("  --slots      -n  Maximum concurrent sequences (default: 8)\n");
+    printf("  --chunk      -c  Prefill tokens per sequence per step (default: 16)\n");
+    printf("  --seed       -r  Random seed (default: 1337)\n");
+    printf("  --metrics    -m  Write JSON metrics here on SIGUSR1 and at shutdown (optional)\n");
+    printf("  --tune       -u  Autotune kernels (cached per machine)\n");
+    printf("  --help       -h  Show this help message\n");
+}
+
+bool cli_is_arg(const char* argv, const char* l, const char* s, int argc, int i) {
+    return (strcmp(argv, l) == 0 || strcmp(argv, s) == 0) && i + 1 < argc;
+}
+
+bool cli_is_flag(const char* argv, const char* l, const char* s) {
+    return strcmp(argv, l) == 0 || strcmp(argv, s) == 0;
+}
+
+static int cli_int(const char* arg, int fallback) {
+    int value = atoi(arg);
+    return value < 1 ? fallback : value;
+}
+
+void cli_parse(struct CLIParams* cli) {
+    cli->socket_path = SERVE_SOCKET;
+    cli->tokenizer_path = "models/tokenizer.model";
+    cli->batch = 32;
+    cli->slots = 8;
+    cli->chunk = 16;
+    cli->seed = 1337;
+
+    for (int i = 1; i < cli->argc; ++i) {
+        if (cli_is_arg(cli->argv[i], "--socket", "-s", cli->argc, i)) {
+            cli->socket_path = cli->argv[++i];
+        } else if (cli_is_arg(cli->argv[i], "--tokenizer", "-t", cli->argc, i)) {
+            cli->tokenizer_path = cli->argv[++i];
+        } else if (cli_is_arg(cli->argv[i], "--batch", "-b", cli->argc, i)) {
+            cli->batch = cli_int(cli->argv[++i], 32);
+        } else if (cli_is_arg(cli->argv[i], "--slots", "-n", cli->argc, i)) {
+            cli->slots = cli_int(cli->argv[++i], 8);
+        } else if (cli_is_arg(cli->argv[i], "--chunk", "-c", cli->argc, i)) {
+            cli->chunk = cli_int(cli->argv[++i], 16);
+        } else if (cli_is_arg(cli->argv[i], "--seed", "-r", cli->argc, i)) {
+            cli->seed = cli_int(cli->argv[++i], 1337);
+        } else if (cli_is_arg(cli->argv[i], "--metrics", "-m", cli->argc, i)) {
+            cli->metrics_path = cli->argv[++i];
+        } else if (cli_is_flag(cli->argv[i], "--tune", "-u")) {
+            cli->tune = true;
+        } else if (cli_is_flag(cli->argv[i], "--help", "-h")) {
+            cli_usage(cli->argv[0]);
+            exit(EXIT_SUCCESS);
+        } else {
+            fprintf(stderr, "Unknown or incomplete option: %s\n", cli->argv[i]);
+            cli_usage(cli->argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+/** @} */
+
+/**
+ * @section Jobs
+ * @{
+ */
+
+static Job* job_new(int* prompt, int n_prompt, int max_tokens, float temperature) {
+    Job* job = calloc(1, sizeof(Job));
+    if (!job) {
+        return NULL;
+    }
+
+    job->out = calloc(max_tokens, sizeof(int));
+    if (!job->out) {
+        free(job);
+        return NULL;
+    }
+
+    job->prompt = prompt;
+    job->n_prompt = n_prompt;
+    job->max_tokens = max_tokens;
+    job->temperature = temperature;
+    job->slot = -1;
+    pthread_mutex_init(&job->lock, NULL);
+    pthread_cond_init(&job->ready, NULL);
+    return job;
+}
+
+static void job_free(Job* job) {
+    if (job) {
+        pthread_mutex_destroy(&job->lock);
+        pthread_cond_destroy(&job->ready);
+        free(job->prompt);
+        free(job->out);
+        free(job);
+    }
+}
+
+// Publish a sampled id; the engine must not touch the job once it is done
+static void job_emit(Job* job, int id, bool done) {
+    pthread_mutex_lock(&job->lock);
+    if (id >= 0) {
+        job->out[job->n_out++] = id;
+    }
+    job->done = done;
+    pthread_cond_signal(&job->ready);
+    pthread_mutex_unlock(&job->lock);
+}
+
+// Finish a job the engine will never run
+static void job_abort(Job* job) {
+    pthread_mutex_lock(&job->lock);
+    job->aborted = true;
+    job->done = true;
+    pthread_cond_signal(&job->ready);
+    pthread_mutex_unlock(&job->lock);
+}
+
+static bool job_is_cancelled(Job* job) {
+    pthread_mutex_lock(&job->lock);
+    bool cancelled = job->cancelled;
+    pthread_mutex_unlock(&job->lock);
+    return cancelled;
+}
+
+/** @} */
+
+/**
+ * @section Engine
+ * @{
+ */
+
+// Queue a job; fails once the engine has stopped
+static bool server_enqueue(Server* s, Job* job) {
+    pthread_mutex_lock(&s->lock);
+    if (s->stopping) {
+        pthread_mutex_unlock(&s->lock);
+        return false;
+    }
+    if (s->tail) {
+        s->tail->link = job;
+    } else {
+        s->head = job;
+    }
+    s->tail = job;
+    pthread_cond_signal(&s->ready);
+    pthread_mutex_unlock(&s->lock);
+    return true;
+}
+
+static int server_active(Server* s) {
+    int n = 0;
+    for (int i = 0; i < s->n_slots; i++) {
+        n += s->slots[i] != NULL;
+    }
+    return n;
+}
+
+// Block until there is work, then move queued jobs into free slots
+static bool server_admit(Server* s) {
+    pthread_mutex_lock(&s->lock);
+    while (serve_running && !s->head && server_active(s) == 0) {
+        pthread_cond_wait(&s->ready, &s->lock);
+    }
+
+    for (int i = 0; i < s->n_slots && s->head; i++) {
+        if (s->slots[i]) {
+            continue;
+        }
+        Job* job = s->head;
+        s->head = job->link;
+        if (!s->head) {
+            s->tail = NULL;
+        }
+        job->link = NULL;
+        job->slot = i;
+        job->pos = 0;
+        s->slots[i] = job;
+        histogram_record(s->queue_us, (metrics_now_ns() - job->t_enqueue) / 1000);
+    }
+
+    bool running = serve_running;
+    pthread_mutex_unlock(&s->lock);
+    return running;
+}
+
+static void server_release(Server* s, Job* job) {
+    s->slots[job->slot] = NULL;
+}
+
+// Fill the batch: one decode row per generating job, then prefill chunks
+static void server_schedule(Server* s) {
+    Batch* b = &s->batch;
+    batch_clear(b);
+    s->n_decode = 0;
+    s->n_prefill = 0;
+
+    for (int i = 0; i < s->n_slots; i++) {
+        Job* job = s->slots[i];
+        if (job && job_is_cancelled(job)) {
+            server_release(s, job);
+            job_emit(job, -1, true);
+            continue;
+        }
+        if (job && job->pos >= job->n_prompt) {
+            int row = batch_push(b, job->next, job->pos, s->kv[i], true);
+            if (row < 0) {
+                break;  // batch is full; remaining jobs wait a step
+            }
+            s->rows[row] = job;
+            job->pos++;
+            s->n_decode++;
+        }
+    }
+
+    for (int i = 0; i < s->n_slots && b->n < b->capacity; i++) {
+        Job* job = s->slots[i];
+        for (int c = 0; job && c < s->chunk && job->pos < job->n_prompt; c++) {
+            bool last = job->pos + 1 == job->n_prompt;
+            int row = batch_push(b, job->prompt[job->pos], job->pos, s->kv[i], last);
+            if (row < 0) {
+                break;
+            }
+            s->rows[row] = job;
+            job->pos++;
+            s->n_prefill++;
+        }
+    }
+}
+
+// Per-step throughput and utilization
+static void server_record_step(Server* s, uint64_t elapsed_ns) {
+    const Batch* b = &s->batch;
+    const double seconds = (double) (elapsed_ns > 0 ? elapsed_ns : 1) * 1e-9;
+
+    if (s->n_prefill > 0) {
+        histogram_record(s->prefill_tok_s, (uint64_t) ((double) s->n_prefill / seconds));
+    }
+    if (s->n_decode > 0) {
+        histogram_record(s->decode_tok_s, (uint64_t) ((double) s->n_decode / seconds));
+    }
+    histogram_record(s->occupancy, (uint64_t) (100 * b->n / b->capacity));
+
+    size_t cached = 0;
+    for (int i = 0; i < s->n_slots; i++) {
+        cached += s->slots[i] ? (size_t) s->slots[i]->pos : 0;
+    }
+    histogram_record(s->kv_util, 100 * cached / ((size_t) s->n_slots * s->v.dim.seq_len));
+}
+
+static void server_step(Server* s) {
+    Batch* b = &s->batch;
+    const Dim* d = &s->v.dim;
+
+    server_schedule(s);
+    if (b->n == 0) {
+        return;
+    }
+
+    uint64_t start = metrics_now_ns();
+    forward_batch(&s->v, b);
+    uint64_t now = metrics_now_ns();
+    server_record_step(s, now - start);
+
+    for (int row = 0; row < b->n; row++) {
+        float* logits = batch_logits(b, row);
+        if (!logits) {
+            continue;
+        }
+
+        Job* job = s->rows[row];
+        int id = chat_sample(logits, d->vocab_size, job->temperature);
+        bool done = id == s->eos || job->n_out + 1 >= job->max_tokens || job->pos >= d->seq_len;
+        job->next = id;
+        if (0 == job->n_out) {
+            histogram_record(s->ttft_us, (now - job->t_enqueue) / 1000);
+        } else {
+            histogram_record(s->itl_us, (now - job->t_last) / 1000);
+        }
+        job->t_last = now;
+        if (done) {
+            server_release(s, job);
+        }
+        job_emit(job, id, done);
+    }
+}
+
+// Abort queued and active jobs so their connection threads can finish
+static void server_drain(Server* s) {
+    pthread_mutex_lock(&s->lock);
+    s->stopping = true;
+    Job* job = s->head;
+    s->head = NULL;
+    s->tail = NULL;
+    pthread_mutex_unlock(&s->lock);
+
+    while (job) {
+        Job* link = job->link;
+        job_abort(job);
+        job = link;
+    }
+
+    for (int i = 0; i < s->n_slots; i++) {
+        if (s->slots[i]) {
+            job = s->slots[i];
+            server_release(s, job);
+            job_abort(job);
+        }
+    }
+}
+
+static void* server_engine(void* arg) {
+    Server* s = arg;
+    while (server_admit(s)) {
+        server_step(s);
+    }
+    server_drain(s);
+    return NULL;
+}
+
+// Called by each connection thread on exit
+static void server_conn_done(Server* s) {
+    pthread_mutex_lock(&s->lock);
+    if (0 == --s->n_conns) {
+        pthread_cond_broadcast(&s->idle);
+    }
+    pthread_mutex_unlock(&s->lock);
+}
+
+/** @} */
+
+/**
+ * @section Connections
+ * @{
+ */
+
+static void conn_error(int fd, const char* message) {
+    serve_write_frame(fd, SERVE_ERROR, message, strlen(message));
+}
+
+static void conn_serve(Server* s, int fd) {
+    ServeRequest req;
+    if (!serve_read(fd, &req, sizeof(req)) || req.len > SERVE_MAX_PROMPT) {
+        conn_error(fd, "invalid request");
+        close(fd);
+        return;
+    }
+
+    char* text = malloc(req.len + 1);
+    if (!text || !serve_read(fd, text, req.len)) {
+        conn_error(fd, "failed to read prompt");
+        free(text);
+        close(fd);
+        return;
+    }
+    text[req.len] = '\0';
+
+    int n_prompt = 0;
+    int* prompt = tokenizer_encode(&s->v.t, text, &n_prompt, true, false);
+    free(text);
+
+    const int seq_len = s->v.dim.seq_len;
+    if (!prompt || n_prompt == 0 || n_prompt >= seq_len) {
+        conn_error(fd, "prompt does not fit in the context");
+        free(prompt);
+        close(fd);
+        return;
+    }
+
+    int max_tokens = req.max_tokens > 0 ? (int) req.max_tokens : seq_len;
+    if (max_tokens > seq_len - n_prompt) {
+        max_tokens = seq_len - n_prompt;
+    }
+
+    Job* job = job_new(prompt, n_prompt, max_tokens, req.temperature);
+    if (!job) {
+        conn_error(fd, "out of memory");
+        free(prompt);
+        close(fd);
+        return;
+    }
+
+    job->t_enqueue = metrics_now_ns();
+    if (!server_enqueue(s, job)) {
+        conn_error(fd, "server is shutting down");
+        job_free(job);
+        close(fd);
+        return;
+    }
+
+    // Stream text as the engine publishes ids; held-back bytes go out with the end frame
+    Decoder dec = decoder_new(&s->v.t);
+    dec.skip_special = true;
+
+    bool alive = true;
+    bool aborted = false;
+    int sent = 0;
+    while (true) {
+        pthread_mutex_lock(&job->lock);
+        while (job->n_out == sent && !job->done) {
+            pthread_cond_wait(&job->ready, &job->lock);
+        }
+        int n_out = job->n_out;
+        bool done = job->done;
+        aborted = job->aborted;
+        pthread_mutex_unlock(&job->lock);
+
+        for (; alive && sent < n_out; sent++) {
+            int id = job->out[sent];
+            if (id == s->eos) {
+                continue;
+            }
+            size_t n = 0;
+            const char* piece = decoder_push(&dec, id, &n);
+            alive = serve_write_frame(fd, id, piece, piece ? n : 0);
+        }
+        sent = n_out;
+
+        if (!alive) {
+            // Client went away; let the engine drop the sequence
+            pthread_mutex_lock(&job->lock);
+            job->cancelled = true;
+            pthread_mutex_unlock(&job->lock);
+        }
+
+        if (done) {
+            break;
+        }
+    }
+
+    if (alive && aborted) {
+        conn_error(fd, "server is shutting down");
+    } else if (alive) {
+        size_t n = 0;
+        const char* rest = decoder_flush(&dec, &n);
+        serve_write_frame(fd, SERVE_END, rest, rest ? n : 0);
+    }
+    decoder_free(&dec);
+
+    LOG_INFO("request: %d prompt tokens, %d generated", job->n_prompt, job->n_out);
+    job_free(job);
+    close(fd);
+}
+
+static void* conn_handle(void* arg) {
+    Conn* conn = arg;
+    Server* s = conn->s;
+    conn_serve(s, conn->fd);
+    free(conn);
+    server_conn_done(s);
+    return NULL;
+}
+
+/** @} */
+
+static void serve_stop(int sig) {
+    (void) sig;
+    serve_running = 0;
+}
+
+static void serve_request_dump(int sig) {
+    (void) sig;
+    serve_dump = 1;
+}
+
+static void serve_dump_metrics(const char* path) {
+    metrics_dump_text(&metrics_global, stderr);
+    if (path) {
+        FILE* file = fopen(path, "w");
+        if (!file || !metrics_dump_json(&metrics_global, file)) {
+            LOG_ERROR("serve: failed to write metrics to %s", path);
+        }
+        if (file) {
+            fclose(file);
+        }
+    }
+}
+
+static int serve_listen(const char* path) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        LOG_ERROR("serve: socket path is too long: %s", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (-1 == fd) {
+        LOG_ERROR("serve: socket: %s", strerror(errno));
+        return -1;
+    }
+
+    unlink(path);  // stale socket from a previous run
+    if (-1 == bind(fd, (struct sockaddr*) &addr, sizeof(addr)) || -1 == listen(fd, 64)) {
+        LOG_ERROR("serve: failed to listen on %s: %s", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+int main(int argc, const char* argv[]) {
+    struct CLIParams cli = {.argc = argc, .argv = argv};
+    cli_parse(&cli);
+
+    if (!path_is_file(cli.tokenizer_path)) {
+        fprintf(stderr, "Error: Tokenizer '%s' does not exist.\n", cli.tokenizer_path);
+        return EXIT_FAILURE;
+    }
+
+    lehmer_init(cli.seed);
+
+    Server s = {0};
+    Tokenizer t = tokenizer_load(cli.tokenizer_path);
+    Params p = v_params_new(t.vocab_size);
+    s.v = v_model_new(t, p, TYPE_Q8);
+    if (cli.tune && !tune_init(&s.v, false)) {
+        LOG_WARN("serve: running with untuned kernels");
+    }
+
+    int* eos = hash_map_search(s.v.t.token_to_id, s.v.t.special->eos);
+    s.eos = eos ? *eos : -1;
+    s.chunk = cli.chunk;
+    s.n_slots = cli.slots;
+    s.batch = batch_new(&s.v.dim, cli.batch);
+    s.rows = calloc(cli.batch, sizeof(Job*));
+    s.slots = calloc(cli.slots, sizeof(Job*));
+    s.kv = calloc(cli.slots, sizeof(Cache*));
+    if (0 == s.batch.capacity || !s.rows || !s.slots || !s.kv) {
+        LOG_ERROR("serve: failed to allocate the engine");
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < s.n_slots; i++) {
+        s.kv[i] = v_caches_new(&s.v.dim);
+    }
+    pthread_mutex_init(&s.lock, NULL);
+    pthread_cond_init(&s.ready, NULL);
+    pthread_cond_init(&s.idle, NULL);
+
+    s.queue_us = metrics_histogram(&metrics_global, METRIC_QUEUE_US, "us");
+    s.ttft_us = metrics_histogram(&metrics_global, METRIC_TTFT_US, "us");
+    s.itl_us = metrics_histogram(&metrics_global, METRIC_ITL_US, "us");
+    s.prefill_tok_s = metrics_histogram(&metrics_global, METRIC_PREFILL_TOK_S, "tok/s");
+    s.decode_tok_s = metrics_histogram(&metrics_global, METRIC_DECODE_TOK_S, "tok/s");
+    s.occupancy = metrics_histogram(&metrics_global, METRIC_BATCH_OCCUPANCY, "%");
+    s.kv_util = metrics_histogram(&metrics_global, METRIC_KV_UTILIZATION, "%");
+
+    struct sigaction sa = {.sa_handler = serve_stop};
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sa.sa_handler = serve_request_dump;
+    sigaction(SIGUSR1, &sa, NULL);
+
+    // Block the signals in every thread; the accept loop takes them only inside pselect()
+    sigset_t signals, wait_mask;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &signals, &wait_mask);
+
+    int server_fd = serve_listen(cli.socket_path);
+    if (-1 == server_fd) {
+        return EXIT_FAILURE;
+    }
+
+    pthread_t engine;
+    pthread_create(&engine, NULL, server_engine, &s);
+    LOG_INFO("serve: listening on %s (batch=%d, slots=%d)", cli.socket_path, cli.batch, cli.slots);
+
+    while (serve_running) {
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(server_fd, &readable);
+        int ready = pselect(server_fd + 1, &readable, NULL, NULL, NULL, &wait_mask);
+        if (serve_dump) {
+            serve_dump = 0;
+            serve_dump_metrics(cli.metrics_path);
+        }
+        if (-1 == ready) {
+            if (errno != EINTR) {
+                LOG_ERROR("serve: pselect: %s", strerror(errno));
+            }
+            continue;
+        }
+
+        int fd = accept(server_fd, NULL, NULL);
+        if (-1 == fd) {
+            if (errno != EINTR) {
+                LOG_ERROR("serve: accept: %s", strerror(errno));
+            }
+            continue;
+        }
+
+        Conn* conn = malloc(sizeof(Conn));
+        pthread_t thread;
+        if (!conn) {
+            close(fd);
+            continue;
+        }
+        struct timeval timeout = {.tv_sec = SERVE_IO_TIMEOUT_S};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        conn->s = &s;
+        conn->fd = fd;
+
+        pthread_mutex_lock(&s.lock);
+        s.n_conns++;
+        pthread_mutex_unlock(&s.lock);
+        if (0 != pthread_create(&thread, NULL, conn_handle, conn)) {
+            server_conn_done(&s);
+            free(conn);
+            close(fd);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+
+    LOG_INFO("serve: shutting down");
+    close(server_fd);
+    unlink(cli.socket_path);
+
+    pthread_mutex_lock(&s.lock);
+    pthread_cond_broadcast(&s.ready);
+    pthread_mutex_unlock(&s.lock);
+    pthread_join(engine, NULL);
+
+    // Connection threads use the tokenizer until their last frame
+    pthread_mutex_lock(&s.lock);
+    while (s.n_conns > 0) {
+        pthread_cond_wait(&s.idle, &s.lock);
+    }
+    pthread_mutex_unlock(&s.lock);
+    serve_dump_metrics(cli.metrics_path);
+
+    for (int i = 0; i < s.n_slots; i++) {
+        v_caches_free(s.kv[i], s.v.dim.layers);
+    }
+    free(s.kv);
+    free(s.slots);
+    free(s.rows);
+    batch_free(&s.batch);
+    v_model_free(&s.v);
+    return EXIT_SUCCESS;
+}
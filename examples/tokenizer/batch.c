@@ -0,0 +1,177 @@
+/**
+ * @file   examples/tokenizer/batch.c
+ * @brief  Encode the lines of a text file as a batch of documents
+ * @copyright Copyright © 2025 Austin Berrio
+ *
+ * Checks tokenizer_encode_batch() against tokenizer_encode() and reports
+ * throughput for 1 .. N OpenMP threads.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <omp.h>
+
+#include "core/metrics.h"
+#include "core/path.h"
+
+#include "tokenizer/vocab.h"
+#include "tokenizer/model.h"
+
+/**
+ * @struct CLIParams
+ * @brief Command-line parameters.
+ */
+struct CLIParams {
+    const char** argv;
+    int argc;
+
+    char* model_path;
+    char* input_path;
+    int repeat;
+};
+
+/**
+ * @brief Print usage instructions.
+ */
+void cli_usage(const char* prog) {
+    printf("Usage: %s --model S --input S [--repeat N] [--help]\n", prog);
+    printf("  --model    -m  Path to tokenizer model file (required)\n");
+    printf("  --input    -i  Plaintext file, one document per line (required)\n");
+    printf("  --repeat   -r  Copies of the input to encode (default: 8)\n");
+    printf("  --help     -h  Show this help message\n");
+}
+
+/**
+ * @brief Free CLI parameter memory.
+ */
+void cli_free(struct CLIParams* cli) {
+    free(cli->model_path);
+    free(cli->input_path);
+}
+
+bool cli_is_arg(const char* argv, const char* l, const char* s, int argc, int i) {
+    return (strcmp(argv, l) == 0 || strcmp(argv, s) == 0) && i + 1 < argc;
+}
+
+bool cli_is_flag(const char* argv, const char* l, const char* s) {
+    return strcmp(argv, l) == 0 || strcmp(argv, s) == 0;
+}
+
+/**
+ * @brief Parse CLI arguments into CLIParams struct.
+ */
+void cli_parse(struct CLIParams* cli) {
+    cli->model_path = NULL;
+    cli->input_path = NULL;
+    cli->repeat = 8;
+
+    for (int i = 1; i < cli->argc; ++i) {
+        if (cli_is_arg(cli->argv[i], "--model", "-m", cli->argc, i)) {
+            cli->model_path = strdup(cli->argv[++i]);
+        } else if (cli_is_arg(cli->argv[i], "--input", "-i", cli->argc, i)) {
+            cli->input_path = strdup(cli->argv[++i]);
+        } else if (cli_is_arg(cli->argv[i], "--repeat", "-r", cli->argc, i)) {
+            cli->repeat = atoi(cli->argv[++i]);
+            if (cli->repeat < 1) {
+                cli->repeat = 8;
+            }
+        } else if (cli_is_flag(cli->argv[i], "--help", "-h")) {
+            cli_usage(cli->argv[0]);
+            cli_free(cli);
+            exit(EXIT_SUCCESS);
+        } else {
+            fprintf(stderr, "Unknown or incomplete option: %s\n", cli->argv[i]);
+            cli_usage(cli->argv[0]);
+            cli_free(cli);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (!cli->model_path || !cli->input_path) {
+        fprintf(stderr, "Error: --model and --input are required.\n");
+        cli_usage(cli->argv[0]);
+        cli_free(cli);
+        exit(EXIT_FAILURE);
+    }
+}
+
+int main(int argc, const char* argv[]) {
+    struct CLIParams cli = {.argc = argc, .argv = argv};
+    cli_parse(&cli);
+
+    if (!path_is_file(cli.model_path)) {
+        fprintf(stderr, "Error: Model file does not exist: %s\n", cli.model_path);
+        cli_free(&cli);
+        return EXIT_FAILURE;
+    }
+
+    char* text = vocab_read_text(cli.input_path);
+    if (!text) {
+        fprintf(stderr, "Error: Failed to read %s\n", cli.input_path);
+        cli_free(&cli);
+        return EXIT_FAILURE;
+    }
+
+    // One document per line, repeated to give the threads something to do
+    size_t lines = 1;
+    for (char* c = text; *c; c++) {
+        lines += *c == '\n';
+    }
+
+    size_t n = lines * (size_t) cli.repeat;
+    char** docs = malloc(n * sizeof(char*));
+    size_t count = 0;
+    size_t bytes = 0;
+    for (char* line = strtok(text, "\n"); line; line = strtok(NULL, "\n")) {
+        docs[count++] = line;
+        bytes += strlen(line);
+    }
+    for (int r = 1; r < cli.repeat; r++) {
+        memcpy(docs + r * count, docs, count * sizeof(char*));
+    }
+    n = count * (size_t) cli.repeat;
+    bytes *= (size_t) cli.repeat;
+
+    Tokenizer t = tokenizer_load(cli.model_path);
+
+    // Reference: one document at a time
+    TokenBatch batch = tokenizer_encode_batch(&t, docs, n, true, true);
+    if (!batch.ids) {
+        fprintf(stderr, "Failed to encode batch!\n");
+        return EXIT_FAILURE;
+    }
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < count; i++) {
+        int id_count;
+        int* ids = tokenizer_encode(&t, docs[i], &id_count, true, true);
+        size_t len = batch.offsets[i + 1] - batch.offsets[i];
+        if (!ids || len != (size_t) id_count || memcmp(ids, batch.ids + batch.offsets[i], len * sizeof(int))) {
+            mismatches++;
+        }
+        free(ids);
+    }
+    printf("%zu documents, %zu bytes -> %zu ids (%zu mismatches)\n", n, bytes, batch.offsets[n], mismatches);
+    tokenizer_batch_free(&batch);
+
+    // Throughput by thread count
+    int max_threads = omp_get_max_threads();
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        omp_set_num_threads(threads);
+        uint64_t start = metrics_now_ns();
+        batch = tokenizer_encode_batch(&t, docs, n, true, true);
+        double seconds = (double) (metrics_now_ns() - start) * 1e-9;
+        printf("threads %2d: %8.2f ms, %7.2f MB/s\n", threads, seconds * 1e3, (double) bytes / seconds / 1e6);
+        tokenizer_batch_free(&batch);
+    }
+
+    tokenizer_free(&t);
+    free(docs);
+    free(text);
+    cli_free(&cli);
+
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file   examples/tokenizer/decoder.c
+ * @brief  Stream ids through the incremental decoder and compare with tokenizer_decode
+ * @copyright Copyright © 2025 Austin Berrio
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "core/path.h"
+#include "tokenizer/model.h"
+#include "tokenizer/decoder.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, const char* argv[]) {
+    const char* model_path = argc > 1 ? argv[1] : "models/tokenizer.model";
+    if (!path_is_file(model_path)) {
+        fprintf(stderr, "Error: Tokenizer '%s' does not exist.\n", model_path);
+        return EXIT_FAILURE;
+    }
+
+    Tokenizer t = tokenizer_load(model_path);
+
+    // Long output built from a repeated sentence
+    const char* sentence = "The quick brown fox jumps over the lazy dog. ";
+    const size_t repeat = 512;
+    size_t text_len = strlen(sentence) * repeat;
+    char* text = malloc(text_len + 1);
+    for (size_t i = 0; i < repeat; i++) {
+        memcpy(text + i * strlen(sentence), sentence, strlen(sentence));
+    }
+    text[text_len] = '\0';
+
+    int n_ids = 0;
+    int* ids = tokenizer_encode(&t, text, &n_ids, false, false);
+    if (!ids) {
+        fprintf(stderr, "Error: Failed to encode text.\n");
+        return EXIT_FAILURE;
+    }
+
+    // Stream every id, timing the first and second half separately
+    Decoder d = decoder_new(&t);
+    char* streamed = malloc(text_len + 1);
+    size_t streamed_len = 0;
+    double half[2] = {0};
+    for (int i = 0; i < n_ids; i++) {
+        double start = now();
+        size_t n = 0;
+        const char* piece = decoder_push(&d, ids[i], &n);
+        half[i >= n_ids / 2] += now() - start;
+        memcpy(streamed + streamed_len, piece, n);
+        streamed_len += n;
+    }
+    size_t n = 0;
+    const char* rest = decoder_flush(&d, &n);
+    memcpy(streamed + streamed_len, rest, n);
+    streamed_len += n;
+    streamed[streamed_len] = '\0';
+
+    char* decoded = tokenizer_decode(&t, ids, n_ids);
+    bool match = decoded && strcmp(decoded, streamed) == 0;
+    printf("ids: %d, bytes: %zu, match: %s\n", n_ids, streamed_len, match ? "yes" : "no");
+    printf("per-token: first half %.1f ns, second half %.1f ns\n",
+           half[0] * 1e9 / (n_ids / 2), half[1] * 1e9 / (n_ids - n_ids / 2));
+
+    // Stop strings cut the output and are never emitted
+    decoder_reset(&d);
+    decoder_add_stop(&d, "lazy");
+    streamed_len = 0;
+    for (int i = 0; i < n_ids && !decoder_stopped(&d); i++) {
+        const char* piece = decoder_push(&d, ids[i], &n);
+        memcpy(streamed + streamed_len, piece, n);
+        streamed_len += n;
+    }
+    streamed[streamed_len] = '\0';
+    printf("stopped: '%s'\n", streamed);
+    match = match && strcmp(streamed, "The quick brown fox jumps over the ") == 0;
+
+    free(decoded);
+    free(streamed);
+    free(ids);
+    free(text);
+    decoder_free(&d);
+    tokenizer_free(&t);
+    return match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
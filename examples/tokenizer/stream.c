@@ -0,0 +1,205 @@
+/**
+ * @file   examples/tokenizer/stream.c
+ * @brief  Encode a file in fixed-size chunks with the streaming encoder
+ * @copyright Copyright © 2025 Austin Berrio
+ *
+ * Ids are written to --output as native-endian int32. With --check, the
+ * stream is compared against encoding the whole file at once.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "core/metrics.h"
+#include "core/path.h"
+
+#include "tokenizer/vocab.h"
+#include "tokenizer/model.h"
+#include "tokenizer/encoder.h"
+
+/**
+ * @struct CLIParams
+ * @brief Command-line parameters.
+ */
+struct CLIParams {
+    const char** argv;
+    int argc;
+
+    char* model_path;
+    char* input_path;
+    char* output_path;
+    size_t chunk;
+    bool check;
+};
+
+/**
+ * @brief Ids collected in memory for --check.
+ */
+struct Collect {
+    FILE* file;
+    int* ids;
+    size_t count;
+    size_t capacity;
+    size_t chunks;
+};
+
+/**
+ * @brief Print usage instructions.
+ */
+void cli_usage(const char* prog) {
+    printf("Usage: %s --model S --input S [--output S] [--chunk N] [--check] [--help]\n", prog);
+    printf("  --model    -m  Path to tokenizer model file (required)\n");
+    printf("  --input    -i  Plaintext file to encode (required)\n");
+    printf("  --output   -o  Output id file (int32)\n");
+    printf("  --chunk    -n  Chunk size in bytes (default: 1 MiB)\n");
+    printf("  --check    -c  Compare against encoding the whole file\n");
+    printf("  --help     -h  Show this help message\n");
+}
+
+/**
+ * @brief Free CLI parameter memory.
+ */
+void cli_free(struct CLIParams* cli) {
+    free(cli->model_path);
+    free(cli->input_path);
+    free(cli->output_path);
+}
+
+bool cli_is_arg(const char* argv, const char* l, const char* s, int argc, int i) {
+    return (strcmp(argv, l) == 0 || strcmp(argv, s) == 0) && i + 1 < argc;
+}
+
+bool cli_is_flag(const char* argv, const char* l, const char* s) {
+    return strcmp(argv, l) == 0 || strcmp(argv, s) == 0;
+}
+
+/**
+ * @brief Parse CLI arguments into CLIParams struct.
+ */
+void cli_parse(struct CLIParams* cli) {
+    cli->model_path = NULL;
+    cli->input_path = NULL;
+    cli->output_path = NULL;
+    cli->chunk = ENCODER_CAPACITY;
+    cli->check = false;
+
+    for (int i = 1; i < cli->argc; ++i) {
+        if (cli_is_arg(cli->argv[i], "--model", "-m", cli->argc, i)) {
+            cli->model_path = strdup(cli->argv[++i]);
+        } else if (cli_is_arg(cli->argv[i], "--input", "-i", cli->argc, i)) {
+            cli->input_path = strdup(cli->argv[++i]);
+        } else if (cli_is_arg(cli->argv[i], "--output", "-o", cli->argc, i)) {
+            cli->output_path = strdup(cli->argv[++i]);
+        } else if (cli_is_arg(cli->argv[i], "--chunk", "-n", cli->argc, i)) {
+            long chunk = atol(cli->argv[++i]);
+            cli->chunk = chunk > 0 ? (size_t) chunk : ENCODER_CAPACITY;
+        } else if (cli_is_flag(cli->argv[i], "--check", "-c")) {
+            cli->check = true;
+        } else if (cli_is_flag(cli->argv[i], "--help", "-h")) {
+            cli_usage(cli->argv[0]);
+            cli_free(cli);
+            exit(EXIT_SUCCESS);
+        } else {
+            fprintf(stderr, "Unknown or incomplete option: %s\n", cli->argv[i]);
+            cli_usage(cli->argv[0]);
+            cli_free(cli);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (!cli->model_path || !cli->input_path) {
+        fprintf(stderr, "Error: --model and --input are required.\n");
+        cli_usage(cli->argv[0]);
+        cli_free(cli);
+        exit(EXIT_FAILURE);
+    }
+}
+
+bool collect_sink(const int* ids, size_t count, void* ctx) {
+    struct Collect* c = ctx;
+    c->chunks++;
+
+    if (c->file && !encoder_sink_file(ids, count, c->file)) {
+        return false;
+    }
+
+    if (c->capacity > 0 || !c->file) {
+        if (c->count + count > c->capacity) {
+            size_t capacity = 2 * (c->count + count);
+            int* grown = realloc(c->ids, capacity * sizeof(int));
+            if (!grown) {
+                return false;
+            }
+            c->ids = grown;
+            c->capacity = capacity;
+        }
+        memcpy(c->ids + c->count, ids, count * sizeof(int));
+    }
+    c->count += count;
+    return true;
+}
+
+int main(int argc, const char* argv[]) {
+    struct CLIParams cli = {.argc = argc, .argv = argv};
+    cli_parse(&cli);
+
+    if (!path_is_file(cli.model_path) || !path_is_file(cli.input_path)) {
+        fprintf(stderr, "Error: Missing model or input file.\n");
+        cli_free(&cli);
+        return EXIT_FAILURE;
+    }
+
+    struct Collect c = {0};
+    if (cli.output_path) {
+        c.file = fopen(cli.output_path, "wb");
+        if (!c.file) {
+            fprintf(stderr, "Error: Failed to open %s\n", cli.output_path);
+            cli_free(&cli);
+            return EXIT_FAILURE;
+        }
+    }
+    if (cli.check) {
+        c.capacity = 1024;  // keep ids even when writing a file
+        c.ids = malloc(c.capacity * sizeof(int));
+    }
+
+    Tokenizer t = tokenizer_load(cli.model_path);
+
+    Encoder e = encoder_new(&t, cli.chunk, collect_sink, &c);
+    uint64_t start = metrics_now_ns();
+    bool ok = e.text && encoder_read_file(&e, cli.input_path);
+    double seconds = (double) (metrics_now_ns() - start) * 1e-9;
+    printf(
+        "%zu bytes -> %zu ids in %zu chunks of %zu bytes: %.2f ms, %.2f MB/s\n",
+        e.n_bytes,
+        e.n_ids,
+        c.chunks,
+        e.capacity,
+        seconds * 1e3,
+        (double) e.n_bytes / seconds / 1e6
+    );
+    encoder_free(&e);
+
+    if (ok && cli.check) {
+        VocabText text = vocab_text_open(cli.input_path);
+        int* ids = text.data ? malloc((text.len + 2) * sizeof(int)) : NULL;
+        size_t id_count = ids ? tokenizer_encode_span(&t, text.data, text.len, false, false, ids) : SIZE_MAX;
+        bool same = id_count == c.count && 0 == memcmp(ids, c.ids, c.count * sizeof(int));
+        printf("check: %s (%zu ids when encoded whole)\n", same ? "identical" : "MISMATCH", id_count);
+        ok = same;
+        free(ids);
+        vocab_text_close(&text);
+    }
+
+    if (c.file) {
+        fclose(c.file);
+    }
+    free(c.ids);
+    tokenizer_free(&t);
+    cli_free(&cli);
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
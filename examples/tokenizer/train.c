@@ -31,7 +31,9 @@ struct CLIParams {
 
     char* input_path;  ///< Input text corpus (plaintext)
     char* output_dir;  ///< Output directory for model files
-    int merges;  ///< Number of BPE merges to perform
+    char* resume_path;  ///< Trainer checkpoint to resume from
+    int merges;  ///< Total number of BPE merges
+    int checkpoint;  ///< Merges between trainer checkpoints (0: at the end only)
     bool verbose;  ///< Enable verbose/debug output
 };
 
@@ -39,12 +41,14 @@ struct CLIParams {
  * @brief Print usage instructions for the tokenizer trainer.
  */
 void cli_usage(const char* prog) {
-    printf("Usage: %s --input S --output S [--merges N] [--verbose]\n", prog);
-    printf("  --input    -i  Input plaintext corpus file (required)\n");
-    printf("  --output   -o  Output directory for tokenizer model (required)\n");
-    printf("  --merges   -m  Number of BPE merges (default: 10)\n");
-    printf("  --verbose  -v  Enable debug output\n");
-    printf("  --help     -h  Show this help message\n");
+    printf("Usage: %s --input S --output S [--merges N] [--checkpoint N] [--resume S] [--verbose]\n", prog);
+    printf("  --input       -i  Input plaintext corpus file (required unless resuming)\n");
+    printf("  --output      -o  Output directory for tokenizer model (required)\n");
+    printf("  --merges      -m  Total number of BPE merges (default: 10)\n");
+    printf("  --checkpoint  -c  Save the trainer state every N merges (default: at the end)\n");
+    printf("  --resume      -r  Continue from a trainer checkpoint (e.g. out/bpe.trainer)\n");
+    printf("  --verbose     -v  Enable debug output\n");
+    printf("  --help        -h  Show this help message\n");
 }
 
 /**
@@ -53,6 +57,7 @@ void cli_usage(const char* prog) {
 void cli_free(struct CLIParams* cli) {
     free(cli->input_path);
     free(cli->output_dir);
+    free(cli->resume_path);
 }
 
 bool cli_is_arg(const char* argv, const char* l, const char* s, int argc, int i) {
@@ -70,7 +75,9 @@ void cli_parse(struct CLIParams* cli) {
     // Set defaults
     cli->input_path = NULL;
     cli->output_dir = NULL;
+    cli->resume_path = NULL;
     cli->merges = 10;
+    cli->checkpoint = 0;
     cli->verbose = false;
 
     for (int i = 1; i < cli->argc; ++i) {
@@ -83,6 +90,13 @@ void cli_parse(struct CLIParams* cli) {
             if (cli->merges < 1) {
                 cli->merges = 10;
             }
+        } else if (cli_is_arg(cli->argv[i], "--checkpoint", "-c", cli->argc, i)) {
+            cli->checkpoint = atoi(cli->argv[++i]);
+            if (cli->checkpoint < 0) {
+                cli->checkpoint = 0;
+            }
+        } else if (cli_is_arg(cli->argv[i], "--resume", "-r", cli->argc, i)) {
+            cli->resume_path = strdup(cli->argv[++i]);
         } else if (cli_is_flag(cli->argv[i], "--verbose", "-v")) {
             cli->verbose = true;
         } else if (cli_is_flag(cli->argv[i], "--help", "-h")) {
@@ -97,8 +111,8 @@ void cli_parse(struct CLIParams* cli) {
         }
     }
 
-    if (!cli->input_path || !cli->output_dir) {
-        fprintf(stderr, "Error: --input and --output are required.\n");
+    if ((!cli->input_path && !cli->resume_path) || !cli->output_dir) {
+        fprintf(stderr, "Error: --input (or --resume) and --output are required.\n");
         cli_usage(cli->argv[0]);
         cli_free(cli);
         exit(EXIT_FAILURE);
@@ -110,7 +124,7 @@ int main(int argc, const char* argv[]) {
     cli_parse(&cli);
 
     // Validate input file
-    if (!path_is_file(cli.input_path)) {
+    if (!cli.resume_path && !path_is_file(cli.input_path)) {
         fprintf(stderr, "Error: Input file '%s' does not exist.\n", cli.input_path);
         cli_free(&cli);
         return EXIT_FAILURE;
@@ -133,18 +147,57 @@ int main(int argc, const char* argv[]) {
         }
     }
 
-    // Build vocabulary from input text
-    HashMap* vocab = vocab_build(cli.input_path);
-    if (!vocab) {
-        fprintf(stderr, "Error: Failed to build vocab from '%s'.\n", cli.input_path);
-        cli_free(&cli);
-        return EXIT_FAILURE;
+    // Build vocabulary from input text, or pick up a previous run
+    HashMap* vocab = NULL;
+    BPETrainer* trainer = NULL;
+    if (cli.resume_path) {
+        trainer = bpe_trainer_load(cli.resume_path);
+        if (!trainer) {
+            fprintf(stderr, "Error: Failed to resume from '%s'.\n", cli.resume_path);
+            cli_free(&cli);
+            return EXIT_FAILURE;
+        }
+        printf("Resumed at %zu merges from %s\n", bpe_trainer_model(trainer)->count, cli.resume_path);
+    } else {
+        vocab = vocab_build(cli.input_path);
+        if (!vocab) {
+            fprintf(stderr, "Error: Failed to build vocab from '%s'.\n", cli.input_path);
+            cli_free(&cli);
+            return EXIT_FAILURE;
+        }
+        trainer = bpe_trainer_new(vocab);
+        if (!trainer) {
+            fprintf(stderr, "Error: Failed to create BPE trainer.\n");
+            vocab_map_free(vocab);
+            cli_free(&cli);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Train BPE merges up to the total, checkpointing along the way
+    BPEModel* model = bpe_trainer_model(trainer);
+    char* trainer_path = path_join(cli.output_dir, "bpe.trainer");
+    size_t total = (size_t) cli.merges;
+    size_t every = cli.checkpoint > 0 ? (size_t) cli.checkpoint : total;
+    bool trained = true;
+    while (model->count < total) {
+        size_t steps = total - model->count < every ? total - model->count : every;
+        size_t done = bpe_trainer_run(trainer, steps);
+        if (done == SIZE_MAX || !bpe_trainer_save(trainer, trainer_path)) {
+            trained = false;
+            break;
+        }
+        printf("Saved trainer state at %zu merges to %s\n", model->count, trainer_path);
+        if (done < steps) {
+            break;  // exhausted
+        }
     }
+    printf("\n");
+    free(trainer_path);
 
-    // Train BPE merges
-    BPEModel* model = bpe_train(vocab, (size_t) cli.merges, cli.verbose);
-    if (!model) {
+    if (!trained) {
         fprintf(stderr, "Error: Failed to train BPE model.\n");
+        bpe_trainer_free(trainer);
         vocab_map_free(vocab);
         cli_free(&cli);
         return EXIT_FAILURE;
@@ -213,7 +266,7 @@ int main(int argc, const char* argv[]) {
 
     // Clean up
     tokenizer_free(&t);
-    bpe_free(model);
+    bpe_trainer_free(trainer);  // owns the model
     vocab_map_free(vocab);
     cli_free(&cli);
 
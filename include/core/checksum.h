@@ -0,0 +1,65 @@
+/**
+ * Copyright © 2025 Austin Berrio
+ * @file core/checksum.h
+ * @brief Fast non-cryptographic 64-bit checksums for integrity checks.
+ *
+ * checksum64() is XXH64: four independent 64-bit lanes consume 32 bytes per
+ * step, so the main loop has no cross-lane dependency and streams at memory
+ * bandwidth. It detects corruption, not tampering.
+ *
+ * checksum_blocks() splits large buffers into CHECKSUM_BLOCK-sized blocks,
+ * hashes them in parallel and folds the block digests together. The result
+ * depends only on the data, never on the thread count. Callers that schedule
+ * blocks of many buffers at once use checksum_block() and checksum_combine().
+ */
+
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CHECKSUM_BLOCK (1u << 20) /**< Bytes per parallel block. */
+
+/**
+ * @brief XXH64 of a buffer.
+ * @param data Input bytes.
+ * @param len Number of bytes.
+ * @param seed Hash seed.
+ */
+uint64_t checksum64(const void* data, size_t len, uint64_t seed);
+
+/**
+ * @brief Number of blocks of a buffer.
+ */
+static inline size_t checksum_block_count(size_t len) {
+    return (len + CHECKSUM_BLOCK - 1) / CHECKSUM_BLOCK;
+}
+
+/**
+ * @brief Digest of block @p b of a buffer.
+ */
+uint64_t checksum_block(const void* data, size_t len, size_t b);
+
+/**
+ * @brief Fold the block digests of a buffer into its checksum_blocks() value.
+ * @param digests Digests of blocks [0, checksum_block_count(len)).
+ * @param len Buffer length in bytes.
+ */
+uint64_t checksum_combine(const uint64_t* digests, size_t len);
+
+/**
+ * @brief Block-parallel checksum (OpenMP across CHECKSUM_BLOCK blocks).
+ * @note Equals checksum64(data, len, 0) for buffers of at most one block.
+ */
+uint64_t checksum_blocks(const void* data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // CHECKSUM_H
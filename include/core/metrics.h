@@ -0,0 +1,239 @@
+/**
+ * Copyright © 2025 Austin Berrio
+ * @file core/metrics.h
+ * @brief Lock-free latency and throughput histograms with text and JSON dumps.
+ *
+ * Histograms use HDR-style log-linear buckets: values below 2^HISTOGRAM_SUB_BITS
+ * are counted exactly, larger values fall into one of HISTOGRAM_SUB_COUNT
+ * linear sub-buckets per power of two, so every recorded value is kept to
+ * within 1 / HISTOGRAM_SUB_COUNT of its magnitude over the full uint64 range.
+ *
+ * Recording is a handful of relaxed atomic adds and is safe from any thread.
+ * Counters are striped over HISTOGRAM_SHARDS cache-line aligned shards picked
+ * per thread, so concurrent writers rarely touch the same line. Only
+ * registering a new histogram takes the registry mutex (never the logger's);
+ * snapshots read the counters without stopping writers.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HISTOGRAM_SUB_BITS 4
+#define HISTOGRAM_SUB_COUNT (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_COUNT)
+
+#define HISTOGRAM_SHARDS 8  // writer stripes; threads are spread over them
+
+#define METRICS_MAX 32
+#define METRICS_NAME_MAX 48
+#define METRICS_UNIT_MAX 16
+
+/**
+ * @name Serving Metrics
+ * Names of the request-level histograms recorded by the serving engine.
+ * @{
+ */
+
+#define METRIC_QUEUE_US "queue_us" /**< Enqueue to admission. */
+#define METRIC_TTFT_US "ttft_us" /**< Enqueue to first sampled token. */
+#define METRIC_ITL_US "itl_us" /**< Between consecutive tokens of a request. */
+#define METRIC_PREFILL_TOK_S "prefill_tok_s" /**< Prompt tokens per second of a step. */
+#define METRIC_DECODE_TOK_S "decode_tok_s" /**< Generated tokens per second of a step. */
+#define METRIC_BATCH_OCCUPANCY "batch_occupancy_pct" /**< Rows used per step. */
+#define METRIC_KV_UTILIZATION "kv_utilization_pct" /**< Cached positions in use. */
+
+/** @} */
+
+/**
+ * @brief Counters written by a subset of threads.
+ */
+typedef struct HistogramShard {
+    alignas(64) _Atomic uint64_t count; /**< Number of recorded values. */
+    _Atomic uint64_t sum; /**< Sum of recorded values. */
+    _Atomic uint64_t buckets[HISTOGRAM_BUCKETS]; /**< Counts per bucket. */
+} HistogramShard;
+
+/**
+ * @brief Log-linear histogram of uint64 values.
+ */
+typedef struct Histogram {
+    char name[METRICS_NAME_MAX]; /**< Metric name. */
+    char unit[METRICS_UNIT_MAX]; /**< Unit of recorded values. */
+    alignas(64) _Atomic uint64_t min; /**< Smallest recorded value (UINT64_MAX if empty). */
+    _Atomic uint64_t max; /**< Largest recorded value. */
+    HistogramShard shards[HISTOGRAM_SHARDS]; /**< Striped counters. */
+} Histogram;
+
+/**
+ * @brief Point-in-time summary of a histogram.
+ */
+typedef struct HistogramSnapshot {
+    const char* name; /**< Metric name (borrowed). */
+    const char* unit; /**< Unit (borrowed). */
+    uint64_t count; /**< Number of values. */
+    uint64_t sum; /**< Sum of values. */
+    uint64_t min; /**< Smallest value (0 if empty). */
+    uint64_t max; /**< Largest value. */
+    double mean; /**< sum / count. */
+    double p50; /**< Median. */
+    double p90; /**< 90th percentile. */
+    double p99; /**< 99th percentile. */
+    double p999; /**< 99.9th percentile. */
+} HistogramSnapshot;
+
+/**
+ * @brief Registry of named histograms.
+ */
+typedef struct Metrics {
+    Histogram* histograms[METRICS_MAX]; /**< Registered histograms. */
+    _Atomic int count; /**< Number of registered histograms. */
+    pthread_mutex_t lock; /**< Serializes registration only. */
+} Metrics;
+
+/**
+ * @name Histograms
+ * @{
+ */
+
+/**
+ * @brief Bucket index of a value.
+ */
+static inline int histogram_bucket(uint64_t value) {
+    if (value < HISTOGRAM_SUB_COUNT) {
+        return (int) value;
+    }
+    const int exp = 63 - __builtin_clzll(value);  // >= HISTOGRAM_SUB_BITS
+    const int shift = exp - HISTOGRAM_SUB_BITS;
+    const int sub = (int) (value >> shift) - HISTOGRAM_SUB_COUNT;
+    return (shift + 1) * HISTOGRAM_SUB_COUNT + sub;
+}
+
+/**
+ * @brief Shard of the calling thread, or -1 before its first record.
+ */
+extern _Thread_local int histogram_thread_shard;
+
+/**
+ * @brief Assign the calling thread a shard (round-robin).
+ */
+int histogram_shard_assign(void);
+
+/**
+ * @brief Record one value. Lock-free and safe from any thread.
+ * @param h Histogram (NULL is ignored).
+ * @param value Value in the histogram's unit.
+ */
+static inline void histogram_record(Histogram* h, uint64_t value) {
+    if (!h) {
+        return;
+    }
+    if (histogram_thread_shard < 0) {
+        histogram_thread_shard = histogram_shard_assign();
+    }
+    HistogramShard* shard = &h->shards[histogram_thread_shard];
+    atomic_fetch_add_explicit(&shard->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&shard->sum, value, memory_order_relaxed);
+    atomic_fetch_add_explicit(&shard->buckets[histogram_bucket(value)], 1, memory_order_relaxed);
+
+    // Extremes are written only when they move, so the line stays shared
+    uint64_t cur = atomic_load_explicit(&h->min, memory_order_relaxed);
+    while (value < cur
+           && !atomic_compare_exchange_weak_explicit(
+               &h->min, &cur, value, memory_order_relaxed, memory_order_relaxed
+           )) {}
+    cur = atomic_load_explicit(&h->max, memory_order_relaxed);
+    while (value > cur
+           && !atomic_compare_exchange_weak_explicit(
+               &h->max, &cur, value, memory_order_relaxed, memory_order_relaxed
+           )) {}
+}
+
+/**
+ * @brief Monotonic clock in nanoseconds, for computing recorded durations.
+ */
+static inline uint64_t metrics_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+/**
+ * @brief Value at a percentile (0..100), to within the bucket resolution.
+ */
+double histogram_percentile(Histogram* h, double percentile);
+
+/**
+ * @brief Summarize a histogram.
+ */
+HistogramSnapshot histogram_snapshot(Histogram* h);
+
+/**
+ * @brief Clear all recorded values.
+ * @note Values recorded concurrently with a reset may be partially kept.
+ */
+void histogram_reset(Histogram* h);
+
+/** @} */
+
+/**
+ * @name Registry
+ * @{
+ */
+
+/**
+ * @brief Process-wide registry used by the serving engine.
+ */
+extern Metrics metrics_global;
+
+/**
+ * @brief Find or create a histogram.
+ * Call once and keep the pointer; recording through it never locks.
+ * @param m Registry.
+ * @param name Metric name.
+ * @param unit Unit of recorded values.
+ * @return Histogram, or NULL if the registry is full.
+ */
+Histogram* metrics_histogram(Metrics* m, const char* name, const char* unit);
+
+/**
+ * @brief Find a registered histogram by name.
+ * @return Histogram, or NULL if there is none.
+ */
+Histogram* metrics_find(Metrics* m, const char* name);
+
+/**
+ * @brief Clear every histogram of the registry.
+ */
+void metrics_reset(Metrics* m);
+
+/**
+ * @brief Write one line per histogram: count, mean, min, percentiles, max.
+ * @return false on a write error.
+ */
+bool metrics_dump_text(Metrics* m, FILE* stream);
+
+/**
+ * @brief Write the registry as a JSON object keyed by metric name.
+ * @return false on a write error.
+ */
+bool metrics_dump_json(Metrics* m, FILE* stream);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // METRICS_H
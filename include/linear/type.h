@@ -115,6 +115,13 @@ const char* type_name(TypeId id);
  */
 uint32_t type_size(TypeId id);
 
+/**
+ * @brief Look up a type identifier by name.
+ * @param name Type name (e.g. "q8").
+ * @return Type identifier, or TYPE_COUNT if unknown.
+ */
+TypeId type_id(const char* name);
+
 /** @} */
 
 #ifdef __cplusplus
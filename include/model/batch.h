@@ -0,0 +1,127 @@
+/**
+ * @file batch.h
+ * @brief Batched forward pass over independent sequences.
+ * @copyright Copyright © 2025 Austin Berrio
+ *
+ * A Batch holds one token per row. Each row carries its own position and an
+ * optional set of layer caches, so rows may belong to different sequences
+ * (continuous batching) or to the same sequence (chunked prefill). Weight rows
+ * are decoded once per step and shared by every row in the batch.
+ *
+ * Every row writes its K/V entry before any row attends, so consecutive
+ * positions of one sequence may be prefilled in a single step.
+ *
+ * Rows may instead address a paged sequence (see paged.h); its block for the
+ * row's position is reserved, and copied if shared, before the step runs.
+ */
+
+#ifndef VALERIE_BATCH_H
+#define VALERIE_BATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "linear/tensor.h"
+#include "model/valerie.h"
+#include "model/paged.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct Batch
+ * @brief Per-step inputs and activation buffers for forward_batch().
+ * @note Activations are TYPE_F32 matrices with one row per batch row.
+ */
+typedef struct Batch {
+    int capacity;  // maximum rows per step
+    int n;  // active rows
+    int n_out;  // rows with logits after the last step
+
+    // Row inputs (capacity,)
+    int* ids;  // token ids
+    int* pos;  // sequence positions
+    Cache** kv;  // per-row layer caches (NULL selects the model caches)
+    KVSeq** seq;  // per-row paged caches (NULL selects kv)
+    KVPool* pool;  // block pool of paged rows
+    bool* want;  // rows that need logits
+    int* out;  // row -> logits row, or -1
+
+    // Activations
+    Tensor x;  // (capacity, d_model) residual stream
+    Tensor x_norm;  // (capacity, d_model) normalized stream
+    Tensor q;  // (capacity, proj_dim)
+    Tensor k;  // (capacity, kv_dim)
+    Tensor v;  // (capacity, kv_dim)
+    Tensor attn_scores;  // (capacity * heads, seq_len)
+    Tensor attn_out;  // (capacity, proj_dim)
+    Tensor logits;  // (capacity, vocab_size) compacted wanted rows, allocated on first use
+} Batch;
+
+/**
+ * @brief Allocate a batch for up to @p capacity rows.
+ * @return Batch (capacity is 0 on failure)
+ */
+Batch batch_new(const Dim* d, int capacity);
+void batch_free(Batch* b);
+
+/**
+ * @brief Reset the batch to zero rows.
+ */
+void batch_clear(Batch* b);
+
+/**
+ * @brief Append a token to the batch.
+ *
+ * @param b      Batch
+ * @param id     Token id
+ * @param pos    Position of the token in its sequence
+ * @param kv     Layer caches of the sequence (NULL selects the model caches)
+ * @param logits Whether the row needs output logits
+ * @return Row index, or -1 if the batch is full
+ */
+int batch_push(Batch* b, int id, int pos, Cache* kv, bool logits);
+
+/**
+ * @brief Append a token whose keys and values live in a paged sequence.
+ * @note b->pool must be set to the pool that owns @p seq.
+ *
+ * @return Row index, or -1 if the batch is full
+ */
+int batch_push_paged(Batch* b, int id, int pos, KVSeq* seq, bool logits);
+
+/**
+ * @brief Logits of a row pushed with logits enabled.
+ * @return Pointer to (vocab_size,) floats, or NULL if the row has none
+ */
+float* batch_logits(Batch* b, int row);
+
+/**
+ * @brief Forward every row of the batch through the model.
+ *
+ * Only rows pushed with logits enabled are projected onto the vocabulary.
+ *
+ * @param v Model
+ * @param b Batch
+ * @return false if a paged row could not reserve its block
+ */
+bool forward_batch(Valerie* v, Batch* b);
+
+/**
+ * @brief Forward every row through the layer stack and the final rmsnorm only.
+ *
+ * The vocabulary projection is skipped and the logits are never touched; row
+ * i of b->x_norm holds the normalized hidden state of row i afterwards.
+ *
+ * @param v Model
+ * @param b Batch
+ * @return false if a paged row could not reserve its block
+ */
+bool forward_batch_hidden(Valerie* v, Batch* b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // VALERIE_BATCH_H
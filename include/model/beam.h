@@ -0,0 +1,92 @@
+/**
+ * @file beam.h
+ * @brief Beam search over a paged, copy-on-write key/value cache.
+ * @copyright Copyright © 2025 Austin Berrio
+ *
+ * Every beam owns a KVSeq. Children are forked from their parent, so all beams
+ * share the prompt blocks and any common prefix; a block is copied only when a
+ * beam writes into a block it still shares. Each step forwards the last token
+ * of every live beam in one batch and keeps the best @p width extensions.
+ */
+
+#ifndef VALERIE_BEAM_H
+#define VALERIE_BEAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "model/valerie.h"
+#include "model/paged.h"
+#include "model/batch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct Beam
+ * @brief A hypothesis and its cache.
+ */
+typedef struct Beam {
+    KVSeq seq;  // paged cache (shares blocks with related beams)
+    int* ids;  // generated ids (max_tokens,), eos excluded
+    int n;  // number of generated ids
+    float score;  // sum of token log-probabilities
+    bool done;  // closed by eos or a length limit
+} Beam;
+
+/**
+ * @struct BeamCandidate
+ * @brief A scored extension of a beam (token -1 keeps a finished beam).
+ */
+typedef struct BeamCandidate {
+    float score;
+    int parent;
+    int token;
+} BeamCandidate;
+
+/**
+ * @struct BeamSearch
+ * @brief Beam search state bound to a model.
+ */
+typedef struct BeamSearch {
+    Valerie* v;  // borrowed model
+    KVPool pool;  // shared block pool
+    Batch batch;  // one row per live beam
+    Beam* beams;  // current beams (width,)
+    Beam* next;  // beams of the next step (width,)
+    BeamCandidate* candidates;  // (width * (width + 1),)
+    int* rows;  // batch row of each beam (width,)
+    int n_beams;  // beams in use
+    int width;  // beam width
+    int max_tokens;  // generation limit per beam
+    int eos;  // end-of-sequence id
+    float length_penalty;  // final score = score / n^length_penalty
+} BeamSearch;
+
+/**
+ * @brief Create a beam search decoder.
+ *
+ * @param v          Model (not owned)
+ * @param width      Number of beams
+ * @param max_tokens Generation limit per beam
+ * @return BeamSearch (width is 0 on failure)
+ */
+BeamSearch beam_new(Valerie* v, int width, int max_tokens);
+void beam_free(BeamSearch* bs);
+
+/**
+ * @brief Run beam search from a prompt.
+ *
+ * @param bs       Beam search
+ * @param prompt   Prompt ids (at least one)
+ * @param n_prompt Number of prompt ids
+ * @return Index of the best beam in bs->beams, or -1 on failure
+ */
+int beam_search(BeamSearch* bs, const int* prompt, int n_prompt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // VALERIE_BEAM_H
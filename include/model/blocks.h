@@ -22,6 +22,8 @@
 extern "C" {
 #endif
 
+#define FFN_TILE 64  // hidden units per FFN tile (default, a multiple of Q8_BLOCK_SIZE)
+
 /**
  * @brief Root-mean-square normalization (RMSNorm) for 1D vectors.
  * @ref https://arxiv.org/abs/1910.07467
@@ -46,6 +48,19 @@ void rmsnorm(Tensor* y, Tensor* w, Tensor* x);
  */
 void matmul(Tensor* y, Tensor* W, Tensor* x);
 
+/**
+ * @brief Batched matrix multiply: each weight row is dequantized once and
+ *        reused for every input row.
+ *
+ * Y[i] = W @ X[i] for i in [0, n)
+ *
+ * @param Y Output tensor (float matrix, shape [>= n, rows])
+ * @param W Weight matrix (any type, shape [rows, cols])
+ * @param X Input tensor (float matrix, shape [>= n, cols])
+ * @param n Number of active input rows
+ */
+void matmul_batch(Tensor* Y, Tensor* W, Tensor* X, size_t n);
+
 /**
  * @brief In-place rotary position embedding on a float buffer.
  * @ref https://arxiv.org/abs/2104.09864
@@ -87,14 +102,32 @@ void residual(Tensor* dst, Tensor* src);
  */
 void forward_attn(Valerie* v, Layer* L, int pos);
 
+/**
+ * @brief Chunked SwiGLU feed-forward: y += W2 @ (silu(W3 @ x) * (W1 @ x)).
+ *
+ * The hidden dimension is processed in tiles: W1/W3 rows of a tile, SwiGLU,
+ * then that tile's W2 columns, so the hidden activations never exist beyond
+ * one tile per thread and stay cache-resident. Threads, tile width (default
+ * FFN_TILE), chunk and prefetch distance come from the TUNE_OP_FFN or
+ * TUNE_OP_FFN_BATCH entry of the W1 shape (see tune.h).
+ *
+ * @param y   Output rows accumulated in place (float, shape [n, d_model])
+ * @param ffn Feed-forward weights
+ * @param x   Normalized input rows (float, shape [n, d_model])
+ * @param n   Number of rows
+ * @return false if thread scratch cannot be allocated (y is left unchanged)
+ */
+bool ffn_chunked(float* y, FeedForward* ffn, const float* x, size_t n);
+
 /**
  * @brief Feed-forward network block (forward pass).
  * @ref https://deeplearningbook.org/contents/mlp.html#pf1
  *
  * @param v Model (Valerie*)
  * @param L Layer (Layer*)
+ * @return false if the feed-forward kernel fails
  */
-void forward_ffn(Valerie* v, Layer* L);
+bool forward_ffn(Valerie* v, Layer* L);
 
 /**
  * @brief Full single-token forward pass (autoregressive).
@@ -103,7 +136,7 @@ void forward_ffn(Valerie* v, Layer* L);
  * @param v   Model (Valerie*)
  * @param id  Token ID (int)
  * @param pos Position in sequence (int)
- * @return Pointer to output logits (float*)
+ * @return Pointer to output logits (float*), or NULL if a buffer cannot be allocated
  */
 float* forward(Valerie* v, int id, int pos);
 
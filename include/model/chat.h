@@ -0,0 +1,136 @@
+/**
+ * @file chat.h
+ * @brief Chat completions engine with multi-turn KV cache reuse.
+ * @copyright Copyright © 2025 Austin Berrio
+ *
+ * Messages are rendered with the tokenizer's special tokens:
+ *
+ *   <bos>role\ncontent<eos>
+ *
+ * and every reply is opened with `<bos>assistant\n`. The engine owns a Session
+ * whose position always matches the layer KV caches, so each new message only
+ * prefills its own tokens (the delta) instead of replaying the conversation.
+ *
+ * Stop sequences are matched incrementally on token ids (KMP), one id at a
+ * time, as tokens are sampled.
+ */
+
+#ifndef VALERIE_CHAT_H
+#define VALERIE_CHAT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "model/valerie.h"
+#include "model/session.h"
+#include "model/grammar.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @enum ChatRole
+ * @brief Message author for the role template.
+ */
+typedef enum ChatRole {
+    CHAT_ROLE_SYSTEM,
+    CHAT_ROLE_USER,
+    CHAT_ROLE_ASSISTANT,
+    CHAT_ROLE_COUNT,
+} ChatRole;
+
+/**
+ * @struct ChatStop
+ * @brief Stop sequence over token ids with its incremental KMP matcher.
+ */
+typedef struct ChatStop {
+    int* ids;  // stop sequence (len,)
+    int* fail;  // KMP failure table (len,)
+    int len;  // number of ids
+    int matched;  // length of the current partial match
+} ChatStop;
+
+/**
+ * @brief Streaming callback invoked for every generated token.
+ * @return false to stop generation early.
+ */
+typedef bool (*ChatStream)(int id, void* ctx);
+
+/**
+ * @struct Chat
+ * @brief Multi-turn chat state bound to a model.
+ */
+typedef struct Chat {
+    Valerie* v;  // borrowed model (caches are owned by the layers)
+    Session session;  // tokens consumed by forward()
+    int* pending;  // tokens queued for the next prefill (capacity,)
+    int n_pending;  // number of queued tokens
+    ChatStop* stops;  // stop sequences
+    int n_stops;  // number of stop sequences
+    int bos;  // beginning-of-sequence id
+    int eos;  // end-of-sequence id
+    int max_tokens;  // generation limit per reply
+    float temperature;  // 0 selects greedy decoding
+    Grammar* grammar;  // optional reply constraint (not owned)
+} Chat;
+
+/**
+ * @brief Create a chat engine bound to a model.
+ *
+ * @param v Model (not owned)
+ * @return Chat with empty history (session.ids is NULL on failure, including
+ *         when the tokenizer has no bos or eos token)
+ */
+Chat chat_new(Valerie* v);
+
+/**
+ * @brief Free the chat history and stop sequences (the model is not freed).
+ */
+void chat_free(Chat* c);
+
+/**
+ * @brief Register a stop sequence; generation halts once its ids are produced.
+ *
+ * @param c    Chat
+ * @param text Stop text, encoded with the model tokenizer
+ * @return true on success
+ */
+bool chat_add_stop(Chat* c, const char* text);
+
+/**
+ * @brief Queue a message; it is prefilled lazily by the next chat_reply().
+ *
+ * @return true on success, false if the message does not fit in the context
+ */
+bool chat_push(Chat* c, ChatRole role, const char* content);
+
+/**
+ * @brief Append a message and generate the assistant reply.
+ *
+ * Only queued tokens are forwarded before sampling. The sampled ids are passed
+ * to @p stream as they are produced and the reply is closed with <eos>.
+ * When a grammar is set, disallowed tokens are masked before every sample.
+ *
+ * @param c       Chat
+ * @param role    Author of @p content
+ * @param content Message text (may be NULL to reply without a new message)
+ * @param stream  Token callback (may be NULL)
+ * @param ctx     Callback context
+ * @return Number of generated tokens, or -1 on failure (e.g. context is full)
+ */
+int chat_reply(Chat* c, ChatRole role, const char* content, ChatStream stream, void* ctx);
+
+/**
+ * @brief Sample a token id from logits.
+ *
+ * Greedy when @p temperature <= 0, otherwise samples from softmax(logits / T).
+ * The logits buffer is overwritten.
+ */
+int chat_sample(float* logits, int n, float temperature);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // VALERIE_CHAT_H
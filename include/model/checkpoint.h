@@ -0,0 +1,239 @@
+/**
+ * @file checkpoint.h
+ * @brief Model checkpoints: an aligned tensor file with a trailing directory.
+ * @copyright Copyright © 2025 Austin Berrio
+ *
+ * File layout (native endian):
+ *   [CheckpointHeader]           magic, version, model params, directory offset
+ *   For each tensor:
+ *     [pad]                      zeros up to a multiple of CHECKPOINT_ALIGN
+ *     [row[rows]]                rows encoded as the tensor's dtype
+ *   [CheckpointEntry[n]]         tensor directory (name, dtype, shape, extent, checksum)
+ *
+ * Rows are stored in the layout the kernels decode: dense types are packed
+ * row-major, Q8 rows are [q[cols] | w[cols / Q8_BLOCK_SIZE]]. The directory is
+ * written last, so tensors can be streamed out one at a time without knowing
+ * their count or sizes up front.
+ *
+ * Readers map the file and decode tensors on demand, converting between types
+ * when the destination differs from the stored dtype. Pages of a tensor can be
+ * dropped once it has been consumed, which bounds memory when converting
+ * checkpoints larger than RAM.
+ *
+ * Every tensor carries a checksum_blocks() digest of its encoded bytes, and the
+ * header carries one of the directory. The directory is checked at open. Tensors
+ * are checked as they are read (Checkpoint.verify, on by default), which costs
+ * one extra pass over bytes already being touched and runs in parallel with the
+ * other tensors being loaded, or all at once with checkpoint_verify_all().
+ */
+
+#ifndef VALERIE_CHECKPOINT_H
+#define VALERIE_CHECKPOINT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "linear/tensor.h"
+#include "linear/type.h"
+#include "model/valerie.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @name Version Macros
+ *  @{
+ */
+#define CHECKPOINT_MAGIC 0x706B6376 /**< Checkpoint file magic value ("vckp", little-endian). */
+#define CHECKPOINT_VERSION 2 /**< Checkpoint format version. */
+
+/** @} */
+
+#define CHECKPOINT_ALIGN 64  // tensor data alignment in bytes
+#define CHECKPOINT_NAME_MAX 48
+
+/**
+ * @struct CheckpointHeader
+ * @brief On-disk file header. Sized without padding.
+ */
+typedef struct CheckpointHeader {
+    int32_t magic;
+    int32_t version;
+    int32_t q8_block;  // Q8_BLOCK_SIZE the rows were encoded with
+    int32_t dtype;  // TypeId of the layer weights
+    Params params;  // model hyperparameters
+    int32_t n_tensors;
+    uint64_t dir_offset;  // byte offset of the directory
+    uint64_t dir_checksum;  // checksum64 of the directory
+} CheckpointHeader;
+
+/**
+ * @struct CheckpointEntry
+ * @brief Directory entry of one tensor.
+ */
+typedef struct CheckpointEntry {
+    char name[CHECKPOINT_NAME_MAX];  // e.g. "layers.0.attn.Wq"
+    int32_t dtype;  // TypeId of the stored rows
+    int32_t rows;  // 1 for vectors
+    int32_t cols;
+    int32_t is_mat;  // shape is a matrix (even with a single row)
+    uint64_t offset;  // byte offset of the first row
+    uint64_t size;  // encoded size in bytes
+    uint64_t checksum;  // checksum_blocks of the encoded bytes
+} CheckpointEntry;
+
+/**
+ * @struct Checkpoint
+ * @brief Read-only mapping of a checkpoint file.
+ */
+typedef struct Checkpoint {
+    uint8_t* map;  // whole file
+    size_t size;  // file size in bytes
+    CheckpointHeader header;
+    const CheckpointEntry* entries;  // directory (points into map)
+    bool verify;  // check each tensor's checksum when it is read (default: true)
+} Checkpoint;
+
+/**
+ * @struct CheckpointWriter
+ * @brief Streaming checkpoint writer.
+ */
+typedef struct CheckpointWriter {
+    FILE* file;
+    CheckpointHeader header;
+    CheckpointEntry* entries;  // directory, written on close
+    int capacity;  // allocated entries
+    uint64_t offset;  // end of written data
+} CheckpointWriter;
+
+/**
+ * @name Rows
+ * @{
+ */
+
+/**
+ * @brief Encoded size of one row in bytes.
+ */
+size_t checkpoint_row_size(size_t cols, TypeId dtype);
+
+/**
+ * @brief Check that rows of @p cols columns can be stored as @p dtype.
+ */
+bool checkpoint_dtype_is_valid(size_t cols, TypeId dtype);
+
+/** @} */
+
+/**
+ * @name Reader
+ * @{
+ */
+
+/**
+ * @brief Map a checkpoint and validate its header and directory.
+ * @return Checkpoint, or NULL on failure
+ */
+Checkpoint* checkpoint_open(const char* path);
+
+/**
+ * @brief Unmap a checkpoint.
+ */
+void checkpoint_close(Checkpoint* ck);
+
+/**
+ * @brief Find a tensor by name.
+ * @return Entry, or NULL if there is none
+ */
+const CheckpointEntry* checkpoint_find(const Checkpoint* ck, const char* name);
+
+/**
+ * @brief Decode a stored tensor into @p dst, converting to dst's type.
+ *
+ * Rows are decoded in parallel. @p dst must already have the entry's shape.
+ *
+ * @return false on a shape mismatch, or a checksum mismatch if ck->verify is set
+ */
+bool checkpoint_read(const Checkpoint* ck, const CheckpointEntry* e, Tensor* dst);
+
+/**
+ * @brief Check one tensor against its checksum (blocks in parallel).
+ */
+bool checkpoint_verify(const Checkpoint* ck, const CheckpointEntry* e);
+
+/**
+ * @brief Check every tensor, scheduling all blocks of all tensors in parallel.
+ * @return Number of corrupt tensors (each is logged)
+ */
+int checkpoint_verify_all(const Checkpoint* ck);
+
+/**
+ * @brief Drop the resident pages of a tensor once it is no longer needed.
+ */
+void checkpoint_release(const Checkpoint* ck, const CheckpointEntry* e);
+
+/** @} */
+
+/**
+ * @name Writer
+ * @{
+ */
+
+/**
+ * @brief Create a checkpoint file and reserve its header.
+ *
+ * @param path   Output file path
+ * @param params Model hyperparameters
+ * @param dtype  Type of the layer weights
+ * @return Writer, or NULL on failure
+ */
+CheckpointWriter* checkpoint_writer_new(const char* path, Params params, TypeId dtype);
+
+/**
+ * @brief Append a tensor, encoding its rows (in parallel) as its own type.
+ */
+bool checkpoint_write(CheckpointWriter* w, const char* name, const Tensor* t);
+
+/**
+ * @brief Append a stored tensor of another checkpoint, re-encoded as @p dtype.
+ *
+ * Rows are converted in parallel straight from the source mapping, so only
+ * the output tensor is held in memory. Source pages are released afterwards.
+ * The source is verified first if src->verify is set.
+ */
+bool checkpoint_convert(CheckpointWriter* w, const Checkpoint* src, const CheckpointEntry* e, TypeId dtype);
+
+/**
+ * @brief Write the directory and header, then close the file.
+ * @return false on a write error (the writer is freed either way)
+ */
+bool checkpoint_writer_close(CheckpointWriter* w);
+
+/** @} */
+
+/**
+ * @name Model
+ * @{
+ */
+
+/**
+ * @brief Save every trainable tensor of a model.
+ */
+bool v_model_save(Valerie* v, const char* path);
+
+/**
+ * @brief Build a model from a checkpoint (tensors are read in parallel).
+ *
+ * @param t    Tokenizer (its vocabulary must match the checkpoint)
+ * @param path Checkpoint path
+ * @return Model (layers is NULL on failure)
+ */
+Valerie v_model_load(Tokenizer t, const char* path);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // VALERIE_CHECKPOINT_H
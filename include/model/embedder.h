@@ -0,0 +1,84 @@
+/**
+ * @file embedder.h
+ * @brief Pooled sentence embeddings from the final hidden states.
+ * @copyright Copyright © 2025 Austin Berrio
+ *
+ * An Embedder prefills many short inputs at once: up to n_seqs inputs are in
+ * flight, each in its own paged sequence, and their tokens share every batched
+ * step. The forward pass stops after the final rmsnorm, so neither the batch
+ * nor the model state ever allocates vocabulary logits. Each input yields a
+ * single (d_model,) vector pooled over its positions.
+ */
+
+#ifndef VALERIE_EMBEDDER_H
+#define VALERIE_EMBEDDER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "model/valerie.h"
+#include "model/paged.h"
+#include "model/batch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @enum EmbedPool
+ * @brief How hidden states are reduced to one vector per input.
+ */
+typedef enum EmbedPool {
+    EMBED_POOL_MEAN,  // average over all positions
+    EMBED_POOL_LAST,  // hidden state of the last position
+} EmbedPool;
+
+/**
+ * @struct Embedder
+ * @brief Batched embedding extraction bound to a model.
+ */
+typedef struct Embedder {
+    Valerie* v;  // borrowed model
+    KVPool pool;  // blocks for the sequences in flight
+    Batch batch;  // shared step buffers (no logits)
+    KVSeq* seqs;  // one paged cache per session (n_seqs,)
+    int* input;  // input index of each session, or -1 (n_seqs,)
+    int* cursor;  // next position of each session (n_seqs,)
+    int n_seqs;  // sessions in flight
+    EmbedPool pooling;  // reduction over positions
+    bool normalize;  // scale every vector to unit L2 norm
+} Embedder;
+
+/**
+ * @brief Create an embedder.
+ *
+ * @param v        Model (not owned)
+ * @param n_seqs   Inputs prefilled concurrently
+ * @param capacity Rows per batched step
+ * @param pooling  Reduction over positions
+ * @return Embedder (n_seqs is 0 on failure)
+ */
+Embedder embedder_new(Valerie* v, int n_seqs, int capacity, EmbedPool pooling);
+void embedder_free(Embedder* e);
+
+/**
+ * @brief Embed a set of token sequences.
+ *
+ * Inputs longer than the context are truncated to seq_len tokens; empty
+ * inputs yield zero vectors.
+ *
+ * @param e    Embedder
+ * @param ids  Token ids of each input (n,)
+ * @param lens Number of ids of each input (n,)
+ * @param n    Number of inputs
+ * @param out  Output vectors, row-major (n, d_model)
+ * @return false on invalid arguments or a failed forward pass; the
+ *         embedder stays usable either way
+ */
+bool embedder_encode(Embedder* e, const int* const* ids, const int* lens, int n, float* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // VALERIE_EMBEDDER_H
@@ -0,0 +1,111 @@
+/**
+ * @file eval.h
+ * @brief Batched perplexity and continuation scoring.
+ * @copyright Copyright © 2025 Austin Berrio
+ *
+ * Each document is cut into windows of at most @p window tokens that start
+ * every @p stride tokens. A window is prefilled as its own sequence and scores
+ * only the targets no earlier window scored, so with stride < window every
+ * target after the first window sees at least window - stride tokens of
+ * context. Up to n_seqs windows are in flight and share every batched step.
+ *
+ * Log-probabilities are computed with a single online log-sum-exp pass over
+ * each row of logits followed by a gather of the target, so no softmax is
+ * ever written out.
+ */
+
+#ifndef VALERIE_EVAL_H
+#define VALERIE_EVAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "model/valerie.h"
+#include "model/paged.h"
+#include "model/batch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct EvalWindow
+ * @brief A window being prefilled by one session.
+ */
+typedef struct EvalWindow {
+    int doc;  // document index, or -1 when the session is idle
+    int begin;  // first position of the window in the document
+    int end;  // one past the last target of the window
+    int score_from;  // first target scored by this window
+    int cursor;  // next document position to push
+} EvalWindow;
+
+/**
+ * @struct Evaluator
+ * @brief Batched scorer bound to a model.
+ */
+typedef struct Evaluator {
+    Valerie* v;  // borrowed model
+    KVPool pool;  // blocks for the windows in flight
+    Batch batch;  // shared step buffers
+    KVSeq* seqs;  // one paged cache per session (n_seqs,)
+    EvalWindow* windows;  // window of each session (n_seqs,)
+    int* targets;  // target id of each batch row, or -1 (capacity,)
+    float* logprobs;  // log-probability of each row's target (capacity,)
+    int n_seqs;  // windows in flight
+    int window;  // tokens per window (<= seq_len)
+    int stride;  // distance between window starts (1..window)
+    size_t n_forward;  // tokens forwarded by the last call
+    size_t n_scored;  // targets scored by the last call
+} Evaluator;
+
+/**
+ * @brief Create an evaluator.
+ *
+ * @param v        Model (not owned)
+ * @param n_seqs   Windows prefilled concurrently
+ * @param capacity Rows per batched step
+ * @param window   Tokens per window (clamped to seq_len)
+ * @param stride   Distance between window starts (clamped to 1..window)
+ * @return Evaluator (n_seqs is 0 on failure)
+ */
+Evaluator eval_new(Valerie* v, int n_seqs, int capacity, int window, int stride);
+void eval_free(Evaluator* e);
+
+/**
+ * @brief Score a set of pre-tokenized documents.
+ *
+ * The first target of document i is ids[i][offsets[i]], so a prompt of
+ * offsets[i] tokens conditions a continuation without being scored itself.
+ * With offsets NULL every token but the first is scored.
+ *
+ * @param e        Evaluator
+ * @param ids      Token ids of each document (n,)
+ * @param lens     Number of ids of each document (n,)
+ * @param offsets  First scored position of each document (n,), or NULL
+ * @param n        Number of documents
+ * @param loglik   Sum of natural log-probabilities of each document (n,)
+ * @param n_tokens Number of scored targets of each document (n,), or NULL
+ * @return false on invalid arguments or a failed forward pass; the
+ *         evaluator stays usable either way
+ */
+bool eval_score(
+    Evaluator* e,
+    const int* const* ids,
+    const int* lens,
+    const int* offsets,
+    int n,
+    double* loglik,
+    int* n_tokens
+);
+
+/**
+ * @brief Perplexity of a set of scored documents: exp(-sum(loglik) / sum(n_tokens)).
+ */
+double eval_perplexity(const double* loglik, const int* n_tokens, int n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // VALERIE_EVAL_H
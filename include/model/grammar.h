@@ -0,0 +1,105 @@
+/**
+ * @file grammar.h
+ * @brief Constrained decoding: restrict sampled tokens to a regular language.
+ * @copyright Copyright © 2025 Austin Berrio
+ *
+ * A pattern is compiled into a Thompson NFA whose DFA is built lazily, one
+ * state and one byte transition at a time. For every DFA state that is reached
+ * the grammar computes, once, a bitmask over the vocabulary of the tokens that
+ * keep the output inside the language. Masking logits is then a single pass
+ * over vocab_size / 64 words, and the cached masks make constrained decoding
+ * cost about the same as unconstrained decoding.
+ *
+ * Supported syntax (byte oriented, always anchored at both ends):
+ *   literals, `.`, `[...]`, `[^...]`, `(...)`, `(?:...)`, `|`,
+ *   `*`, `+`, `?`, `{m}`, `{m,}`, `{m,n}`,
+ *   `\d \D \w \W \s \S \n \r \t \xHH` and escaped metacharacters.
+ *
+ * JSON output is supported through a generated pattern with bounded nesting.
+ */
+
+#ifndef VALERIE_GRAMMAR_H
+#define VALERIE_GRAMMAR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tokenizer/model.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GRAMMAR_MAX_STATES (1 << 16)  // DFA state limit per grammar
+#define GRAMMAR_MAX_REPEAT 1024  // upper bound for {m,n}
+
+/**
+ * @brief Compiled automaton, lazily built DFA, and current decoding state.
+ * @note A Grammar is not thread-safe; use one per sequence.
+ */
+typedef struct Grammar Grammar;
+
+/**
+ * @brief Compile a regular expression for a tokenizer vocabulary.
+ *
+ * @param t       Tokenizer (not owned)
+ * @param pattern Regular expression (see file documentation)
+ * @return Grammar, or NULL if the pattern is invalid
+ */
+Grammar* grammar_new(Tokenizer* t, const char* pattern);
+
+/**
+ * @brief Compile a grammar for a JSON value with at most @p depth nested
+ *        objects or arrays.
+ */
+Grammar* grammar_json(Tokenizer* t, int depth);
+
+void grammar_free(Grammar* g);
+
+/**
+ * @brief Return to the start state (the DFA and masks are kept).
+ */
+void grammar_reset(Grammar* g);
+
+/**
+ * @brief Allowed-token bitmask of the current state.
+ *
+ * Bit (id % 64) of word (id / 64) is set when token @p id may be sampled next.
+ * The end-of-sequence token is allowed only in accepting states.
+ *
+ * @return Mask of (vocab_size + 63) / 64 words owned by the grammar
+ */
+const uint64_t* grammar_mask(Grammar* g);
+
+/**
+ * @brief Set the logits of disallowed tokens to -INFINITY.
+ *
+ * @param g      Grammar
+ * @param logits Logits (vocab_size,)
+ * @return false if no token is allowed
+ */
+bool grammar_apply(Grammar* g, float* logits);
+
+/**
+ * @brief Advance the grammar by a sampled token.
+ *
+ * @return false if the token is not allowed (the state is unchanged)
+ */
+bool grammar_accept(Grammar* g, int id);
+
+/**
+ * @brief Whether the output so far is a complete match.
+ */
+bool grammar_is_accepting(Grammar* g);
+
+/**
+ * @brief Whether the end-of-sequence token has been accepted.
+ */
+bool grammar_is_done(const Grammar* g);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // VALERIE_GRAMMAR_H
@@ -0,0 +1,125 @@
+/**
+ * @file paged.h
+ * @brief Paged key/value cache with reference-counted, copy-on-write blocks.
+ * @copyright Copyright © 2025 Austin Berrio
+ *
+ * A KVPool hands out fixed-size blocks, each holding block_size positions of
+ * K and V for every layer. A KVSeq maps positions to blocks through a block
+ * table. Forking a sequence copies only its table and bumps the block
+ * reference counts; a shared block is copied the first time one of its owners
+ * writes to it. Memory therefore grows with how far sequences diverge, not
+ * with how many of them share a prefix.
+ *
+ * Blocks are allocated on first use and recycled through a free list.
+ */
+
+#ifndef VALERIE_PAGED_H
+#define VALERIE_PAGED_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "model/valerie.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define KV_BLOCK_SIZE 16  // default positions per block
+
+/**
+ * @struct KVPool
+ * @brief Block allocator shared by paged sequences.
+ */
+typedef struct KVPool {
+    float** data;  // block storage (max_blocks,) of (layers, 2, block_size, kv_dim)
+    int* refs;  // reference count per block (max_blocks,)
+    int* free;  // free block stack (max_blocks,)
+    int n_free;  // blocks on the free stack
+    int n_alloc;  // blocks with storage (used or free)
+    int max_blocks;  // pool capacity
+    int block_size;  // positions per block
+    int layers;  // model depth
+    int kv_dim;  // key/value width
+    int used;  // blocks with refs > 0
+    int peak;  // high-water mark of used
+    int copies;  // copy-on-write block copies
+} KVPool;
+
+/**
+ * @struct KVSeq
+ * @brief Block table of a single sequence.
+ */
+typedef struct KVSeq {
+    int* blocks;  // block ids (capacity,)
+    int n_blocks;  // mapped blocks
+    int capacity;  // ceil(seq_len / block_size)
+} KVSeq;
+
+/**
+ * @brief Create a pool of at most @p max_blocks blocks.
+ * @return KVPool (max_blocks is 0 on failure)
+ */
+KVPool kv_pool_new(const Dim* d, int max_blocks, int block_size);
+void kv_pool_free(KVPool* pool);
+
+/**
+ * @brief Number of floats in one block.
+ */
+size_t kv_block_floats(const KVPool* pool);
+
+/**
+ * @brief Take a block with a reference count of one.
+ * @return Block id, or -1 if the pool is exhausted
+ */
+int kv_pool_alloc(KVPool* pool);
+
+/**
+ * @brief Drop one reference to a block; it is recycled at zero.
+ */
+void kv_pool_release(KVPool* pool, int id);
+
+/**
+ * @brief Create an empty sequence for a model's context length.
+ * @return KVSeq (blocks is NULL on failure)
+ */
+KVSeq kv_seq_new(const KVPool* pool, const Dim* d);
+
+/**
+ * @brief Release a sequence's blocks and free its table.
+ */
+void kv_seq_free(KVPool* pool, KVSeq* seq);
+
+/**
+ * @brief Release a sequence's blocks but keep its table for reuse.
+ */
+void kv_seq_clear(KVPool* pool, KVSeq* seq);
+
+/**
+ * @brief Share every block of @p src with @p dst (no data is copied).
+ * @note dst must be empty.
+ */
+bool kv_seq_fork(KVPool* pool, KVSeq* dst, const KVSeq* src);
+
+/**
+ * @brief Make the block holding @p pos present and exclusively owned,
+ *        copying it if it is shared.
+ * @return false if the pool is exhausted or pos is out of range
+ */
+bool kv_seq_reserve(KVPool* pool, KVSeq* seq, int pos);
+
+/**
+ * @brief Key row of a layer at a position (kv_dim,).
+ */
+float* kv_key(const KVPool* pool, const KVSeq* seq, int layer, int pos);
+
+/**
+ * @brief Value row of a layer at a position (kv_dim,).
+ */
+float* kv_value(const KVPool* pool, const KVSeq* seq, int layer, int pos);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // VALERIE_PAGED_H
@@ -0,0 +1,124 @@
+/**
+ * @file prefetch.h
+ * @brief Software prefetch for weights streamed through the decode pipeline.
+ * @copyright Copyright © 2025 Austin Berrio
+ *
+ * Decoding reads every weight once per token in a fixed order (layer 0 Wq..W3,
+ * layer 1, ..., output projection), so the next bytes are always known ahead
+ * of use. Two mechanisms exploit that:
+ *
+ *   - The matmul kernels prefetch rows a tunable distance ahead of the row
+ *     being multiplied (TuneConfig.prefetch, default PREFETCH_DISTANCE).
+ *   - An optional helper thread reads the next layer's weights into the
+ *     shared last-level cache while the current layer computes.
+ *
+ * The helper only pays off with a spare core and a model too large for the
+ * LLC; it is off unless Valerie.prefetch is set.
+ */
+
+#ifndef VALERIE_PREFETCH_H
+#define VALERIE_PREFETCH_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "linear/q8.h"
+#include "linear/tensor.h"
+#include "linear/type.h"
+#include "model/valerie.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PREFETCH_DISTANCE 4  // weight rows ahead (default)
+#define PREFETCH_LINE 64  // cache line size in bytes
+
+/**
+ * @struct Prefetcher
+ * @brief Helper thread that warms one layer's weights at a time.
+ */
+typedef struct Prefetcher {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    Layer* layers;  // model layers (borrowed)
+    Tensor output;  // output projection (shallow copy)
+    int n_layers;
+    int pending;  // next layer to warm (n_layers: output), or -1
+    bool stop;
+    _Atomic size_t warmed;  // layers warmed so far
+} Prefetcher;
+
+/**
+ * @brief Prefetch the bytes of [p, p + len) with high temporal locality.
+ */
+static inline void prefetch_bytes(const void* p, size_t len) {
+    const char* c = (const char*) p;
+    for (size_t i = 0; i < len; i += PREFETCH_LINE) {
+        __builtin_prefetch(c + i, 0, 3);
+    }
+}
+
+/**
+ * @brief Prefetch one weight row (Q8 rows: values and block scales).
+ */
+static inline void prefetch_row(const Tensor* W, size_t r) {
+    const size_t cols = tensor_cols(W);
+    const void* row = tensor_view_row(W, r);
+    if (W->id == TYPE_Q8) {
+        const quant8_t* q = (const quant8_t*) row;
+        prefetch_bytes(q->q, cols);
+        __builtin_prefetch(q->w, 0, 3);
+    } else {
+        prefetch_bytes(row, cols * type_size(W->id));
+    }
+}
+
+/**
+ * @brief Prefetch columns [c0, c0 + len) of one weight row.
+ */
+static inline void prefetch_slice(const Tensor* W, size_t r, size_t c0, size_t len) {
+    const void* row = tensor_view_row(W, r);
+    if (W->id == TYPE_Q8) {
+        const quant8_t* q = (const quant8_t*) row;
+        prefetch_bytes(q->q + c0, len);
+        __builtin_prefetch(q->w + c0 / Q8_BLOCK_SIZE, 0, 3);
+    } else {
+        const size_t size = type_size(W->id);
+        prefetch_bytes((const char*) row + c0 * size, len * size);
+    }
+}
+
+/**
+ * @brief Rows ahead for a configured distance (0: default, < 0: off).
+ */
+static inline size_t prefetch_distance(int configured) {
+    return configured > 0 ? (size_t) configured : (configured < 0 ? 0 : PREFETCH_DISTANCE);
+}
+
+/**
+ * @brief Start the helper thread of a model.
+ * @return Prefetcher, or NULL on failure
+ */
+Prefetcher* prefetch_new(const Valerie* v);
+
+/**
+ * @brief Stop and join the helper thread.
+ */
+void prefetch_free(Prefetcher* p);
+
+/**
+ * @brief Ask the helper to warm a layer (n_layers selects the output projection).
+ *
+ * Returns immediately; a newer request replaces one that has not started.
+ */
+void prefetch_layer(Prefetcher* p, int layer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // VALERIE_PREFETCH_H
@@ -0,0 +1,112 @@
+/**
+ * @file session.h
+ * @brief Session snapshots: persist and restore the KV cache and token history.
+ * @copyright Copyright © 2025 Austin Berrio
+ *
+ * A session tracks the token history consumed by the model. Together with the
+ * layer-wise key/value caches and the residual stream (`State.x`) it fully
+ * describes where a conversation left off.
+ *
+ * Snapshots only store cache rows up to the current position, optionally in a
+ * reduced-precision type, so resuming a conversation costs a single file read
+ * instead of replaying the whole history through `forward()`.
+ *
+ * File layout (native endian):
+ *   [SessionHeader] magic, version, dtype, pos and model dimensions
+ *   [int32[pos]]    token history
+ *   [f32[d_model]]  residual stream (State.x)
+ *   For each layer:
+ *     [row[pos]]    key rows encoded as dtype
+ *     [row[pos]]    value rows encoded as dtype
+ */
+
+#ifndef VALERIE_SESSION_H
+#define VALERIE_SESSION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "linear/type.h"
+#include "model/valerie.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @name Version Macros
+ *  @{
+ */
+#define SESSION_MAGIC 0x6B767373 /**< Session file magic value ("sskv", little-endian). */
+#define SESSION_VERSION 1 /**< Session format version. */
+
+/** @} */
+
+/**
+ * @struct Session
+ * @brief Token history for a single conversation.
+ *
+ * `pos` is the number of tokens already consumed by `forward()` and is
+ * always the position of the next token.
+ */
+typedef struct Session {
+    int* ids;  // token history (capacity,)
+    int pos;  // number of consumed tokens (next position)
+    int capacity;  // maximum context length (seq_len)
+} Session;
+
+/**
+ * @brief Create an empty session sized to the model context length.
+ *
+ * @param d Model dimensions
+ * @return Session with an allocated history buffer (ids is NULL on failure)
+ */
+Session v_session_new(const Dim* d);
+
+/**
+ * @brief Free the session history buffer.
+ *
+ * @param s Session to free (safe to pass NULL)
+ */
+void v_session_free(Session* s);
+
+/**
+ * @brief Record a token that has been consumed at position `s->pos`.
+ *
+ * @param s  Session
+ * @param id Token id
+ * @return true on success, false if the context is full
+ */
+bool v_session_push(Session* s, int id);
+
+/**
+ * @brief Snapshot the model KV cache, residual stream, and session history to disk.
+ *
+ * Only cache rows in [0, s->pos) are written. Rows are encoded as `dtype`,
+ * which may be any supported TypeId (TYPE_F32 for lossless snapshots).
+ *
+ * @param v     Model (caches and state are read)
+ * @param s     Session history
+ * @param dtype Storage type for cached key/value rows
+ * @param path  Output file path
+ * @return true on success, false on failure
+ */
+bool v_session_save(Valerie* v, Session* s, TypeId dtype, const char* path);
+
+/**
+ * @brief Restore a snapshot written by v_session_save().
+ *
+ * The file is memory-mapped and decoded directly into the layer caches and
+ * `State.x`. The session must have been created for the same model dimensions.
+ *
+ * @param v    Model (caches and state are overwritten)
+ * @param s    Session (history and position are overwritten)
+ * @param path Input file path
+ * @return true on success, false on failure or dimension mismatch
+ */
+bool v_session_restore(Valerie* v, Session* s, const char* path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // VALERIE_SESSION_H
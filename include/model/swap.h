@@ -0,0 +1,173 @@
+/**
+ * @file swap.h
+ * @brief Swap cold paged sequences out to a memory-mapped file.
+ * @copyright Copyright © 2025 Austin Berrio
+ *
+ * A KVSwap watches the sequences registered with it. When the pool cannot
+ * supply the blocks a caller asks for, the coldest unpinned sequences (lowest
+ * priority first, then least recently used) write their exclusively owned
+ * blocks to slots of a shared file mapping and return them to the pool.
+ * Blocks shared with other sequences stay resident.
+ *
+ * Paging back in is split in two: kv_swap_prefetch() maps fresh pool blocks
+ * on the calling thread and hands the copies to a background thread, so a
+ * scheduler can start the transfer for a session it will run soon and keep
+ * working on others; kv_swap_acquire() waits for it to finish.
+ *
+ * Slots are stored as raw floats or, when quantized, as Q8 blocks (about a
+ * quarter of the size). The file is unlinked as soon as it is created.
+ *
+ * The pool and the registered sequences are only modified by the caller's
+ * thread; the background thread only copies block contents.
+ */
+
+#ifndef VALERIE_SWAP_H
+#define VALERIE_SWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "model/paged.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @enum KVSwapState
+ * @brief Where a registered sequence lives.
+ */
+typedef enum KVSwapState {
+    KV_SWAP_RESIDENT,  // every block is in the pool
+    KV_SWAP_OUT,  // some blocks are in the swap file
+    KV_SWAP_PAGING_IN,  // blocks are mapped, copies are in flight
+} KVSwapState;
+
+/**
+ * @struct KVSwapEntry
+ * @brief Swap bookkeeping of one registered sequence.
+ */
+typedef struct KVSwapEntry {
+    KVSeq* seq;  // registered sequence (not owned), NULL if the entry is unused
+    int* slots;  // swap slot per block, -1 if resident (seq capacity,)
+    uint64_t last_used;  // LRU clock of the last touch
+    int priority;  // higher priorities are evicted last
+    int pins;  // in use; never evicted while > 0
+    int pending;  // page-in copies in flight
+    KVSwapState state;
+} KVSwapEntry;
+
+/**
+ * @struct KVSwapCopy
+ * @brief A queued page-in copy.
+ */
+typedef struct KVSwapCopy {
+    int entry;
+    int slot;
+    int block;
+} KVSwapCopy;
+
+/**
+ * @struct KVSwap
+ * @brief Swap file and eviction policy for a KVPool.
+ */
+typedef struct KVSwap {
+    KVPool* pool;  // swapped pool (not owned)
+    uint8_t* map;  // shared file mapping
+    size_t map_size;  // bytes mapped
+    size_t slot_bytes;  // bytes per slot (page aligned)
+    int* free_slots;  // free slot stack (n_slots,)
+    int n_free_slots;
+    int n_slots;  // swap capacity in blocks
+    bool quantized;  // Q8 slots instead of raw floats
+
+    KVSwapEntry* entries;  // registered sequences (max_entries,)
+    int max_entries;
+    uint64_t clock;  // LRU clock
+
+    size_t ram_reserve;  // bytes of free RAM new blocks must leave untouched
+
+    // Background page-in
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t work;  // copies queued or shutdown
+    pthread_cond_t done;  // an entry became resident
+    KVSwapCopy* queue;  // ring buffer (n_slots,)
+    int head;
+    int n_queued;
+    bool stop;
+
+    // Statistics
+    size_t swapped_out;  // blocks written to the file
+    size_t swapped_in;  // blocks read back
+} KVSwap;
+
+/**
+ * @brief Create a swap file for @p pool.
+ *
+ * @param pool        Pool to relieve (not owned, must outlive the swap)
+ * @param path        Swap file path (created and unlinked immediately)
+ * @param n_slots     Swap capacity in blocks
+ * @param max_entries Maximum number of registered sequences
+ * @param quantized   Store Q8 blocks instead of raw floats
+ * @return Heap-allocated swap, or NULL on failure
+ */
+KVSwap* kv_swap_new(KVPool* pool, const char* path, int n_slots, int max_entries, bool quantized);
+
+/**
+ * @brief Stop the background thread, unmap the file and free the swap.
+ * @note Registered sequences that are swapped out lose their swapped blocks.
+ */
+void kv_swap_free(KVSwap* sw);
+
+/**
+ * @brief Register a sequence for eviction.
+ * @return Entry handle, or -1 if the table is full
+ */
+int kv_swap_register(KVSwap* sw, KVSeq* seq, int priority);
+
+/**
+ * @brief Forget a sequence (it must be resident or will be cleared).
+ */
+void kv_swap_unregister(KVSwap* sw, int entry);
+
+/**
+ * @brief Make room for @p n_blocks new blocks.
+ *
+ * The pool may grow only while memory_ram_free() stays above ram_reserve;
+ * beyond that, or beyond max_blocks, cold sequences are swapped out.
+ *
+ * @return false if not enough blocks could be freed (reject the request)
+ */
+bool kv_swap_reserve(KVSwap* sw, int n_blocks);
+
+/**
+ * @brief Start paging a sequence back in without waiting.
+ * @return false if there are not enough blocks for it
+ */
+bool kv_swap_prefetch(KVSwap* sw, int entry);
+
+/**
+ * @brief Make a sequence resident, pin it and mark it as recently used.
+ * @return false if it could not be paged in
+ */
+bool kv_swap_acquire(KVSwap* sw, int entry);
+
+/**
+ * @brief Unpin a sequence acquired with kv_swap_acquire().
+ */
+void kv_swap_release(KVSwap* sw, int entry);
+
+/**
+ * @brief Swap out one sequence now, regardless of the policy.
+ * @return Number of blocks written to the file
+ */
+int kv_swap_out(KVSwap* sw, int entry);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // VALERIE_SWAP_H
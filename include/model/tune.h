@@ -0,0 +1,141 @@
+/**
+ * @file tune.h
+ * @brief Kernel autotuner with a per-machine tuning cache.
+ * @copyright Copyright © 2025 Austin Berrio
+ *
+ * The matmul kernels look up a TuneConfig for their (op, dtype, rows, cols)
+ * on every call: the thread count, the number of weight-row tiles each thread
+ * takes at a time (the OpenMP static chunk), how many weight rows are decoded
+ * together so every activation row is reused across them, and how far ahead
+ * rows are prefetched. Shapes without an entry use the defaults.
+ *
+ * The fused feed-forward kernel (ffn_chunked) is keyed by the W1 shape
+ * (hidden, d_model) and uses the same fields: its tile is the number of
+ * hidden units processed end-to-end at a time.
+ *
+ * tune_model() benchmarks candidate configurations for every weight shape of
+ * a model and keeps the fastest. Results are saved to a cache file named after
+ * the CPU model and core count, so each host keeps its own choices and later
+ * runs only pay for shapes they have not seen.
+ *
+ * @note The table is read without locks; populate it before running kernels.
+ */
+
+#ifndef VALERIE_TUNE_H
+#define VALERIE_TUNE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "linear/type.h"
+#include "model/valerie.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TUNE_MAX_ENTRIES 64
+#define TUNE_BATCH_ROWS 16  // activation rows used to benchmark matmul_batch
+
+/**
+ * @enum TuneOp
+ * @brief Tunable kernels.
+ */
+typedef enum TuneOp {
+    TUNE_OP_MATMUL,  // y = W @ x
+    TUNE_OP_MATMUL_BATCH,  // Y = X @ W^T
+    TUNE_OP_FFN,  // y += W2 @ SwiGLU(W1 @ x, W3 @ x), one row
+    TUNE_OP_FFN_BATCH,  // the same over several rows
+    TUNE_OP_COUNT,
+} TuneOp;
+
+/**
+ * @struct TuneConfig
+ * @brief Launch parameters of a kernel (0 selects the default).
+ */
+typedef struct TuneConfig {
+    int threads;  // OpenMP threads (0: omp_get_max_threads())
+    int chunk;  // tiles per static chunk (0: an even split)
+    int tile;  // weight rows decoded together (0: 1); FFN: hidden units (0: FFN_TILE)
+    int prefetch;  // rows prefetched ahead (0: PREFETCH_DISTANCE, < 0: off)
+} TuneConfig;
+
+/**
+ * @struct TuneEntry
+ * @brief Best configuration found for one kernel shape.
+ */
+typedef struct TuneEntry {
+    TuneOp op;
+    TypeId dtype;  // weight type
+    int rows;  // weight rows
+    int cols;  // weight columns
+    TuneConfig config;
+    double ns;  // measured time per call
+} TuneEntry;
+
+/**
+ * @brief Name of a kernel as written to the cache file.
+ */
+const char* tune_op_name(TuneOp op);
+
+/**
+ * @brief Configuration of a kernel shape (defaults if it was never tuned).
+ */
+TuneConfig tune_config(TuneOp op, TypeId dtype, size_t rows, size_t cols);
+
+/**
+ * @brief Add or replace an entry.
+ * @return false if the table is full
+ */
+bool tune_set(const TuneEntry* entry);
+
+/**
+ * @brief Number of entries and a pointer to the table.
+ */
+const TuneEntry* tune_entries(int* count);
+
+/**
+ * @brief Drop every entry (kernels fall back to defaults).
+ */
+void tune_clear(void);
+
+/**
+ * @brief Cache file of this machine: <cache>/valerie/tune-<cpu>-<cores>.txt
+ *
+ * <cache> is $XDG_CACHE_HOME, else $HOME/.cache, else the working directory.
+ *
+ * @return Heap-allocated path (free with path_free), or NULL on failure
+ */
+char* tune_cache_path(void);
+
+/**
+ * @brief Load entries from a cache file.
+ * @return false if the file is missing, malformed or from another machine
+ */
+bool tune_load(const char* path);
+
+/**
+ * @brief Save the table to a cache file, creating its directory.
+ */
+bool tune_save(const char* path);
+
+/**
+ * @brief Benchmark every untuned (op, dtype, shape) used by a model.
+ * @return Number of shapes tuned
+ */
+int tune_model(Valerie* v);
+
+/**
+ * @brief Load this machine's cache, tune what is missing and save it back.
+ *
+ * @param v       Model whose shapes are tuned
+ * @param retune  Ignore the cache and benchmark every shape again
+ * @return false if the cache could not be written
+ */
+bool tune_init(Valerie* v, bool retune);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // VALERIE_TUNE_H
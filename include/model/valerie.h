@@ -153,12 +153,8 @@ typedef struct State {
     Tensor attn_scores;  // (heads, seq_len) attention weights
     Tensor attn_out;  // (d_model,) attention output accumulator
 
-    // Feed-forward intermediates
-    Tensor mlp_in;  // (hidden,)
-    Tensor mlp_gate;  // (hidden,)
-
     // Output
-    Tensor logits;  // (vocab_size,)
+    Tensor logits;  // (vocab_size,) allocated on first use
 } State;
 
 /**
@@ -172,6 +168,7 @@ typedef struct Valerie {
     State state;  // forward-pass working state
     Layer* layers;  // array of transformer layers
     TypeId dtype;
+    struct Prefetcher* prefetch;  // optional next-layer warm-up thread (NULL: off)
 } Valerie;
 
 /**
@@ -203,6 +200,15 @@ void v_ffn_free(FeedForward* ffn);
 Cache v_cache_new(const Dim* d);
 void v_cache_free(Cache* cache);
 
+/**
+ * @brief Allocate a detached set of layer caches (one Cache per layer).
+ *
+ * Used by sequences that do not share the model-owned layer caches,
+ * e.g. concurrent sessions in a batch.
+ */
+Cache* v_caches_new(const Dim* d);
+void v_caches_free(Cache* caches, size_t n);
+
 Layer* v_layers_new(const Dim* d, TypeId dtype);
 void v_layers_free(Layer* layers, size_t n);
 
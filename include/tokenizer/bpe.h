@@ -30,6 +30,18 @@
  */
 #define BPE_VERSION 1
 
+/**
+ * @def BPE_TRAINER_MAGIC
+ * @brief Magic number of trainer checkpoints ("btrn", little-endian).
+ */
+#define BPE_TRAINER_MAGIC 0x6E727462
+
+/**
+ * @def BPE_TRAINER_VERSION
+ * @brief Current version of the trainer checkpoint format.
+ */
+#define BPE_TRAINER_VERSION 1
+
 /**
  * @struct BPEMerge
  * @brief Represents a single merge operation in BPE: a pair of symbols and their frequency.
@@ -62,6 +74,13 @@ typedef struct BPEModel {
     size_t capacity;  ///< Allocated capacity.
 } BPEModel;
 
+/**
+ * @struct BPETrainer
+ * @brief Incremental BPE trainer (opaque): words as symbol ids, live pair
+ *        counts, and the merges made so far.
+ */
+typedef struct BPETrainer BPETrainer;
+
 /**
  * @name BPE serialization
  * @brief Save/load BPE models from disk (binary format).
@@ -124,6 +143,10 @@ HashMap* bpe_merges(HashMap* vocab, const char* best_pair);
 /**
  * @brief Train a BPE model with a fixed number of merge steps.
  *
+ * Produces the same merges as repeating bpe_pairs(), bpe_best() and
+ * bpe_merges(), but keeps pair counts up to date incrementally: each merge
+ * only revisits the words that contain the merged pair.
+ *
  * @param vocab      Input vocabulary (token string -> int* freq). Not consumed or freed.
  * @param n_merges   Number of merges to perform.
  * @param verbose    If true, prints intermediate steps.
@@ -140,4 +163,72 @@ void bpe_free(BPEModel* model);
 
 /** @} */
 
+/**
+ * @name BPE trainer
+ * @brief Train in steps and checkpoint the trainer between them.
+ *
+ * A checkpoint holds the full trainer state, so training resumed from it makes
+ * the same merges as one uninterrupted run, and a finished run can be extended
+ * with more merges later. Layout (native endian):
+ *
+ *   [int32 magic][int32 version]
+ *   [uint64 n_symbols][uint64 n_words][uint64 n_pairs][uint64 n_merges]
+ *   n_symbols x [int32 len][char bytes[len]]          symbol strings by id
+ *   n_words   x [int32 freq][int32 len][int32 ids[len]]  words as symbol ids
+ *   n_pairs   x [int32 a][int32 b][int64 count]       live pair counts
+ *   n_merges  x [int32 len][char pair[len]][int32 freq]  merges so far
+ *
+ * Pair counts are recounted from the words on load and checked against the
+ * saved ones, which catches a corrupt or mismatched file.
+ * @{
+ */
+
+/**
+ * @brief Create a trainer and count the pairs of a vocabulary.
+ *
+ * @param vocab   Input vocabulary (token string -> int* freq). Not consumed or freed.
+ * @return New trainer, or NULL on error. Caller must free with bpe_trainer_free().
+ */
+BPETrainer* bpe_trainer_new(HashMap* vocab);
+
+/**
+ * @brief Perform up to @p n_merges further merge steps.
+ *
+ * @param tr        Trainer.
+ * @param n_merges  Number of merges to perform.
+ * @return Number of merges made (fewer once the pairs are exhausted), or SIZE_MAX on error.
+ */
+size_t bpe_trainer_run(BPETrainer* tr, size_t n_merges);
+
+/**
+ * @brief Merges made so far.
+ *
+ * @return Model owned by the trainer (valid until bpe_trainer_free()).
+ */
+BPEModel* bpe_trainer_model(BPETrainer* tr);
+
+/**
+ * @brief Checkpoint the trainer state.
+ *
+ * The file is written beside @p path and renamed over it, so an interrupted
+ * save leaves the previous checkpoint intact.
+ *
+ * @return true on success, false on error.
+ */
+bool bpe_trainer_save(const BPETrainer* tr, const char* path);
+
+/**
+ * @brief Restore a trainer from a checkpoint.
+ *
+ * @return New trainer, or NULL on error. Caller must free with bpe_trainer_free().
+ */
+BPETrainer* bpe_trainer_load(const char* path);
+
+/**
+ * @brief Free a trainer and the model it owns. Safe to pass NULL.
+ */
+void bpe_trainer_free(BPETrainer* tr);
+
+/** @} */
+
 #endif  // TOKENIZER_BPE_H
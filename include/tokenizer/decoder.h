@@ -0,0 +1,117 @@
+/**
+ * @file      tokenizer/decoder.h
+ * @brief     Streaming (incremental) detokenizer
+ * @copyright Copyright © 2025 Austin Berrio
+ *
+ * A Decoder appends the bytes of one token at a time to a growable buffer and
+ * hands back only the newly completed text. Bytes are held back while they
+ * end in a partial UTF-8 sequence or could still become a stop string, so the
+ * caller never sees half a code point or part of a stop string.
+ *
+ * Stop strings are matched on bytes with an incremental KMP matcher, so the
+ * cost per token is proportional to the token length, not the output length.
+ */
+
+#ifndef TOKENIZER_DECODER_H
+#define TOKENIZER_DECODER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "tokenizer/model.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Stop string with its incremental KMP matcher.
+ */
+typedef struct DecoderStop {
+    char* text; /**< Stop string. */
+    size_t* fail; /**< KMP failure table (len,). */
+    size_t len; /**< Stop string length in bytes. */
+    size_t matched; /**< Length of the current partial match. */
+} DecoderStop;
+
+/**
+ * @brief Incremental decoder state.
+ */
+typedef struct Decoder {
+    Tokenizer* t; /**< Borrowed tokenizer. */
+    char* text; /**< Decoded output (NUL-terminated). */
+    size_t len; /**< Bytes in text. */
+    size_t capacity; /**< Allocated bytes in text. */
+    size_t emitted; /**< Bytes already handed to the caller. */
+    DecoderStop* stops; /**< Stop strings. */
+    size_t n_stops; /**< Number of stop strings. */
+    int stop; /**< Index of the matched stop string, or -1. */
+    bool skip_special; /**< Drop special tokens from the output. */
+} Decoder;
+
+/** @name Decoder life-cycle
+ *  @{
+ */
+
+/**
+ * @brief Create a decoder bound to a tokenizer.
+ *
+ * @param t Tokenizer (not owned).
+ * @return  Decoder (text is NULL on failure).
+ */
+Decoder decoder_new(Tokenizer* t);
+
+/**
+ * @brief Free the output buffer and stop strings.
+ */
+void decoder_free(Decoder* d);
+
+/**
+ * @brief Clear the output and stop matchers; stop strings are kept.
+ */
+void decoder_reset(Decoder* d);
+
+/**
+ * @brief Register a stop string. Output ends before its first occurrence.
+ *
+ * @return true on success.
+ */
+bool decoder_add_stop(Decoder* d, const char* text);
+
+/** @} */
+
+/** @name Streaming
+ *  @{
+ */
+
+/**
+ * @brief Append one token and return the text completed by it.
+ *
+ * @param d   Decoder.
+ * @param id  Token id.
+ * @param len Output number of new bytes (may be 0).
+ * @return    Pointer to the new bytes (valid until the next call), or NULL on error.
+ */
+const char* decoder_push(Decoder* d, int id, size_t* len);
+
+/**
+ * @brief Release held-back bytes at the end of a stream.
+ *
+ * @param d   Decoder.
+ * @param len Output number of new bytes (may be 0).
+ * @return    Pointer to the remaining bytes (valid until the next call).
+ */
+const char* decoder_flush(Decoder* d, size_t* len);
+
+/**
+ * @brief Whether a stop string has been produced.
+ */
+bool decoder_stopped(const Decoder* d);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // TOKENIZER_DECODER_H
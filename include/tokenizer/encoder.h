@@ -0,0 +1,125 @@
+/**
+ * @file      tokenizer/encoder.h
+ * @brief     Streaming encoder with bounded memory
+ * @copyright Copyright © 2025 Austin Berrio
+ *
+ * An Encoder buffers input bytes up to a fixed capacity and encodes them in
+ * chunks, handing the ids to a sink callback. A chunk is cut after its last
+ * word boundary (see tokenizer_boundary()); the partial word after it is
+ * carried over to the next chunk, so the ids are the same as encoding the
+ * whole input at once.
+ *
+ * When a single word fills the buffer, the buffer doubles until the word
+ * fits rather than cutting it. Memory is therefore bounded by the capacity
+ * or the longest word, whichever is larger, whatever the input size.
+ */
+
+#ifndef TOKENIZER_ENCODER_H
+#define TOKENIZER_ENCODER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "tokenizer/model.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ENCODER_CAPACITY (1 << 20) /**< Default chunk size in bytes. */
+
+/**
+ * @brief Receives the ids of each encoded chunk.
+ *
+ * @param ids   Token ids (valid until the callback returns).
+ * @param count Number of ids.
+ * @param ctx   User context.
+ * @return      false to stop encoding.
+ */
+typedef bool (*EncoderSink)(const int* ids, size_t count, void* ctx);
+
+/**
+ * @brief Streaming encoder state.
+ */
+typedef struct Encoder {
+    Tokenizer* t; /**< Borrowed tokenizer. */
+    char* text; /**< Buffered input (capacity bytes). */
+    int* ids; /**< Ids of one chunk (capacity + 2). */
+    size_t len; /**< Bytes in text. */
+    size_t capacity; /**< Chunk size in bytes (grows to fit the longest word). */
+    EncoderSink sink; /**< Output callback. */
+    void* ctx; /**< Output callback context. */
+    bool add_bos; /**< Add BOS before the first chunk. */
+    bool add_eos; /**< Add EOS after the last chunk. */
+    bool started; /**< Whether a chunk has been emitted. */
+    size_t n_bytes; /**< Bytes consumed so far. */
+    size_t n_ids; /**< Ids emitted so far. */
+} Encoder;
+
+/** @name Encoder life-cycle
+ *  @{
+ */
+
+/**
+ * @brief Create an encoder bound to a tokenizer and sink.
+ *
+ * @param t        Tokenizer (not owned).
+ * @param capacity Chunk size in bytes (0 for ENCODER_CAPACITY); grows to
+ *                 hold a word longer than it.
+ * @param sink     Output callback.
+ * @param ctx      Output callback context.
+ * @return         Encoder (text is NULL on failure).
+ */
+Encoder encoder_new(Tokenizer* t, size_t capacity, EncoderSink sink, void* ctx);
+
+/**
+ * @brief Free the encoder buffers.
+ */
+void encoder_free(Encoder* e);
+
+/** @} */
+
+/** @name Streaming
+ *  @{
+ */
+
+/**
+ * @brief Append input bytes, encoding each chunk as the buffer fills.
+ *
+ * @return false on failure or if the sink stopped.
+ */
+bool encoder_push(Encoder* e, const char* bytes, size_t len);
+
+/**
+ * @brief Encode the remaining bytes (and EOS) at the end of the input.
+ *
+ * @return false on failure or if the sink stopped.
+ */
+bool encoder_flush(Encoder* e);
+
+/**
+ * @brief Encode everything readable from a file descriptor, then flush.
+ *
+ * Reads go straight into the chunk buffer.
+ *
+ * @return false on a read error, an encoding failure, or if the sink stopped.
+ */
+bool encoder_read_fd(Encoder* e, int fd);
+
+/**
+ * @brief Encode a whole file, then flush.
+ */
+bool encoder_read_file(Encoder* e, const char* path);
+
+/**
+ * @brief Sink that appends ids to a FILE* (ctx) as native-endian int32.
+ */
+bool encoder_sink_file(const int* ids, size_t count, void* ctx);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // TOKENIZER_ENCODER_H
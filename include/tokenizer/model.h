@@ -40,11 +40,17 @@ typedef struct SpecialToken {
 
 /**
  * @brief Tokenizer structure for Byte Pair Encoding models.
+ *
+ * A tokenizer is read-only once created or loaded: encoding and decoding only
+ * read its tables (the encode cache is per thread), so any number of threads
+ * may share one without locking.
  */
 typedef struct Tokenizer {
     SpecialToken* special; /**< Special token markers. */
     void* scores; /**< (Internal) Merge scores map. */
     void* token_to_id; /**< (Internal) Token-to-id hashmap. */
+    void* merges; /**< (Internal) Pair-to-merge table used by the encoder. */
+    int* byte_to_id; /**< Array: byte maps to its base token id (-1 if unmapped). */
     char** id_to_token; /**< Array: index maps to token string. */
     int vocab_size; /**< Number of tokens in vocabulary. */
 } Tokenizer;
@@ -118,6 +124,48 @@ Tokenizer tokenizer_load(const char* path);
 
 /** @} */
 
+/**
+ * @brief Token ids of many documents in one contiguous buffer.
+ */
+typedef struct TokenBatch {
+    int* ids; /**< Ids of all documents, back to back. */
+    size_t* offsets; /**< Document i is ids[offsets[i]] .. ids[offsets[i + 1] - 1] (count + 1 entries). */
+    size_t count; /**< Number of documents. */
+} TokenBatch;
+
+/** @name Encode Cache
+ *
+ * Encoding splits text at boundary bytes: bytes whose base token takes part in
+ * no merge (whitespace, for tokenizers trained by vocab_build). Nothing merges
+ * across them, so each word between boundaries is encoded on its own with the
+ * same result. Each thread keeps a direct-mapped cache from short words to
+ * their ids; repeated words skip merging entirely.
+ *  @{
+ */
+#define TOKENIZER_CACHE_SLOTS 4096 /**< Cached words per thread (power of two). */
+#define TOKENIZER_CACHE_WORD 24 /**< Longest cached word in bytes. */
+#define TOKENIZER_CACHE_IDS 8 /**< Most ids kept for one cached word. */
+
+/**
+ * @brief Encode cache counters of the calling thread.
+ */
+typedef struct TokenizerCacheStats {
+    size_t hits; /**< Words served from the cache. */
+    size_t misses; /**< Words that were merged. */
+} TokenizerCacheStats;
+
+/**
+ * @brief Counters of the calling thread's encode cache.
+ */
+TokenizerCacheStats tokenizer_cache_stats(void);
+
+/**
+ * @brief Empty the calling thread's encode cache and reset its counters.
+ */
+void tokenizer_cache_clear(void);
+
+/** @} */
+
 /** @name Encoding and Decoding
  *  @{
  */
@@ -125,15 +173,67 @@ Tokenizer tokenizer_load(const char* path);
 /**
  * @brief Encode a UTF-8 string into an array of token ids.
  *
+ * Merges are applied greedily by score, leftmost first on ties. Symbols are
+ * kept in a linked list and candidate pairs in a priority queue, so a merge
+ * only re-queues its two new neighbouring pairs: O(n log n) in input bytes.
+ * Words are merged independently and cached per thread (see Encode Cache).
+ *
  * @param t       Tokenizer to use.
  * @param text    Input string (UTF-8, null-terminated).
  * @param seq_len Output number of token ids in result.
  * @param add_bos If true, add BOS token at start if defined.
  * @param add_eos If true, add EOS token at end if defined.
- * @return        Newly allocated array of token ids (caller frees), or NULL.
+ * @return        Newly allocated array of token ids (caller frees; empty for ""), or NULL.
  */
 int* tokenizer_encode(Tokenizer* t, char* text, int* seq_len, bool add_bos, bool add_eos);
 
+/**
+ * @brief Encode len bytes of text into a caller buffer.
+ *
+ * The text need not be null-terminated and may contain NUL bytes.
+ *
+ * @param t       Tokenizer to use.
+ * @param text    Input bytes.
+ * @param len     Number of input bytes.
+ * @param add_bos If true, add BOS token at start if defined.
+ * @param add_eos If true, add EOS token at end if defined.
+ * @param ids     Output buffer with room for len + 2 ids.
+ * @return        Number of ids written, or SIZE_MAX on failure.
+ */
+size_t tokenizer_encode_span(Tokenizer* t, const char* text, size_t len, bool add_bos, bool add_eos, int* ids);
+
+/**
+ * @brief Length of the longest prefix of text that ends at a word boundary.
+ *
+ * Encoding the prefix and the rest separately gives the same ids as encoding
+ * the whole text, so streams can be cut there.
+ *
+ * @return Prefix length in bytes (0 if text has no boundary byte).
+ */
+size_t tokenizer_boundary(Tokenizer* t, const char* text, size_t len);
+
+/**
+ * @brief Encode many documents in parallel into one buffer.
+ *
+ * Documents are handed out to the OpenMP threads dynamically. Each is encoded
+ * into a worst-case slot of a single allocation, which is then compacted in
+ * order, so there is no allocation per document and the result does not
+ * depend on the thread count. A NULL text encodes to no ids.
+ *
+ * @param t       Tokenizer to use.
+ * @param texts   Input strings (UTF-8, null-terminated).
+ * @param n       Number of strings.
+ * @param add_bos If true, add BOS token at the start of each document.
+ * @param add_eos If true, add EOS token at the end of each document.
+ * @return        Batch (ids is NULL on failure); free with tokenizer_batch_free().
+ */
+TokenBatch tokenizer_encode_batch(Tokenizer* t, char** texts, size_t n, bool add_bos, bool add_eos);
+
+/**
+ * @brief Free the buffers of a batch.
+ */
+void tokenizer_batch_free(TokenBatch* batch);
+
 /**
  * @brief Decode a sequence of token ids into a UTF-8 string.
  *
@@ -33,6 +33,19 @@ extern "C" {
  */
 #define VOCAB_VERSION 1
 
+/**
+ * @struct VocabText
+ * @brief Read-only view of a text corpus mapped from disk.
+ *
+ * The bytes are not NUL-terminated; consume them through the *_span()
+ * functions. Pages are read in on demand, so a corpus is never copied to the
+ * heap and may be larger than RAM.
+ */
+typedef struct VocabText {
+    const char* data;  ///< Mapped bytes, or NULL on failure.
+    size_t len;  ///< Number of bytes.
+} VocabText;
+
 /**
  * @defgroup VocabMapUtils Vocab Map Utilities
  * @brief General utilities for working with vocab hash maps.
@@ -124,6 +137,22 @@ HashMap* vocab_map_load(const char* path);
  */
 char* vocab_read_text(const char* path);
 
+/**
+ * @brief Maps a text file read-only for zero-copy ingestion.
+ *
+ * The mapping is advised for sequential access and, where the kernel
+ * supports it for file mappings, for transparent huge pages.
+ *
+ * @param path Path to a non-empty regular file.
+ * @return Text view (data is NULL on failure). Release with vocab_text_close().
+ */
+VocabText vocab_text_open(const char* path);
+
+/**
+ * @brief Unmaps a text view and clears it. Safe to call on a failed view.
+ */
+void vocab_text_close(VocabText* text);
+
 /** @} */
 
 /**
@@ -136,12 +165,27 @@ char* vocab_read_text(const char* path);
  * @brief Creates a word-frequency map from plain text.
  *
  * Tokenizes input on whitespace and counts unique word occurrences.
+ * The text is cut into one chunk per OpenMP thread at whitespace, each
+ * chunk is counted in place into a thread-local table, and the tables are
+ * merged; only the distinct words are copied.
  *
  * @param text Null-terminated input text.
  * @return HashMap* mapping (word string) -> (int* frequency), or NULL on failure.
  */
 HashMap* vocab_create_frequencies(const char* text);
 
+/**
+ * @brief Creates a word-frequency map from len bytes of text.
+ *
+ * Same as vocab_create_frequencies(), but the text need not be
+ * NUL-terminated; NUL bytes separate words like whitespace.
+ *
+ * @param text Input bytes.
+ * @param len  Number of input bytes.
+ * @return HashMap* mapping (word string) -> (int* frequency), or NULL on failure.
+ */
+HashMap* vocab_create_frequencies_span(const char* text, size_t len);
+
 /**
  * @brief Creates a symbol-frequency map from a word-frequency map.
  *
@@ -171,10 +215,20 @@ HashMap* vocab_create_symbols(HashMap* words);
  */
 HashMap* vocab_tokenize(const char* text);
 
+/**
+ * @brief Tokenizes len bytes of text into a symbol-frequency vocab map.
+ *
+ * @param text Input bytes (need not be NUL-terminated).
+ * @param len  Number of input bytes.
+ * @return HashMap* mapping (symbol sequence) -> (int* frequency), or NULL on failure.
+ */
+HashMap* vocab_tokenize_span(const char* text, size_t len);
+
 /**
  * @brief Builds a vocab map directly from a plain text file.
  *
- * Reads the file, tokenizes, and returns the resulting symbol-frequency map.
+ * Maps the file, tokenizes it in place, and returns the resulting
+ * symbol-frequency map.
  *
  * @param path Path to the plain text file.
  * @return HashMap* mapping (symbol sequence) -> (int* frequency), or NULL on failure.
@@ -0,0 +1,166 @@
+/**
+ * Copyright © 2025 Austin Berrio
+ *
+ * @file core/checksum.c
+ * @brief Fast non-cryptographic 64-bit checksums for integrity checks.
+ * @ref https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/checksum.h"
+
+#define PRIME64_1 0x9E3779B185EBCA87ull
+#define PRIME64_2 0xC2B2AE3D27D4EB4Full
+#define PRIME64_3 0x165667B19E3779F9ull
+#define PRIME64_4 0x85EBCA77C2B2AE63ull
+#define PRIME64_5 0x27D4EB2F165667C5ull
+
+/**
+ * @name XXH64
+ * @{
+ */
+
+static inline uint64_t checksum_rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t checksum_read64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t checksum_read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t checksum_round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME64_2;
+    acc = checksum_rotl(acc, 31);
+    return acc * PRIME64_1;
+}
+
+static inline uint64_t checksum_merge(uint64_t acc, uint64_t lane) {
+    acc ^= checksum_round(0, lane);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+static inline uint64_t checksum_avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t checksum64(const void* data, size_t len, uint64_t seed) {
+    const uint8_t* p = (const uint8_t*) data;
+    const uint8_t* end = p + len;
+    uint64_t h;
+
+    if (len >= 32) {
+        uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+        uint64_t v2 = seed + PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME64_1;
+
+        // Independent lanes: 32 bytes per step
+        const uint8_t* limit = end - 32;
+        do {
+            v1 = checksum_round(v1, checksum_read64(p));
+            v2 = checksum_round(v2, checksum_read64(p + 8));
+            v3 = checksum_round(v3, checksum_read64(p + 16));
+            v4 = checksum_round(v4, checksum_read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = checksum_rotl(v1, 1) + checksum_rotl(v2, 7) + checksum_rotl(v3, 12) + checksum_rotl(v4, 18);
+        h = checksum_merge(h, v1);
+        h = checksum_merge(h, v2);
+        h = checksum_merge(h, v3);
+        h = checksum_merge(h, v4);
+    } else {
+        h = seed + PRIME64_5;
+    }
+
+    h += (uint64_t) len;
+
+    // Tail
+    for (; p + 8 <= end; p += 8) {
+        h ^= checksum_round(0, checksum_read64(p));
+        h = checksum_rotl(h, 27) * PRIME64_1 + PRIME64_4;
+    }
+    if (p + 4 <= end) {
+        h ^= (uint64_t) checksum_read32(p) * PRIME64_1;
+        h = checksum_rotl(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h ^= (uint64_t) *p * PRIME64_5;
+        h = checksum_rotl(h, 11) * PRIME64_1;
+    }
+
+    return checksum_avalanche(h);
+}
+
+/** @} */
+
+/**
+ * @name Blocks
+ * @{
+ */
+
+uint64_t checksum_block(const void* data, size_t len, size_t b) {
+    const size_t begin = b * CHECKSUM_BLOCK;
+    const size_t size = begin + CHECKSUM_BLOCK < len ? CHECKSUM_BLOCK : len - begin;
+    return checksum64((const uint8_t*) data + begin, size, b);
+}
+
+uint64_t checksum_combine(const uint64_t* digests, size_t len) {
+    const size_t n_blocks = checksum_block_count(len);
+    if (n_blocks == 0) {
+        return checksum64("", 0, 0);
+    }
+    if (n_blocks == 1) {
+        return digests[0];  // == checksum64(data, len, 0)
+    }
+
+    // Fold in block order; the length seeds it, so truncation is caught
+    uint64_t h = (uint64_t) len + PRIME64_5;
+    for (size_t b = 0; b < n_blocks; b++) {
+        h = checksum_merge(h, digests[b]);
+    }
+    return checksum_avalanche(h);
+}
+
+uint64_t checksum_blocks(const void* data, size_t len) {
+    const size_t n_blocks = checksum_block_count(len);
+    if (n_blocks <= 1) {
+        return checksum64(data, len, 0);
+    }
+
+    uint64_t* digests = malloc(n_blocks * sizeof(uint64_t));
+    if (!digests) {
+        uint64_t h = (uint64_t) len + PRIME64_5;  // same fold, one block at a time
+        for (size_t b = 0; b < n_blocks; b++) {
+            h = checksum_merge(h, checksum_block(data, len, b));
+        }
+        return checksum_avalanche(h);
+    }
+
+#pragma omp parallel for schedule(static)
+    for (size_t b = 0; b < n_blocks; b++) {
+        digests[b] = checksum_block(data, len, b);
+    }
+
+    uint64_t h = checksum_combine(digests, len);
+    free(digests);
+    return h;
+}
+
+/** @} */
@@ -0,0 +1,214 @@
+/**
+ * Copyright © 2025 Austin Berrio
+ *
+ * @file core/metrics.c
+ * @brief Lock-free latency and throughput histograms with text and JSON dumps.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/metrics.h"
+
+Metrics metrics_global = {
+    .histograms = {0},
+    .count = 0,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+_Thread_local int histogram_thread_shard = -1;
+
+static _Atomic int histogram_next_shard = 0;
+
+/**
+ * @name Histograms
+ * @{
+ */
+
+int histogram_shard_assign(void) {
+    return atomic_fetch_add_explicit(&histogram_next_shard, 1, memory_order_relaxed) % HISTOGRAM_SHARDS;
+}
+
+// Largest value that maps to a bucket
+static uint64_t histogram_bucket_high(int bucket) {
+    if (bucket < HISTOGRAM_SUB_COUNT) {
+        return (uint64_t) bucket;
+    }
+    const int shift = bucket / HISTOGRAM_SUB_COUNT - 1;
+    const uint64_t sub = (uint64_t) (bucket % HISTOGRAM_SUB_COUNT + HISTOGRAM_SUB_COUNT);
+    return ((sub + 1) << shift) - 1;
+}
+
+static void histogram_init(Histogram* h, const char* name, const char* unit) {
+    memset(h, 0, sizeof(Histogram));
+    strncpy(h->name, name, METRICS_NAME_MAX - 1);
+    strncpy(h->unit, unit ? unit : "", METRICS_UNIT_MAX - 1);
+    atomic_init(&h->min, UINT64_MAX);
+}
+
+static uint64_t histogram_count(Histogram* h) {
+    uint64_t count = 0;
+    for (int s = 0; s < HISTOGRAM_SHARDS; s++) {
+        count += atomic_load_explicit(&h->shards[s].count, memory_order_relaxed);
+    }
+    return count;
+}
+
+double histogram_percentile(Histogram* h, double percentile) {
+    const uint64_t count = histogram_count(h);
+    if (0 == count) {
+        return 0.0;
+    }
+
+    percentile = percentile < 0.0 ? 0.0 : (percentile > 100.0 ? 100.0 : percentile);
+    uint64_t rank = (uint64_t) (percentile / 100.0 * (double) count + 0.5);
+    rank = rank < 1 ? 1 : rank;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        for (int s = 0; s < HISTOGRAM_SHARDS; s++) {
+            seen += atomic_load_explicit(&h->shards[s].buckets[i], memory_order_relaxed);
+        }
+        if (seen >= rank) {
+            // Report the bucket's highest value, bounded by what was observed
+            uint64_t value = histogram_bucket_high(i);
+            uint64_t max = atomic_load_explicit(&h->max, memory_order_relaxed);
+            uint64_t min = atomic_load_explicit(&h->min, memory_order_relaxed);
+            value = value > max ? max : value;
+            value = value < min ? min : value;
+            return (double) value;
+        }
+    }
+    return (double) atomic_load_explicit(&h->max, memory_order_relaxed);
+}
+
+HistogramSnapshot histogram_snapshot(Histogram* h) {
+    HistogramSnapshot s = {.name = h->name, .unit = h->unit};
+    for (int i = 0; i < HISTOGRAM_SHARDS; i++) {
+        s.count += atomic_load_explicit(&h->shards[i].count, memory_order_relaxed);
+        s.sum += atomic_load_explicit(&h->shards[i].sum, memory_order_relaxed);
+    }
+    if (0 == s.count) {
+        return s;
+    }
+
+    s.min = atomic_load_explicit(&h->min, memory_order_relaxed);
+    s.max = atomic_load_explicit(&h->max, memory_order_relaxed);
+    s.mean = (double) s.sum / (double) s.count;
+    s.p50 = histogram_percentile(h, 50.0);
+    s.p90 = histogram_percentile(h, 90.0);
+    s.p99 = histogram_percentile(h, 99.0);
+    s.p999 = histogram_percentile(h, 99.9);
+    return s;
+}
+
+void histogram_reset(Histogram* h) {
+    if (h) {
+        for (int s = 0; s < HISTOGRAM_SHARDS; s++) {
+            HistogramShard* shard = &h->shards[s];
+            for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+                atomic_store_explicit(&shard->buckets[i], 0, memory_order_relaxed);
+            }
+            atomic_store_explicit(&shard->count, 0, memory_order_relaxed);
+            atomic_store_explicit(&shard->sum, 0, memory_order_relaxed);
+        }
+        atomic_store_explicit(&h->min, UINT64_MAX, memory_order_relaxed);
+        atomic_store_explicit(&h->max, 0, memory_order_relaxed);
+    }
+}
+
+/** @} */
+
+/**
+ * @name Registry
+ * @{
+ */
+
+Histogram* metrics_find(Metrics* m, const char* name) {
+    const int count = atomic_load_explicit(&m->count, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        if (0 == strcmp(m->histograms[i]->name, name)) {
+            return m->histograms[i];
+        }
+    }
+    return NULL;
+}
+
+Histogram* metrics_histogram(Metrics* m, const char* name, const char* unit) {
+    if (!m || !name) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&m->lock);
+    Histogram* h = metrics_find(m, name);
+    const int count = atomic_load_explicit(&m->count, memory_order_relaxed);
+    if (!h && count < METRICS_MAX) {
+        h = aligned_alloc(alignof(Histogram), sizeof(Histogram));
+        if (h) {
+            histogram_init(h, name, unit);
+            m->histograms[count] = h;
+            atomic_store_explicit(&m->count, count + 1, memory_order_release);  // publish
+        }
+    }
+    pthread_mutex_unlock(&m->lock);
+    return h;
+}
+
+void metrics_reset(Metrics* m) {
+    const int count = atomic_load_explicit(&m->count, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        histogram_reset(m->histograms[i]);
+    }
+}
+
+bool metrics_dump_text(Metrics* m, FILE* stream) {
+    const int count = atomic_load_explicit(&m->count, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        HistogramSnapshot s = histogram_snapshot(m->histograms[i]);
+        fprintf(
+            stream,
+            "%-20s %-6s count=%-8llu mean=%-10.1f min=%-8llu p50=%-8.0f p90=%-8.0f p99=%-8.0f "
+            "p99.9=%-8.0f max=%llu\n",
+            s.name,
+            s.unit,
+            (unsigned long long) s.count,
+            s.mean,
+            (unsigned long long) s.min,
+            s.p50,
+            s.p90,
+            s.p99,
+            s.p999,
+            (unsigned long long) s.max
+        );
+    }
+    return 0 == ferror(stream);
+}
+
+bool metrics_dump_json(Metrics* m, FILE* stream) {
+    const int count = atomic_load_explicit(&m->count, memory_order_acquire);
+    fputc('{', stream);
+    for (int i = 0; i < count; i++) {
+        HistogramSnapshot s = histogram_snapshot(m->histograms[i]);
+        fprintf(
+            stream,
+            "%s\"%s\":{\"unit\":\"%s\",\"count\":%llu,\"sum\":%llu,\"min\":%llu,\"max\":%llu,"
+            "\"mean\":%.3f,\"p50\":%.0f,\"p90\":%.0f,\"p99\":%.0f,\"p999\":%.0f}",
+            i > 0 ? "," : "",
+            s.name,
+            s.unit,
+            (unsigned long long) s.count,
+            (unsigned long long) s.sum,
+            (unsigned long long) s.min,
+            (unsigned long long) s.max,
+            s.mean,
+            s.p50,
+            s.p90,
+            s.p99,
+            s.p999
+        );
+    }
+    fputs("}\n", stream);
+    return 0 == ferror(stream);
+}
+
+/** @} */
@@ -6,6 +6,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
 #include "linear/type.h"
 
 /**
@@ -27,4 +28,13 @@ uint32_t type_size(TypeId id) {
     return type ? type->size : 0;
 }
 
+TypeId type_id(const char* name) {
+    for (int id = 0; name && id < TYPE_COUNT; id++) {
+        if (0 == strcmp(TYPE_DATA[id].name, name)) {
+            return (TypeId) id;
+        }
+    }
+    return TYPE_COUNT;
+}
+
 /** @} */
@@ -0,0 +1,342 @@
+/**
+ * @file batch.c
+ * @brief Batched forward pass over independent sequences.
+ * @copyright Copyright © 2025 Austin Berrio
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#include "core/logger.h"
+#include "linear/activation.h"
+#include "linear/tensor.h"
+#include "model/valerie.h"
+#include "model/blocks.h"
+#include "model/paged.h"
+#include "model/batch.h"
+#include "model/prefetch.h"
+
+/**
+ * @section Private
+ * @{
+ */
+
+// Vector view of a single activation row
+static Tensor batch_row(const Tensor* t, size_t row) {
+    Tensor view = tensor_empty(shape_vec(tensor_cols(t)), t->id);
+    view.data = tensor_view_row(t, row);
+    return view;
+}
+
+// Layer cache owned by the row's sequence
+static Cache* batch_cache(Valerie* v, Batch* b, int row, int layer) {
+    return b->kv[row] ? &b->kv[row][layer] : &v->layers[layer].cache;
+}
+
+static float* batch_key(Valerie* v, Batch* b, int row, int layer, int t) {
+    if (b->seq[row]) {
+        return kv_key(b->pool, b->seq[row], layer, t);
+    }
+    return tensor_view_row(&batch_cache(v, b, row, layer)->K, t);
+}
+
+static float* batch_value(Valerie* v, Batch* b, int row, int layer, int t) {
+    if (b->seq[row]) {
+        return kv_value(b->pool, b->seq[row], layer, t);
+    }
+    return tensor_view_row(&batch_cache(v, b, row, layer)->V, t);
+}
+
+static void batch_rmsnorm(Tensor* Y, Tensor* w, Tensor* X, int n) {
+#pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        Tensor y = batch_row(Y, i);
+        Tensor x = batch_row(X, i);
+        rmsnorm(&y, w, &x);
+    }
+}
+
+static void batch_residual(Tensor* dst, Tensor* src, int n, int cols) {
+    float* yf = (float*) dst->data;
+    const float* xf = (float*) src->data;
+    const size_t len = (size_t) n * cols;
+
+#pragma omp parallel for
+    for (size_t i = 0; i < len; i++) {
+        yf[i] += xf[i];
+    }
+}
+
+static void batch_attn(Valerie* v, Batch* b, int layer) {
+    Dim* d = &v->dim;
+    Layer* L = &v->layers[layer];
+
+    // Normalize input
+    batch_rmsnorm(&b->x_norm, &L->attn.norm, &b->x, b->n);
+
+    // Compute Q, K, V projections for every row
+    matmul_batch(&b->q, &L->attn.Wq, &b->x_norm, b->n);  // (n, proj_dim)
+    matmul_batch(&b->k, &L->attn.Wk, &b->x_norm, b->n);  // (n, kv_dim)
+    matmul_batch(&b->v, &L->attn.Wv, &b->x_norm, b->n);  // (n, kv_dim)
+
+    // Rotate and commit K/V before attending so rows of one sequence see each other
+#pragma omp parallel for
+    for (int i = 0; i < b->n; i++) {
+        float* q = tensor_view_row(&b->q, i);
+        float* k = tensor_view_row(&b->k, i);
+        for (int h = 0; h < d->heads; h++) {
+            rotary(q + h * d->head_dim, &v->rope, b->pos[i], d->head_dim);
+        }
+        for (int g = 0; g < d->kv_heads; g++) {
+            rotary(k + g * d->head_dim, &v->rope, b->pos[i], d->head_dim);
+        }
+
+        float* kc = batch_key(v, b, i, layer, b->pos[i]);
+        float* vc = batch_value(v, b, i, layer, b->pos[i]);
+        memcpy(kc, k, d->kv_dim * sizeof(float));
+        memcpy(vc, tensor_view_row(&b->v, i), d->kv_dim * sizeof(float));
+    }
+
+    // Attention per (row, head)
+    const float scale = 1.0f / sqrtf((float) d->head_dim);
+#pragma omp parallel for collapse(2)
+    for (int i = 0; i < b->n; i++) {
+        for (int h = 0; h < d->heads; h++) {
+            const int pos = b->pos[i];
+            const size_t group = (h / d->kv_mul) * d->head_dim;
+
+            float* qh = (float*) tensor_view_row(&b->q, i) + h * d->head_dim;
+            float* scores = tensor_view_row(&b->attn_scores, i * d->heads + h);
+
+            for (int t = 0; t <= pos; t++) {
+                float* kt = batch_key(v, b, i, layer, t) + group;
+                float dot = 0.0f;
+                for (int k = 0; k < d->head_dim; k++) {
+                    dot += qh[k] * kt[k];
+                }
+                scores[t] = dot * scale;
+            }
+
+            softmax(scores, pos + 1);
+
+            float* out_h = (float*) tensor_view_row(&b->attn_out, i) + h * d->head_dim;
+            memset(out_h, 0, d->head_dim * sizeof(float));
+            for (int t = 0; t <= pos; t++) {
+                float w = scores[t];
+                float* vt = batch_value(v, b, i, layer, t) + group;
+                for (int k = 0; k < d->head_dim; k++) {
+                    out_h[k] += w * vt[k];
+                }
+            }
+        }
+    }
+
+    // Output projection and residual
+    matmul_batch(&b->x_norm, &L->attn.Wo, &b->attn_out, b->n);
+    batch_residual(&b->x, &b->x_norm, b->n, d->d_model);
+}
+
+static bool batch_ffn(Valerie* v, Batch* b, int layer) {
+    Layer* L = &v->layers[layer];
+
+    batch_rmsnorm(&b->x_norm, &L->ffn.norm, &b->x, b->n);
+
+    // SwiGLU and down-projection, accumulated into the residual stream
+    return ffn_chunked((float*) b->x.data, &L->ffn, (const float*) b->x_norm.data, b->n);
+}
+
+// Embedding lookup and layer stack; leaves the residual stream in b->x
+static bool batch_layers(Valerie* v, Batch* b) {
+    Dim* d = &v->dim;
+    Embedding* e = &v->embed;
+
+    // Paged rows own their block before anything is written (copy on write)
+    for (int i = 0; i < b->n; i++) {
+        if (b->seq[i] && !kv_seq_reserve(b->pool, b->seq[i], b->pos[i])) {
+            LOG_ERROR("forward_batch: failed to reserve a block for row %d", i);
+            return false;
+        }
+    }
+
+    // Token embedding lookup
+    for (int i = 0; i < b->n; i++) {
+        assert(b->ids[i] >= 0 && b->ids[i] < d->vocab_size);
+        assert(b->pos[i] >= 0 && b->pos[i] < d->seq_len);
+        float* dst = tensor_view_row(&b->x, i);
+        float* src = tensor_view_row(&e->token, b->ids[i]);
+        memcpy(dst, src, d->d_model * sizeof(float));
+    }
+
+    // Iterate over model layers
+    for (int l = 0; l < d->layers; l++) {
+        prefetch_layer(v->prefetch, l + 1);  // next layer, then the output projection
+        batch_attn(v, b, l);
+        if (!batch_ffn(v, b, l)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/** @} */
+
+/**
+ * @section Batch life-cycle
+ * @{
+ */
+
+Batch batch_new(const Dim* d, int capacity) {
+    assert(d && capacity > 0);
+
+    Batch b = {0};
+    b.ids = calloc(capacity, sizeof(int));
+    b.pos = calloc(capacity, sizeof(int));
+    b.kv = calloc(capacity, sizeof(Cache*));
+    b.seq = calloc(capacity, sizeof(KVSeq*));
+    b.want = calloc(capacity, sizeof(bool));
+    b.out = calloc(capacity, sizeof(int));
+    if (!b.ids || !b.pos || !b.kv || !b.seq || !b.want || !b.out) {
+        LOG_ERROR("batch_new: failed to allocate %d rows", capacity);
+        batch_free(&b);
+        return b;
+    }
+
+    b.x = tensor_new(shape_mat(capacity, d->d_model), TYPE_F32);
+    b.x_norm = tensor_new(shape_mat(capacity, d->d_model), TYPE_F32);
+    b.q = tensor_new(shape_mat(capacity, d->proj_dim), TYPE_F32);
+    b.k = tensor_new(shape_mat(capacity, d->kv_dim), TYPE_F32);
+    b.v = tensor_new(shape_mat(capacity, d->kv_dim), TYPE_F32);
+    b.attn_scores = tensor_new(shape_mat(capacity * d->heads, d->seq_len), TYPE_F32);
+    b.attn_out = tensor_new(shape_mat(capacity, d->proj_dim), TYPE_F32);
+    b.logits = tensor_empty(shape_mat(capacity, d->vocab_size), TYPE_F32);  // allocated on first use
+
+    b.capacity = capacity;
+    return b;
+}
+
+void batch_free(Batch* b) {
+    if (b) {
+        free(b->ids);
+        free(b->pos);
+        free(b->kv);
+        free(b->seq);
+        free(b->want);
+        free(b->out);
+        tensor_free(&b->x);
+        tensor_free(&b->x_norm);
+        tensor_free(&b->q);
+        tensor_free(&b->k);
+        tensor_free(&b->v);
+        tensor_free(&b->attn_scores);
+        tensor_free(&b->attn_out);
+        tensor_free(&b->logits);
+        *b = (Batch) {0};
+    }
+}
+
+void batch_clear(Batch* b) {
+    b->n = 0;
+    b->n_out = 0;
+}
+
+int batch_push(Batch* b, int id, int pos, Cache* kv, bool logits) {
+    if (!b || b->n >= b->capacity) {
+        return -1;
+    }
+
+    int row = b->n++;
+    b->ids[row] = id;
+    b->pos[row] = pos;
+    b->kv[row] = kv;
+    b->seq[row] = NULL;
+    b->want[row] = logits;
+    b->out[row] = -1;
+    return row;
+}
+
+int batch_push_paged(Batch* b, int id, int pos, KVSeq* seq, bool logits) {
+    if (!seq) {
+        return -1;
+    }
+
+    int row = batch_push(b, id, pos, NULL, logits);
+    if (row >= 0) {
+        b->seq[row] = seq;
+    }
+    return row;
+}
+
+float* batch_logits(Batch* b, int row) {
+    if (!b || row < 0 || row >= b->n || b->out[row] < 0) {
+        return NULL;
+    }
+    return tensor_view_row(&b->logits, b->out[row]);
+}
+
+/** @} */
+
+/**
+ * @section Batch forward
+ * @{
+ */
+
+bool forward_batch(Valerie* v, Batch* b) {
+    Embedding* e = &v->embed;
+
+    b->n_out = 0;
+    if (b->n == 0) {
+        return true;
+    }
+
+    if (!batch_layers(v, b)) {
+        return false;
+    }
+
+    // Final normalization, compacting rows that need logits
+    for (int i = 0; i < b->n; i++) {
+        if (!b->want[i]) {
+            continue;
+        }
+        Tensor x = batch_row(&b->x, i);
+        Tensor y = batch_row(&b->x_norm, b->n_out);
+        rmsnorm(&y, &e->norm, &x);
+        b->out[i] = b->n_out++;
+    }
+
+    if (b->n_out == 0) {
+        return true;
+    }
+
+    // Output projection (is always F32)
+    if (!b->logits.data) {
+        b->logits = tensor_new(b->logits.shape, TYPE_F32);
+        if (!b->logits.data) {
+            LOG_ERROR("forward_batch: failed to allocate logits");
+            b->n_out = 0;
+            return false;
+        }
+    }
+    matmul_batch(&b->logits, &e->token, &b->x_norm, b->n_out);
+
+    return true;
+}
+
+bool forward_batch_hidden(Valerie* v, Batch* b) {
+    b->n_out = 0;
+    if (b->n == 0) {
+        return true;
+    }
+
+    if (!batch_layers(v, b)) {
+        return false;
+    }
+
+    // Final normalization of every row, in row order
+    batch_rmsnorm(&b->x_norm, &v->embed.norm, &b->x, b->n);
+    return true;
+}
+
+/** @} */
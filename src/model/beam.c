@@ -0,0 +1,269 @@
+/**
+ * @file beam.c
+ * @brief Beam search over a paged, copy-on-write key/value cache.
+ * @copyright Copyright © 2025 Austin Berrio
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "core/logger.h"
+#include "core/map.h"
+#include "tokenizer/model.h"
+#include "model/valerie.h"
+#include "model/paged.h"
+#include "model/batch.h"
+#include "model/beam.h"
+
+/**
+ * @section Private
+ * @{
+ */
+
+static int beam_candidate_compare(const void* a, const void* b) {
+    const BeamCandidate* x = a;
+    const BeamCandidate* y = b;
+    if (x->score != y->score) {
+        return x->score < y->score ? 1 : -1;  // descending
+    }
+    if (x->parent != y->parent) {
+        return x->parent - y->parent;
+    }
+    return x->token - y->token;
+}
+
+// Best k extensions of a beam from its logits, sorted by descending score
+static int beam_top(const float* logits, int n_vocab, int k, float base, int parent, BeamCandidate* out) {
+    float max = logits[0];
+    for (int i = 1; i < n_vocab; i++) {
+        max = logits[i] > max ? logits[i] : max;
+    }
+
+    float sum = 0.0f;
+    for (int i = 0; i < n_vocab; i++) {
+        sum += expf(logits[i] - max);
+    }
+    const float lse = max + logf(sum);  // log-softmax normalizer
+
+    int n = 0;
+    for (int id = 0; id < n_vocab; id++) {
+        float score = base + logits[id] - lse;
+        if (n == k && score <= out[n - 1].score) {
+            continue;
+        }
+
+        // Insertion into the sorted top-k
+        int j = n < k ? n++ : n - 1;
+        while (j > 0 && out[j - 1].score < score) {
+            out[j] = out[j - 1];
+            j--;
+        }
+        out[j] = (BeamCandidate) {.score = score, .parent = parent, .token = id};
+    }
+
+    return n;
+}
+
+static void beam_reset(BeamSearch* bs) {
+    for (int i = 0; i < bs->width; i++) {
+        kv_seq_clear(&bs->pool, &bs->beams[i].seq);
+        kv_seq_clear(&bs->pool, &bs->next[i].seq);
+        bs->beams[i].n = 0;
+        bs->beams[i].score = 0.0f;
+        bs->beams[i].done = false;
+    }
+    bs->n_beams = 1;
+}
+
+static void beam_array_free(KVPool* pool, Beam* beams, int n) {
+    if (beams) {
+        for (int i = 0; i < n; i++) {
+            kv_seq_free(pool, &beams[i].seq);
+            free(beams[i].ids);
+        }
+        free(beams);
+    }
+}
+
+static Beam* beam_array_new(const KVPool* pool, const Dim* d, int n, int max_tokens) {
+    Beam* beams = calloc(n, sizeof(Beam));
+    if (!beams) {
+        return NULL;
+    }
+    for (int i = 0; i < n; i++) {
+        beams[i].seq = kv_seq_new(pool, d);
+        beams[i].ids = calloc(max_tokens, sizeof(int));
+        if (!beams[i].seq.blocks || !beams[i].ids) {
+            beam_array_free(NULL, beams, i + 1);  // nothing is mapped yet
+            return NULL;
+        }
+    }
+    return beams;
+}
+
+/** @} */
+
+/**
+ * @section Beam search life-cycle
+ * @{
+ */
+
+BeamSearch beam_new(Valerie* v, int width, int max_tokens) {
+    BeamSearch bs = {0};
+    if (!v || width < 1 || max_tokens < 1) {
+        return bs;
+    }
+
+    const Dim* d = &v->dim;
+    const int seq_blocks = (d->seq_len + KV_BLOCK_SIZE - 1) / KV_BLOCK_SIZE;
+
+    // Worst case: every beam and its child diverged from the first block.
+    // Blocks are allocated on demand, so unused capacity costs nothing.
+    bs.pool = kv_pool_new(d, seq_blocks * (2 * width + 1), KV_BLOCK_SIZE);
+    bs.batch = batch_new(d, width > 16 ? width : 16);
+    bs.beams = beam_array_new(&bs.pool, d, width, max_tokens);
+    bs.next = beam_array_new(&bs.pool, d, width, max_tokens);
+    bs.candidates = calloc(width * (width + 1), sizeof(BeamCandidate));
+    bs.rows = calloc(width, sizeof(int));
+    if (0 == bs.pool.max_blocks || 0 == bs.batch.capacity || !bs.beams || !bs.next
+        || !bs.candidates || !bs.rows) {
+        LOG_ERROR("beam_new: failed to allocate %d beams", width);
+        bs.width = width;
+        beam_free(&bs);
+        return bs;
+    }
+
+    Tokenizer* t = &v->t;
+    int* eos = t->special && t->special->eos ? hash_map_search(t->token_to_id, t->special->eos) : NULL;
+
+    bs.v = v;
+    bs.width = width;
+    bs.max_tokens = max_tokens;
+    bs.eos = eos ? *eos : -1;
+    bs.length_penalty = 1.0f;
+    return bs;
+}
+
+void beam_free(BeamSearch* bs) {
+    if (bs) {
+        beam_array_free(&bs->pool, bs->beams, bs->beams ? bs->width : 0);
+        beam_array_free(&bs->pool, bs->next, bs->next ? bs->width : 0);
+        free(bs->candidates);
+        free(bs->rows);
+        batch_free(&bs->batch);
+        kv_pool_free(&bs->pool);
+        *bs = (BeamSearch) {0};
+    }
+}
+
+/** @} */
+
+/**
+ * @section Beam search
+ * @{
+ */
+
+int beam_search(BeamSearch* bs, const int* prompt, int n_prompt) {
+    if (!bs || !bs->v || !prompt || n_prompt < 1 || n_prompt >= bs->v->dim.seq_len) {
+        return -1;
+    }
+
+    const Dim* d = &bs->v->dim;
+    Batch* b = &bs->batch;
+    b->pool = &bs->pool;  // BeamSearch is returned by value, so bind here
+    beam_reset(bs);
+
+    // Prefill all but the last prompt id into the root beam
+    Beam* root = &bs->beams[0];
+    for (int i = 0; i < n_prompt - 1;) {
+        batch_clear(b);
+        for (; i < n_prompt - 1 && b->n < b->capacity; i++) {
+            batch_push_paged(b, prompt[i], i, &root->seq, false);
+        }
+        if (!forward_batch(bs->v, b)) {
+            return -1;
+        }
+    }
+
+    while (true) {
+        // One row per live beam: its last id at its last position
+        batch_clear(b);
+        for (int i = 0; i < bs->n_beams; i++) {
+            Beam* beam = &bs->beams[i];
+            bs->rows[i] = -1;
+            if (!beam->done) {
+                int last = beam->n > 0 ? beam->ids[beam->n - 1] : prompt[n_prompt - 1];
+                bs->rows[i] = batch_push_paged(b, last, n_prompt + beam->n - 1, &beam->seq, true);
+            }
+        }
+        if (b->n == 0) {
+            break;  // every beam is done
+        }
+
+        if (!forward_batch(bs->v, b)) {
+            return -1;
+        }
+
+        // Extensions of live beams compete with finished beams
+        int n_candidates = 0;
+        for (int i = 0; i < bs->n_beams; i++) {
+            Beam* beam = &bs->beams[i];
+            if (beam->done) {
+                bs->candidates[n_candidates++] = (BeamCandidate) {beam->score, i, -1};
+                continue;
+            }
+            float* logits = batch_logits(b, bs->rows[i]);
+            n_candidates += beam_top(logits, d->vocab_size, bs->width, beam->score, i,
+                                     bs->candidates + n_candidates);
+        }
+        qsort(bs->candidates, n_candidates, sizeof(BeamCandidate), beam_candidate_compare);
+
+        // Children share their parent's blocks
+        int keep = n_candidates < bs->width ? n_candidates : bs->width;
+        for (int j = 0; j < keep; j++) {
+            BeamCandidate* c = &bs->candidates[j];
+            Beam* parent = &bs->beams[c->parent];
+            Beam* child = &bs->next[j];
+
+            kv_seq_fork(&bs->pool, &child->seq, &parent->seq);
+            memcpy(child->ids, parent->ids, parent->n * sizeof(int));
+            child->n = parent->n;
+            child->score = c->score;
+            child->done = parent->done;
+
+            if (c->token >= 0 && c->token == bs->eos) {
+                child->done = true;
+            } else if (c->token >= 0) {
+                child->ids[child->n++] = c->token;
+                child->done = child->n >= bs->max_tokens || n_prompt + child->n >= d->seq_len;
+            }
+        }
+
+        for (int i = 0; i < bs->n_beams; i++) {
+            kv_seq_clear(&bs->pool, &bs->beams[i].seq);
+        }
+
+        Beam* swap = bs->beams;
+        bs->beams = bs->next;
+        bs->next = swap;
+        bs->n_beams = keep;
+    }
+
+    // Length-normalized best beam
+    int best = -1;
+    float best_score = -INFINITY;
+    for (int i = 0; i < bs->n_beams; i++) {
+        Beam* beam = &bs->beams[i];
+        int n = beam->n > 0 ? beam->n : 1;
+        float score = beam->score / powf((float) n, bs->length_penalty);
+        if (best < 0 || score > best_score) {
+            best = i;
+            best_score = score;
+        }
+    }
+
+    return best;
+}
+
+/** @} */
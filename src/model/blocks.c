@@ -8,12 +8,18 @@
 #include <assert.h>
 #include <math.h>
 #include <string.h>
+#include <omp.h>
 
+#include "core/logger.h"
 #include "linear/activation.h"
+#include "linear/q8.h"
 #include "linear/quant.h"
+#include "linear/type.h"
 #include "linear/tensor.h"
 #include "model/valerie.h"
 #include "model/blocks.h"
+#include "model/prefetch.h"
+#include "model/tune.h"
 
 /**
  * Requires a backward pass.
@@ -84,26 +90,121 @@ void matmul(Tensor* y, Tensor* W, Tensor* x) {
     float* xf = calloc(x_cols, sizeof(float));  // scratch buffer
     dequant_vec(xf, x->data, x_cols, x->id);
 
-#pragma omp parallel for
-    for (size_t r = 0; r < W_rows; r++) {
-        // Compute source row pointer
-        float* wdst = calloc(W_cols, sizeof(float));  // scratch buffer
-        const void* wsrc = tensor_view_row(W, r);
-        dequant_vec(wdst, wsrc, W_cols, W->id);
-
-        // Compute dot product
-        float sum = 0.0f;
-        for (size_t c = 0; c < W_cols; c++) {
-            sum += wdst[c] * xf[c];
+    // Launch parameters (see tune.h)
+    const TuneConfig cfg = tune_config(TUNE_OP_MATMUL, W->id, W_rows, W_cols);
+    const int threads = cfg.threads > 0 ? cfg.threads : omp_get_max_threads();
+    const size_t tile = cfg.tile > 0 ? (size_t) cfg.tile : 1;
+    const size_t n_tiles = (W_rows + tile - 1) / tile;
+    const int chunk = cfg.chunk > 0 ? cfg.chunk : (int) ((n_tiles + threads - 1) / threads);
+    const size_t ahead = prefetch_distance(cfg.prefetch);
+
+#pragma omp parallel num_threads(threads)
+    {
+        float* wdst = malloc(W_cols * sizeof(float));  // per-thread scratch row
+
+#pragma omp for schedule(static, chunk)
+        for (size_t t = 0; t < n_tiles; t++) {
+            const size_t end = (t + 1) * tile < W_rows ? (t + 1) * tile : W_rows;
+            for (size_t r = t * tile; r < end; r++) {
+                if (ahead && r + ahead < W_rows) {
+                    prefetch_row(W, r + ahead);
+                }
+
+                const float* wr = wdst;
+                if (W->id == TYPE_F32) {
+                    wr = (const float*) tensor_view_row(W, r);  // no decode needed
+                } else {
+                    dequant_vec(wdst, tensor_view_row(W, r), W_cols, W->id);
+                }
+
+                // Compute dot product
+                float sum = 0.0f;
+                for (size_t c = 0; c < W_cols; c++) {
+                    sum += wr[c] * xf[c];
+                }
+                yf[r] = sum;
+            }
         }
 
-        yf[r] = sum;
         free(wdst);
     }
 
     free(xf);
 }
 
+/**
+ * Weight rows are the expensive operand, so they are decoded once per
+ * row and shared across the batch.
+ */
+void matmul_batch(Tensor* Y, Tensor* W, Tensor* X, size_t n) {
+    // Assert valid tensors
+    assert(Y && W && X);
+    // Assert activation types (W may be any type)
+    assert(Y->id == TYPE_F32);
+    assert(X->id == TYPE_F32);
+    // Assert shape types
+    assert(tensor_is_mat(Y));
+    assert(tensor_is_mat(W));
+    assert(tensor_is_mat(X));
+    // Assert dims match Y (n, r) = X (n, c) @ W^T (c, r)
+    assert(tensor_cols_match(X, W));  // match input
+    assert(tensor_cols_match_rows(Y, W));  // match output
+    assert(n <= tensor_rows(Y) && n <= tensor_rows(X));
+    // Extract input dimensions
+    const size_t W_rows = tensor_rows(W);
+    const size_t W_cols = tensor_cols(W);
+
+    float* yf = (float*) Y->data;
+    const float* xf = (float*) X->data;
+
+    // Launch parameters (see tune.h)
+    const TuneConfig cfg = tune_config(TUNE_OP_MATMUL_BATCH, W->id, W_rows, W_cols);
+    const int threads = cfg.threads > 0 ? cfg.threads : omp_get_max_threads();
+    const size_t tile = cfg.tile > 0 ? (size_t) cfg.tile : 1;
+    const size_t n_tiles = (W_rows + tile - 1) / tile;
+    const int chunk = cfg.chunk > 0 ? cfg.chunk : (int) ((n_tiles + threads - 1) / threads);
+    const size_t ahead = prefetch_distance(cfg.prefetch);
+
+#pragma omp parallel num_threads(threads)
+    {
+        float* wdst = malloc(tile * W_cols * sizeof(float));  // per-thread scratch tile
+
+#pragma omp for schedule(static, chunk)
+        for (size_t t = 0; t < n_tiles; t++) {
+            const size_t r0 = t * tile;
+            const size_t rows = r0 + tile < W_rows ? tile : W_rows - r0;
+            for (size_t j = 0; ahead && j < rows && r0 + j + ahead < W_rows; j++) {
+                prefetch_row(W, r0 + j + ahead);
+            }
+
+            // Decode the tile once; F32 rows are contiguous and used in place
+            const float* wt = wdst;
+            if (W->id == TYPE_F32) {
+                wt = (const float*) tensor_view_row(W, r0);
+            } else {
+                for (size_t j = 0; j < rows; j++) {
+                    dequant_vec(wdst + j * W_cols, tensor_view_row(W, r0 + j), W_cols, W->id);
+                }
+            }
+
+            // Each activation row is reused across the whole tile
+            for (size_t i = 0; i < n; i++) {
+                const float* xi = xf + i * W_cols;
+                for (size_t j = 0; j < rows; j++) {
+                    const float* wr = wt + j * W_cols;
+                    float sum = 0.0f;
+                    for (size_t c = 0; c < W_cols; c++) {
+                        sum += wr[c] * xi[c];
+                    }
+                    yf[i * W_rows + r0 + j] = sum;
+                }
+            }
+        }
+
+        free(wdst);
+    }
+}
+
 /**
  * This is fixed. Just propagate gradients through it.
  * @ref https://arxiv.org/abs/2104.09864
@@ -207,10 +308,13 @@ void forward_attn(Valerie* v, Layer* L, int pos) {
     // @ref https://arxiv.org/pdf/2305.13245
 #pragma omp parallel for
     for (int h = 0; h < d->heads; h++) {
-        int group = h / d->kv_mul;
         float* qh = tensor_view(&s->q, h * d->head_dim);
-        float* kh = tensor_view(&s->k, group * d->head_dim);
         rotary(qh, &v->rope, pos, d->head_dim);
+    }
+
+    // Each key group is shared by kv_mul query heads, so rotate it once
+    for (int g = 0; g < d->kv_heads; g++) {
+        float* kh = tensor_view(&s->k, g * d->head_dim);
         rotary(kh, &v->rope, pos, d->head_dim);
     }
 
@@ -257,34 +361,166 @@ void forward_attn(Valerie* v, Layer* L, int pos) {
     residual(&s->x, &s->x_norm);
 }
 
+// Decode columns [c0, c0 + len) of a weight row (c0 block-aligned for Q8)
+static void dequant_row_slice(float* dst, const Tensor* W, size_t r, size_t c0, size_t len) {
+    const void* row = tensor_view_row(W, r);
+    if (W->id == TYPE_Q8) {
+        const quant8_t* q = (const quant8_t*) row;
+        const quant8_t slice = {.q = q->q + c0, .w = q->w + c0 / Q8_BLOCK_SIZE};
+        dequant_vec(dst, &slice, len, TYPE_Q8);
+    } else {
+        dequant_vec(dst, (const uint8_t*) row + c0 * type_size(W->id), len, W->id);
+    }
+}
+
+/**
+ * Hidden units are independent until W2 sums them, so each thread owns a
+ * slice of them end-to-end and only its d_model-wide partial sums are shared.
+ */
+bool ffn_chunked(float* y, FeedForward* ffn, const float* x, size_t n) {
+    assert(y && ffn && x);
+    assert(tensor_rows_match(&ffn->W1, &ffn->W3));
+    assert(tensor_cols_match(&ffn->W1, &ffn->W3));
+    assert(tensor_cols(&ffn->W2) == tensor_rows(&ffn->W1));
+    const size_t hidden = tensor_rows(&ffn->W1);
+    const size_t d_model = tensor_cols(&ffn->W1);
+    assert(tensor_rows(&ffn->W2) == d_model);
+
+    // Launch parameters (see tune.h), keyed by the W1 shape
+    const TuneConfig cfg = tune_config(n == 1 ? TUNE_OP_FFN : TUNE_OP_FFN_BATCH, ffn->W1.id, hidden, d_model);
+    size_t tile = cfg.tile > 0 ? (size_t) cfg.tile : FFN_TILE;
+    if (ffn->W2.id == TYPE_Q8 && tile % Q8_BLOCK_SIZE != 0) {
+        tile = FFN_TILE;  // Q8 slices of W2 rows must start on a block boundary
+    }
+    const size_t n_tiles = (hidden + tile - 1) / tile;
+    int threads = cfg.threads > 0 ? cfg.threads : omp_get_max_threads();
+    threads = (size_t) threads > n_tiles ? (int) n_tiles : threads;
+    const int chunk = cfg.chunk > 0 ? cfg.chunk : (int) ((n_tiles + threads - 1) / threads);
+    const size_t ahead = prefetch_distance(cfg.prefetch);
+
+    float** partial = calloc(threads, sizeof(float*));  // per-thread (n, d_model)
+    if (!partial) {
+        LOG_ERROR("ffn_chunked: failed to allocate %d partial sums", threads);
+        return false;
+    }
+
+    // The runtime may start fewer threads than requested (OMP_DYNAMIC, nesting)
+    int team = 0;
+    bool ok = true;
+
+#pragma omp parallel num_threads(threads)
+    {
+#pragma omp single
+        team = omp_get_num_threads();
+
+        float* acc = calloc(n * d_model, sizeof(float));
+        float* w1 = malloc(d_model * sizeof(float));  // decoded W1 row
+        float* w3 = malloc(d_model * sizeof(float));  // decoded W3 row
+        float* w2 = malloc(tile * sizeof(float));  // decoded W2 row slice
+        float* act = malloc(n * tile * sizeof(float));  // SwiGLU of the tile
+        partial[omp_get_thread_num()] = acc;
+
+        const bool scratch = acc && w1 && w3 && w2 && act;
+        if (!scratch) {
+#pragma omp atomic write
+            ok = false;
+        }
+
+#pragma omp for schedule(static, chunk)
+        for (size_t t = 0; t < n_tiles; t++) {
+            if (!scratch) {
+                continue;  // the call fails; still take part in the loop
+            }
+
+            const size_t h0 = t * tile;
+            const size_t rows = h0 + tile < hidden ? tile : hidden - h0;
+
+            // Up-projection (W1) and gate (W3) for the tile's hidden units
+            for (size_t j = 0; j < rows; j++) {
+                if (ahead && h0 + j + ahead < hidden) {
+                    prefetch_row(&ffn->W1, h0 + j + ahead);
+                    prefetch_row(&ffn->W3, h0 + j + ahead);
+                }
+
+                const float* w1r = w1;
+                const float* w3r = w3;
+                if (ffn->W1.id == TYPE_F32) {
+                    w1r = (const float*) tensor_view_row(&ffn->W1, h0 + j);
+                    w3r = (const float*) tensor_view_row(&ffn->W3, h0 + j);
+                } else {
+                    dequant_vec(w1, tensor_view_row(&ffn->W1, h0 + j), d_model, ffn->W1.id);
+                    dequant_vec(w3, tensor_view_row(&ffn->W3, h0 + j), d_model, ffn->W3.id);
+                }
+
+                for (size_t i = 0; i < n; i++) {
+                    const float* xi = x + i * d_model;
+                    float up = 0.0f;
+                    float gate = 0.0f;
+                    for (size_t c = 0; c < d_model; c++) {
+                        up += w1r[c] * xi[c];
+                        gate += w3r[c] * xi[c];
+                    }
+                    act[i * tile + j] = up * silu(gate);  // SwiGLU
+                }
+            }
+
+            // Down-projection (W2): accumulate the tile's columns
+            for (size_t r = 0; r < d_model; r++) {
+                if (ahead && r + ahead < d_model) {
+                    prefetch_slice(&ffn->W2, r + ahead, h0, rows);
+                }
+                dequant_row_slice(w2, &ffn->W2, r, h0, rows);
+                for (size_t i = 0; i < n; i++) {
+                    const float* ai = act + i * tile;
+                    float sum = 0.0f;
+                    for (size_t j = 0; j < rows; j++) {
+                        sum += w2[j] * ai[j];
+                    }
+                    acc[i * d_model + r] += sum;
+                }
+            }
+        }
+
+        free(w1);
+        free(w3);
+        free(w2);
+        free(act);
+    }
+
+    // Reduce in thread order so results do not depend on timing
+    if (ok) {
+        const size_t len = n * d_model;
+#pragma omp parallel for
+        for (size_t k = 0; k < len; k++) {
+            float sum = 0.0f;
+            for (int p = 0; p < team; p++) {
+                sum += partial[p][k];
+            }
+            y[k] += sum;
+        }
+    } else {
+        LOG_ERROR("ffn_chunked: failed to allocate thread scratch (%zu rows)", n);
+    }
+
+    for (int p = 0; p < threads; p++) {
+        free(partial[p]);
+    }
+    free(partial);
+    return ok;
+}
+
 /**
  * Requires a backwards pass.
  * @ref https://deeplearningbook.org/contents/mlp.html#pf1
  */
-void forward_ffn(Valerie* v, Layer* L) {
-    Dim* d = &v->dim;
+bool forward_ffn(Valerie* v, Layer* L) {
     State* s = &v->state;
 
     // Normalize input
     rmsnorm(&s->x_norm, &L->ffn.norm, &s->x);
 
-    // Up-projection (W1)
-    matmul(&s->mlp_in, &L->ffn.W1, &s->x_norm);
-    // Gating path (W3)
-    matmul(&s->mlp_gate, &L->ffn.W3, &s->x_norm);
-
-    // SwiGLU (SiLU activation)
-    float* mlp_in = (float*) s->mlp_in.data;
-    float* mlp_gate = (float*) s->mlp_gate.data;
-    for (int i = 0; i < d->hidden; i++) {
-        mlp_in[i] *= silu(mlp_gate[i]);
-    }
-
-    // Down projection (W2)
-    matmul(&s->x_norm, &L->ffn.W2, &s->mlp_in);
-
-    // FFN residual connection
-    residual(&s->x, &s->x_norm);
+    // SwiGLU and down-projection, accumulated into the residual stream
+    return ffn_chunked((float*) s->x.data, &L->ffn, (const float*) s->x_norm.data, 1);
 }
 
 // Single-token forward pass (autoregressive)
@@ -304,14 +540,24 @@ float* forward(Valerie* v, int id, int pos) {
     // Iterate over model layers
     for (int l = 0; l < d->layers; l++) {
         Layer* L = &v->layers[l];
+        prefetch_layer(v->prefetch, l + 1);  // next layer, then the output projection
         forward_attn(v, L, pos);
-        forward_ffn(v, L);
+        if (!forward_ffn(v, L)) {
+            return NULL;
+        }
     }
 
     // Final layer normalization
     rmsnorm(&s->x_norm, &e->norm, &s->x);
 
     // Output projection (is always F32)
+    if (!s->logits.data) {
+        s->logits = tensor_new(shape_vec(d->vocab_size), TYPE_F32);
+        if (!s->logits.data) {
+            LOG_ERROR("forward: failed to allocate logits");
+            return NULL;
+        }
+    }
     matmul(&s->logits, &e->token, &s->x_norm);
     return s->logits.data;
 }
@@ -0,0 +1,310 @@
+/**
+ * @file chat.c
+ * @brief Chat completions engine with multi-turn KV cache reuse.
+ * @copyright Copyright © 2025 Austin Berrio
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "core/logger.h"
+#include "core/map.h"
+#include "linear/lehmer.h"
+#include "tokenizer/model.h"
+#include "model/valerie.h"
+#include "model/blocks.h"
+#include "model/session.h"
+#include "model/grammar.h"
+#include "model/chat.h"
+
+static const char* CHAT_ROLE_NAME[CHAT_ROLE_COUNT] = {
+    [CHAT_ROLE_SYSTEM] = "system",
+    [CHAT_ROLE_USER] = "user",
+    [CHAT_ROLE_ASSISTANT] = "assistant",
+};
+
+/**
+ * @section Private
+ * @{
+ */
+
+static int chat_token_id(Tokenizer* t, const char* token) {
+    int* id = token ? hash_map_search(t->token_to_id, token) : NULL;
+    return id ? *id : -1;
+}
+
+// Number of free context slots after everything queued is consumed
+static int chat_space(Chat* c) {
+    return c->session.capacity - c->session.pos - c->n_pending;
+}
+
+static bool chat_queue(Chat* c, int id) {
+    if (chat_space(c) <= 0) {
+        return false;
+    }
+    c->pending[c->n_pending++] = id;
+    return true;
+}
+
+// Render "<bos>role\n[content]" (+ "<eos>" when closed) and queue the ids
+static bool chat_queue_message(Chat* c, ChatRole role, const char* content, bool closed) {
+    if (role >= CHAT_ROLE_COUNT) {
+        return false;
+    }
+
+    const char* name = CHAT_ROLE_NAME[role];
+    size_t len = strlen(name) + 1 + (content ? strlen(content) : 0) + 1;
+    char* text = malloc(len);
+    if (!text) {
+        return false;
+    }
+    snprintf(text, len, "%s\n%s", name, content ? content : "");
+
+    int n_ids = 0;
+    int* ids = tokenizer_encode(&c->v->t, text, &n_ids, false, false);
+    free(text);
+    if (!ids) {
+        return false;
+    }
+
+    // Never queue a partial message
+    if (chat_space(c) < n_ids + 1 + (closed ? 1 : 0)) {
+        LOG_ERROR("chat: message of %d tokens does not fit in the context", n_ids);
+        free(ids);
+        return false;
+    }
+
+    chat_queue(c, c->bos);
+    for (int i = 0; i < n_ids; i++) {
+        chat_queue(c, ids[i]);
+    }
+    if (closed) {
+        chat_queue(c, c->eos);
+    }
+
+    free(ids);
+    return true;
+}
+
+// Forward queued tokens (the delta) and return the logits of the last one
+static float* chat_prefill(Chat* c) {
+    float* logits = NULL;
+    for (int i = 0; i < c->n_pending; i++) {
+        int id = c->pending[i];
+        logits = forward(c->v, id, c->session.pos);
+        v_session_push(&c->session, id);
+    }
+    c->n_pending = 0;
+    return logits;
+}
+
+// Incremental KMP step: returns true when the stop sequence completes
+static bool chat_stop_feed(ChatStop* stop, int id) {
+    while (stop->matched > 0 && stop->ids[stop->matched] != id) {
+        stop->matched = stop->fail[stop->matched - 1];
+    }
+    if (stop->ids[stop->matched] == id) {
+        stop->matched++;
+    }
+    if (stop->matched == stop->len) {
+        stop->matched = stop->fail[stop->len - 1];
+        return true;
+    }
+    return false;
+}
+
+/** @} */
+
+/**
+ * @section Chat life-cycle
+ * @{
+ */
+
+Chat chat_new(Valerie* v) {
+    Chat c = {0};
+
+    c.v = v;
+    c.session = v_session_new(&v->dim);
+    c.pending = calloc(v->dim.seq_len, sizeof(int));
+    if (!c.session.ids || !c.pending) {
+        LOG_ERROR("chat_new: failed to allocate chat history");
+        chat_free(&c);
+        return c;
+    }
+
+    // Messages are framed by <bos> ... <eos>; unmapped markers would reach forward() as -1
+    c.bos = chat_token_id(&v->t, v->t.special ? v->t.special->bos : NULL);
+    c.eos = chat_token_id(&v->t, v->t.special ? v->t.special->eos : NULL);
+    if (c.bos < 0 || c.eos < 0) {
+        LOG_ERROR("chat_new: tokenizer has no %s token", c.bos < 0 ? "bos" : "eos");
+        chat_free(&c);
+        return c;
+    }
+    c.max_tokens = v->dim.seq_len;
+    c.temperature = 0.0f;
+
+    return c;
+}
+
+void chat_free(Chat* c) {
+    if (c) {
+        v_session_free(&c->session);
+        free(c->pending);
+        for (int i = 0; i < c->n_stops; i++) {
+            free(c->stops[i].ids);
+            free(c->stops[i].fail);
+        }
+        free(c->stops);
+        c->pending = NULL;
+        c->stops = NULL;
+        c->n_pending = 0;
+        c->n_stops = 0;
+    }
+}
+
+bool chat_add_stop(Chat* c, const char* text) {
+    if (!c || !text || !*text) {
+        return false;
+    }
+
+    ChatStop stop = {0};
+    stop.ids = tokenizer_encode(&c->v->t, (char*) text, &stop.len, false, false);
+    if (!stop.ids || stop.len == 0) {
+        free(stop.ids);
+        return false;
+    }
+
+    // KMP prefix function over ids
+    stop.fail = calloc(stop.len, sizeof(int));
+    if (!stop.fail) {
+        free(stop.ids);
+        return false;
+    }
+    for (int i = 1, k = 0; i < stop.len; i++) {
+        while (k > 0 && stop.ids[i] != stop.ids[k]) {
+            k = stop.fail[k - 1];
+        }
+        if (stop.ids[i] == stop.ids[k]) {
+            k++;
+        }
+        stop.fail[i] = k;
+    }
+
+    ChatStop* stops = realloc(c->stops, (c->n_stops + 1) * sizeof(ChatStop));
+    if (!stops) {
+        free(stop.ids);
+        free(stop.fail);
+        return false;
+    }
+
+    c->stops = stops;
+    c->stops[c->n_stops++] = stop;
+    return true;
+}
+
+/** @} */
+
+/**
+ * @section Chat completions
+ * @{
+ */
+
+int chat_sample(float* logits, int n, float temperature) {
+    int best = 0;
+    for (int i = 1; i < n; i++) {
+        if (logits[i] > logits[best]) {
+            best = i;
+        }
+    }
+
+    if (temperature <= 0.0f) {
+        return best;  // greedy
+    }
+
+    float max = logits[best];
+    float sum = 0.0f;
+    for (int i = 0; i < n; i++) {
+        logits[i] = expf((logits[i] - max) / temperature);
+        sum += logits[i];
+    }
+
+    float r = lehmer_float() * sum;
+    float cdf = 0.0f;
+    for (int i = 0; i < n; i++) {
+        cdf += logits[i];
+        if (r < cdf) {
+            return i;
+        }
+    }
+
+    return best;  // rounding fallback
+}
+
+bool chat_push(Chat* c, ChatRole role, const char* content) {
+    if (!c || !c->pending || !content) {
+        return false;
+    }
+    return chat_queue_message(c, role, content, true);
+}
+
+int chat_reply(Chat* c, ChatRole role, const char* content, ChatStream stream, void* ctx) {
+    if (!c || !c->pending) {
+        return -1;
+    }
+
+    if (content && !chat_push(c, role, content)) {
+        return -1;
+    }
+
+    // Open the assistant turn
+    if (!chat_queue_message(c, CHAT_ROLE_ASSISTANT, NULL, false)) {
+        return -1;
+    }
+
+    float* logits = chat_prefill(c);
+    if (!logits) {
+        return -1;
+    }
+
+    for (int i = 0; i < c->n_stops; i++) {
+        c->stops[i].matched = 0;
+    }
+
+    int n_gen = 0;
+    while (true) {
+        if (c->grammar && !grammar_apply(c->grammar, logits)) {
+            break;  // nothing may follow (e.g. grammar completed)
+        }
+
+        int id = chat_sample(logits, c->v->dim.vocab_size, c->temperature);
+        if (c->grammar) {
+            grammar_accept(c->grammar, id);
+        }
+        if (id == c->eos) {
+            break;  // reply is closed below
+        }
+
+        n_gen++;
+        bool done = stream && !stream(id, ctx);
+        for (int i = 0; i < c->n_stops; i++) {
+            done |= chat_stop_feed(&c->stops[i], id);
+        }
+
+        // Keep one free slot to close the reply with <eos>
+        done |= n_gen >= c->max_tokens || chat_space(c) <= 2;
+        if (done) {
+            chat_queue(c, id);  // consumed on the next turn
+            break;
+        }
+
+        logits = forward(c->v, id, c->session.pos);
+        v_session_push(&c->session, id);
+    }
+
+    chat_queue(c, c->eos);
+    return n_gen;
+}
+
+/** @} */
@@ -0,0 +1,670 @@
+/**
+ * @file checkpoint.c
+ * @brief Model checkpoints: an aligned tensor file with a trailing directory.
+ * @copyright Copyright © 2025 Austin Berrio
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "core/checksum.h"
+#include "core/logger.h"
+#include "linear/q8.h"
+#include "linear/quant.h"
+#include "linear/tensor.h"
+#include "linear/type.h"
+#include "model/valerie.h"
+#include "model/checkpoint.h"
+
+/**
+ * @section Private
+ * @{
+ */
+
+/**
+ * @brief Named model tensor (borrowed).
+ */
+typedef struct CheckpointTensor {
+    char name[CHECKPOINT_NAME_MAX];
+    Tensor* t;
+} CheckpointTensor;
+
+// Trainable tensors of a model in file order; returns the count
+static int checkpoint_model_tensors(Valerie* v, CheckpointTensor* out) {
+    int n = 0;
+#define CHECKPOINT_ADD(tensor, ...) \
+    do { \
+        snprintf(out[n].name, CHECKPOINT_NAME_MAX, __VA_ARGS__); \
+        out[n++].t = (tensor); \
+    } while (0)
+
+    CHECKPOINT_ADD(&v->embed.token, "embed.token");
+    CHECKPOINT_ADD(&v->embed.norm, "embed.norm");
+    for (int l = 0; l < v->dim.layers; l++) {
+        Layer* L = &v->layers[l];
+        CHECKPOINT_ADD(&L->attn.Wq, "layers.%d.attn.Wq", l);
+        CHECKPOINT_ADD(&L->attn.Wk, "layers.%d.attn.Wk", l);
+        CHECKPOINT_ADD(&L->attn.Wv, "layers.%d.attn.Wv", l);
+        CHECKPOINT_ADD(&L->attn.Wo, "layers.%d.attn.Wo", l);
+        CHECKPOINT_ADD(&L->attn.norm, "layers.%d.attn.norm", l);
+        CHECKPOINT_ADD(&L->ffn.W1, "layers.%d.ffn.W1", l);
+        CHECKPOINT_ADD(&L->ffn.W2, "layers.%d.ffn.W2", l);
+        CHECKPOINT_ADD(&L->ffn.W3, "layers.%d.ffn.W3", l);
+        CHECKPOINT_ADD(&L->ffn.norm, "layers.%d.ffn.norm", l);
+    }
+
+#undef CHECKPOINT_ADD
+    return n;
+}
+
+static int checkpoint_model_count(const Dim* d) {
+    return 2 + 9 * d->layers;
+}
+
+// Q8 rows are stored flat as [q[cols] | w[cols / Q8_BLOCK_SIZE]]
+static void checkpoint_row_encode(uint8_t* dst, const float* src, size_t cols, TypeId dtype) {
+    switch (dtype) {
+        case TYPE_F32:
+            memcpy(dst, src, cols * sizeof(float));
+            break;
+        case TYPE_Q8: {
+            quant8_t q8 = {.q = (int8_t*) dst, .w = (int8_t*) dst + cols};
+            q8_vec_encode(&q8, src, cols);
+            break;
+        }
+        default:
+            quant_vec(dst, src, cols, dtype);
+            break;
+    }
+}
+
+static void checkpoint_row_decode(float* dst, const uint8_t* src, size_t cols, TypeId dtype) {
+    switch (dtype) {
+        case TYPE_F32:
+            memcpy(dst, src, cols * sizeof(float));
+            break;
+        case TYPE_Q8: {
+            // decode only reads through the view
+            quant8_t q8 = {.q = (int8_t*) src, .w = (int8_t*) src + cols};
+            q8_vec_decode(dst, &q8, cols);
+            break;
+        }
+        default:
+            dequant_vec(dst, src, cols, dtype);
+            break;
+    }
+}
+
+// Row r of a tensor (vectors have a single row)
+static void* checkpoint_tensor_row(const Tensor* t, size_t r) {
+    return tensor_is_mat(t) ? tensor_view_row(t, r) : t->data;
+}
+
+// Copy a tensor row into the file layout without a round trip through f32
+static void checkpoint_row_pack(uint8_t* dst, const Tensor* t, size_t r, size_t cols) {
+    const void* row = checkpoint_tensor_row(t, r);
+    if (t->id == TYPE_Q8) {
+        const quant8_t* q8 = (const quant8_t*) row;
+        memcpy(dst, q8->q, cols);
+        memcpy(dst + cols, q8->w, q8_block(cols));
+    } else {
+        memcpy(dst, row, cols * type_size(t->id));
+    }
+}
+
+static void checkpoint_row_unpack(Tensor* t, size_t r, const uint8_t* src, size_t cols) {
+    void* row = checkpoint_tensor_row(t, r);
+    if (t->id == TYPE_Q8) {
+        quant8_t* q8 = (quant8_t*) row;
+        memcpy(q8->q, src, cols);
+        memcpy(q8->w, src + cols, q8_block(cols));
+    } else {
+        memcpy(row, src, cols * type_size(t->id));
+    }
+}
+
+// Pad the file with zeros up to the next aligned offset
+static bool checkpoint_align(CheckpointWriter* w) {
+    static const uint8_t zeros[CHECKPOINT_ALIGN] = {0};
+    const size_t pad = (CHECKPOINT_ALIGN - w->offset % CHECKPOINT_ALIGN) % CHECKPOINT_ALIGN;
+    if (pad > 0 && fwrite(zeros, 1, pad, w->file) != pad) {
+        return false;
+    }
+    w->offset += pad;
+    return true;
+}
+
+// Reserve a directory entry and align the file for its data
+static CheckpointEntry* checkpoint_entry_new(
+    CheckpointWriter* w, const char* name, TypeId dtype, size_t rows, size_t cols, bool is_mat
+) {
+    if (strlen(name) >= CHECKPOINT_NAME_MAX) {
+        LOG_ERROR("checkpoint: tensor name '%s' is too long", name);
+        return NULL;
+    }
+    if (!checkpoint_dtype_is_valid(cols, dtype)) {
+        LOG_ERROR("checkpoint: '%s' (%zu cols) cannot be stored as %s", name, cols, type_name(dtype));
+        return NULL;
+    }
+
+    if (w->header.n_tensors == w->capacity) {
+        int capacity = w->capacity ? w->capacity * 2 : 64;
+        CheckpointEntry* entries = realloc(w->entries, capacity * sizeof(CheckpointEntry));
+        if (!entries) {
+            LOG_ERROR("checkpoint: failed to grow the directory");
+            return NULL;
+        }
+        w->entries = entries;
+        w->capacity = capacity;
+    }
+
+    if (!checkpoint_align(w)) {
+        LOG_ERROR("checkpoint: write failed");
+        return NULL;
+    }
+
+    CheckpointEntry* e = &w->entries[w->header.n_tensors];
+    memset(e, 0, sizeof(CheckpointEntry));
+    strcpy(e->name, name);
+    e->dtype = dtype;
+    e->rows = (int32_t) rows;
+    e->cols = (int32_t) cols;
+    e->is_mat = is_mat;
+    e->offset = w->offset;
+    e->size = rows * checkpoint_row_size(cols, dtype);
+    return e;
+}
+
+// Write an encoded tensor and commit its entry
+static bool checkpoint_entry_commit(CheckpointWriter* w, CheckpointEntry* e, const uint8_t* data) {
+    e->checksum = checksum_blocks(data, e->size);
+    if (fwrite(data, 1, e->size, w->file) != e->size) {
+        LOG_ERROR("checkpoint: failed to write '%s'", e->name);
+        return false;
+    }
+    w->offset += e->size;
+    w->header.n_tensors++;
+    return true;
+}
+
+/** @} */
+
+/**
+ * @section Rows
+ * @{
+ */
+
+size_t checkpoint_row_size(size_t cols, TypeId dtype) {
+    if (dtype == TYPE_Q8) {
+        return cols * sizeof(int8_t) + q8_block(cols) * sizeof(int8_t);  // q | w
+    }
+    return cols * type_size(dtype);
+}
+
+bool checkpoint_dtype_is_valid(size_t cols, TypeId dtype) {
+    if (dtype >= TYPE_COUNT) {
+        return false;
+    }
+    if (dtype == TYPE_Q8 && (cols < Q8_BLOCK_SIZE || cols % Q8_BLOCK_SIZE != 0)) {
+        return false;
+    }
+    return true;
+}
+
+/** @} */
+
+/**
+ * @section Reader
+ * @{
+ */
+
+Checkpoint* checkpoint_open(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        LOG_ERROR("checkpoint_open: failed to open '%s'", path);
+        return NULL;
+    }
+
+    struct stat st;
+    if (0 != fstat(fd, &st) || (size_t) st.st_size < sizeof(CheckpointHeader)) {
+        LOG_ERROR("checkpoint_open: '%s' is too small", path);
+        close(fd);
+        return NULL;
+    }
+
+    const size_t size = (size_t) st.st_size;
+    uint8_t* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // the mapping keeps the file open
+    if (MAP_FAILED == map) {
+        LOG_ERROR("checkpoint_open: failed to map '%s'", path);
+        return NULL;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    Checkpoint* ck = calloc(1, sizeof(Checkpoint));
+    if (!ck) {
+        munmap(map, size);
+        return NULL;
+    }
+    ck->map = map;
+    ck->size = size;
+    memcpy(&ck->header, map, sizeof(CheckpointHeader));
+
+    const CheckpointHeader* h = &ck->header;
+    if (h->magic != CHECKPOINT_MAGIC || h->version != CHECKPOINT_VERSION) {
+        LOG_ERROR("checkpoint_open: '%s' is not a version %d checkpoint", path, CHECKPOINT_VERSION);
+        goto fail;
+    }
+    if (h->q8_block != Q8_BLOCK_SIZE) {
+        LOG_ERROR("checkpoint_open: Q8 block size %d (expected %d)", h->q8_block, Q8_BLOCK_SIZE);
+        goto fail;
+    }
+    if (h->n_tensors < 0 || h->dir_offset > size
+        || (size - h->dir_offset) / sizeof(CheckpointEntry) < (size_t) h->n_tensors) {
+        LOG_ERROR("checkpoint_open: '%s' has a truncated directory", path);
+        goto fail;
+    }
+
+    ck->entries = (const CheckpointEntry*) (map + h->dir_offset);
+    if (checksum64(ck->entries, h->n_tensors * sizeof(CheckpointEntry), 0) != h->dir_checksum) {
+        LOG_ERROR("checkpoint_open: '%s' has a corrupt directory", path);
+        goto fail;
+    }
+    for (int i = 0; i < h->n_tensors; i++) {
+        const CheckpointEntry* e = &ck->entries[i];
+        const bool valid = e->dtype >= 0 && e->dtype < TYPE_COUNT && e->rows > 0 && e->cols > 0
+                           && memchr(e->name, '\0', CHECKPOINT_NAME_MAX)
+                           && e->size == (uint64_t) e->rows * checkpoint_row_size(e->cols, e->dtype)
+                           && e->offset <= h->dir_offset && e->size <= h->dir_offset - e->offset;
+        if (!valid) {
+            LOG_ERROR("checkpoint_open: '%s' has a corrupt directory entry %d", path, i);
+            goto fail;
+        }
+    }
+
+    ck->verify = true;
+    return ck;
+
+fail:
+    checkpoint_close(ck);
+    return NULL;
+}
+
+void checkpoint_close(Checkpoint* ck) {
+    if (ck) {
+        munmap(ck->map, ck->size);
+        free(ck);
+    }
+}
+
+const CheckpointEntry* checkpoint_find(const Checkpoint* ck, const char* name) {
+    for (int i = 0; i < ck->header.n_tensors; i++) {
+        if (0 == strncmp(ck->entries[i].name, name, CHECKPOINT_NAME_MAX)) {
+            return &ck->entries[i];
+        }
+    }
+    return NULL;
+}
+
+bool checkpoint_read(const Checkpoint* ck, const CheckpointEntry* e, Tensor* dst) {
+    const size_t rows = tensor_is_mat(dst) ? tensor_rows(dst) : 1;
+    const size_t cols = tensor_cols(dst);
+    if (rows != (size_t) e->rows || cols != (size_t) e->cols) {
+        LOG_ERROR("checkpoint_read: '%s' is (%d, %d), expected (%zu, %zu)", e->name, e->rows, e->cols, rows, cols);
+        return false;
+    }
+
+    if (ck->verify && !checkpoint_verify(ck, e)) {
+        return false;
+    }
+
+    const TypeId src_id = (TypeId) e->dtype;
+    const size_t row_size = checkpoint_row_size(cols, src_id);
+    const uint8_t* src = ck->map + e->offset;
+
+    // Same type: rows are already in the kernel's layout
+    if (src_id == dst->id) {
+        if (dst->id != TYPE_Q8) {
+            memcpy(dst->data, src, e->size);
+            return true;
+        }
+#pragma omp parallel for
+        for (size_t r = 0; r < rows; r++) {
+            checkpoint_row_unpack(dst, r, src + r * row_size, cols);
+        }
+        return true;
+    }
+
+    if (!checkpoint_dtype_is_valid(cols, dst->id)) {
+        LOG_ERROR("checkpoint_read: '%s' cannot be converted to %s", e->name, type_name(dst->id));
+        return false;
+    }
+
+    bool ok = true;
+#pragma omp parallel
+    {
+        float* scratch = malloc(cols * sizeof(float));
+        if (!scratch) {
+#pragma omp atomic write
+            ok = false;
+        }
+#pragma omp for
+        for (size_t r = 0; r < rows; r++) {
+            if (scratch) {
+                checkpoint_row_decode(scratch, src + r * row_size, cols, src_id);
+                quant_vec(checkpoint_tensor_row(dst, r), scratch, cols, dst->id);
+            }
+        }
+        free(scratch);
+    }
+
+    if (!ok) {
+        LOG_ERROR("checkpoint_read: failed to allocate scratch for '%s'", e->name);
+    }
+    return ok;
+}
+
+bool checkpoint_verify(const Checkpoint* ck, const CheckpointEntry* e) {
+    if (checksum_blocks(ck->map + e->offset, e->size) != e->checksum) {
+        LOG_ERROR("checkpoint: '%s' failed its checksum", e->name);
+        return false;
+    }
+    return true;
+}
+
+int checkpoint_verify_all(const Checkpoint* ck) {
+    const int n = ck->header.n_tensors;
+
+    // Flatten (tensor, block) pairs so small and large tensors balance
+    size_t* first = malloc((n + 1) * sizeof(size_t));  // first block of each tensor
+    if (!first) {
+        return n;
+    }
+    first[0] = 0;
+    for (int i = 0; i < n; i++) {
+        first[i + 1] = first[i] + checksum_block_count(ck->entries[i].size);
+    }
+
+    const size_t total = first[n];
+    uint64_t* digests = malloc((total ? total : 1) * sizeof(uint64_t));
+    if (!digests) {
+        free(first);
+        return n;
+    }
+
+#pragma omp parallel
+    {
+        int i = 0;  // tensor of the current block; blocks are visited in order per thread
+#pragma omp for schedule(static)
+        for (size_t b = 0; b < total; b++) {
+            while (first[i + 1] <= b) {
+                i++;
+            }
+            const CheckpointEntry* e = &ck->entries[i];
+            digests[b] = checksum_block(ck->map + e->offset, e->size, b - first[i]);
+        }
+    }
+
+    int corrupt = 0;
+    for (int i = 0; i < n; i++) {
+        const CheckpointEntry* e = &ck->entries[i];
+        if (checksum_combine(digests + first[i], e->size) != e->checksum) {
+            LOG_ERROR("checkpoint: '%s' failed its checksum", e->name);
+            corrupt++;
+        }
+    }
+
+    free(digests);
+    free(first);
+    return corrupt;
+}
+
+void checkpoint_release(const Checkpoint* ck, const CheckpointEntry* e) {
+    // Round inwards to whole pages; partial pages are shared with neighbours
+    const size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    const size_t begin = (e->offset + page - 1) / page * page;
+    const size_t end = (e->offset + e->size) / page * page;
+    if (end > begin) {
+        madvise(ck->map + begin, end - begin, MADV_DONTNEED);
+    }
+}
+
+/** @} */
+
+/**
+ * @section Writer
+ * @{
+ */
+
+CheckpointWriter* checkpoint_writer_new(const char* path, Params params, TypeId dtype) {
+    CheckpointWriter* w = calloc(1, sizeof(CheckpointWriter));
+    if (!w) {
+        return NULL;
+    }
+
+    w->file = fopen(path, "wb");
+    if (!w->file) {
+        LOG_ERROR("checkpoint_writer_new: failed to open '%s'", path);
+        free(w);
+        return NULL;
+    }
+
+    w->header = (CheckpointHeader) {
+        .magic = CHECKPOINT_MAGIC,
+        .version = CHECKPOINT_VERSION,
+        .q8_block = Q8_BLOCK_SIZE,
+        .dtype = dtype,
+        .params = params,
+    };
+
+    // Placeholder; the final header is written on close
+    if (fwrite(&w->header, sizeof(CheckpointHeader), 1, w->file) != 1) {
+        LOG_ERROR("checkpoint_writer_new: failed to write '%s'", path);
+        fclose(w->file);
+        free(w);
+        return NULL;
+    }
+    w->offset = sizeof(CheckpointHeader);
+    return w;
+}
+
+bool checkpoint_write(CheckpointWriter* w, const char* name, const Tensor* t) {
+    const size_t rows = tensor_is_mat(t) ? tensor_rows(t) : 1;
+    const size_t cols = tensor_cols(t);
+    CheckpointEntry* e = checkpoint_entry_new(w, name, t->id, rows, cols, tensor_is_mat(t));
+    if (!e) {
+        return false;
+    }
+
+    // Dense tensors are already packed
+    if (t->id != TYPE_Q8) {
+        return checkpoint_entry_commit(w, e, t->data);
+    }
+
+    uint8_t* data = malloc(e->size);
+    if (!data) {
+        LOG_ERROR("checkpoint_write: failed to allocate '%s'", name);
+        return false;
+    }
+
+    const size_t row_size = checkpoint_row_size(cols, t->id);
+#pragma omp parallel for
+    for (size_t r = 0; r < rows; r++) {
+        checkpoint_row_pack(data + r * row_size, t, r, cols);
+    }
+
+    bool ok = checkpoint_entry_commit(w, e, data);
+    free(data);
+    return ok;
+}
+
+bool checkpoint_convert(CheckpointWriter* w, const Checkpoint* src, const CheckpointEntry* e, TypeId dtype) {
+    const size_t rows = (size_t) e->rows;
+    const size_t cols = (size_t) e->cols;
+    CheckpointEntry* out = checkpoint_entry_new(w, e->name, dtype, rows, cols, e->is_mat);
+    if (!out) {
+        return false;
+    }
+
+    if (src->verify && !checkpoint_verify(src, e)) {
+        return false;
+    }
+
+    const TypeId src_id = (TypeId) e->dtype;
+    const uint8_t* in = src->map + e->offset;
+    if (src_id == dtype) {
+        bool ok = checkpoint_entry_commit(w, out, in);
+        checkpoint_release(src, e);
+        return ok;
+    }
+
+    uint8_t* data = malloc(out->size);
+    if (!data) {
+        LOG_ERROR("checkpoint_convert: failed to allocate '%s'", e->name);
+        return false;
+    }
+
+    const size_t in_size = checkpoint_row_size(cols, src_id);
+    const size_t out_size = checkpoint_row_size(cols, dtype);
+    bool ok = true;
+#pragma omp parallel
+    {
+        float* scratch = malloc(cols * sizeof(float));
+        if (!scratch) {
+#pragma omp atomic write
+            ok = false;
+        }
+#pragma omp for schedule(static)
+        for (size_t r = 0; r < rows; r++) {
+            if (scratch) {
+                checkpoint_row_decode(scratch, in + r * in_size, cols, src_id);
+                checkpoint_row_encode(data + r * out_size, scratch, cols, dtype);
+            }
+        }
+        free(scratch);
+    }
+
+    if (!ok) {
+        LOG_ERROR("checkpoint_convert: failed to allocate scratch for '%s'", e->name);
+        free(data);
+        return false;
+    }
+
+    ok = checkpoint_entry_commit(w, out, data);
+    free(data);
+    checkpoint_release(src, e);
+    return ok;
+}
+
+bool checkpoint_writer_close(CheckpointWriter* w) {
+    if (!w) {
+        return false;
+    }
+
+    bool ok = checkpoint_align(w);
+    w->header.dir_offset = w->offset;
+    const size_t n = (size_t) w->header.n_tensors;
+    w->header.dir_checksum = checksum64(w->entries, n * sizeof(CheckpointEntry), 0);
+    ok = ok && fwrite(w->entries, sizeof(CheckpointEntry), n, w->file) == n;
+    ok = ok && 0 == fseek(w->file, 0, SEEK_SET);
+    ok = ok && fwrite(&w->header, sizeof(CheckpointHeader), 1, w->file) == 1;
+    ok = 0 == fclose(w->file) && ok;
+    if (!ok) {
+        LOG_ERROR("checkpoint_writer_close: write failed");
+    }
+
+    free(w->entries);
+    free(w);
+    return ok;
+}
+
+/** @} */
+
+/**
+ * @section Model
+ * @{
+ */
+
+bool v_model_save(Valerie* v, const char* path) {
+    const Dim* d = &v->dim;
+    const Params params = {
+        .d_model = d->d_model,
+        .heads = d->heads,
+        .kv_heads = d->kv_heads,
+        .hidden_mul = d->hidden / d->d_model,
+        .layers = d->layers,
+        .seq_len = d->seq_len,
+        .vocab_size = d->vocab_size,
+    };
+
+    CheckpointTensor* tensors = malloc(checkpoint_model_count(d) * sizeof(CheckpointTensor));
+    CheckpointWriter* w = tensors ? checkpoint_writer_new(path, params, v->dtype) : NULL;
+    if (!w) {
+        free(tensors);
+        return false;
+    }
+
+    bool ok = true;
+    const int n = checkpoint_model_tensors(v, tensors);
+    for (int i = 0; ok && i < n; i++) {
+        ok = checkpoint_write(w, tensors[i].name, tensors[i].t);
+    }
+
+    ok = checkpoint_writer_close(w) && ok;
+    free(tensors);
+    return ok;
+}
+
+Valerie v_model_load(Tokenizer t, const char* path) {
+    Checkpoint* ck = checkpoint_open(path);
+    if (!ck) {
+        return (Valerie) {.t = t};
+    }
+
+    const CheckpointHeader* h = &ck->header;
+    if (h->params.vocab_size != t.vocab_size || h->dtype < 0 || h->dtype >= TYPE_COUNT) {
+        LOG_ERROR("v_model_load: '%s' does not match the tokenizer (vocabulary %d)", path, t.vocab_size);
+        checkpoint_close(ck);
+        return (Valerie) {.t = t};
+    }
+
+    Valerie v = v_model_new(t, h->params, (TypeId) h->dtype);
+    CheckpointTensor* tensors = malloc(checkpoint_model_count(&v.dim) * sizeof(CheckpointTensor));
+    if (!v.layers || !tensors) {
+        LOG_ERROR("v_model_load: failed to allocate the model");
+        free(tensors);
+        checkpoint_close(ck);
+        return v;
+    }
+
+    // One tensor per task; rows are decoded serially inside a task
+    const int n = checkpoint_model_tensors(&v, tensors);
+    bool ok = true;
+#pragma omp parallel for schedule(dynamic) reduction(&& : ok)
+    for (int i = 0; i < n; i++) {
+        const CheckpointEntry* e = checkpoint_find(ck, tensors[i].name);
+        if (!e) {
+            LOG_ERROR("v_model_load: '%s' is missing", tensors[i].name);
+            ok = false;
+        } else {
+            ok = checkpoint_read(ck, e, tensors[i].t) && ok;
+        }
+    }
+
+    free(tensors);
+    checkpoint_close(ck);
+    if (!ok) {
+        v_layers_free(v.layers, v.dim.layers);
+        v.layers = NULL;
+    }
+    return v;
+}
+
+/** @} */
@@ -0,0 +1,212 @@
+/**
+ * @file embedder.c
+ * @brief Pooled sentence embeddings from the final hidden states.
+ * @copyright Copyright © 2025 Austin Berrio
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "core/logger.h"
+#include "linear/tensor.h"
+#include "model/valerie.h"
+#include "model/paged.h"
+#include "model/batch.h"
+#include "model/embedder.h"
+
+/**
+ * @section Private
+ * @{
+ */
+
+static int embedder_len(const Embedder* e, const int* lens, int input) {
+    int len = lens[input];
+    return len < e->v->dim.seq_len ? len : e->v->dim.seq_len;
+}
+
+// Reduce accumulated hidden states into the final vector
+static void embedder_finish(Embedder* e, float* vec, int len) {
+    const int d_model = e->v->dim.d_model;
+
+    if (e->pooling == EMBED_POOL_MEAN && len > 0) {
+        const float inv = 1.0f / (float) len;
+        for (int i = 0; i < d_model; i++) {
+            vec[i] *= inv;
+        }
+    }
+
+    if (e->normalize) {
+        float sum = 0.0f;
+        for (int i = 0; i < d_model; i++) {
+            sum += vec[i] * vec[i];
+        }
+        if (sum > 0.0f) {
+            const float inv = 1.0f / sqrtf(sum);
+            for (int i = 0; i < d_model; i++) {
+                vec[i] *= inv;
+            }
+        }
+    }
+}
+
+/** @} */
+
+/**
+ * @section Embedder life-cycle
+ * @{
+ */
+
+Embedder embedder_new(Valerie* v, int n_seqs, int capacity, EmbedPool pooling) {
+    Embedder e = {0};
+    if (!v || n_seqs < 1 || capacity < 1) {
+        return e;
+    }
+
+    const Dim* d = &v->dim;
+    const int seq_blocks = (d->seq_len + KV_BLOCK_SIZE - 1) / KV_BLOCK_SIZE;
+
+    e.pool = kv_pool_new(d, seq_blocks * n_seqs, KV_BLOCK_SIZE);
+    e.batch = batch_new(d, capacity);
+    e.seqs = calloc(n_seqs, sizeof(KVSeq));
+    e.input = calloc(n_seqs, sizeof(int));
+    e.cursor = calloc(n_seqs, sizeof(int));
+    if (0 == e.pool.max_blocks || 0 == e.batch.capacity || !e.seqs || !e.input || !e.cursor) {
+        LOG_ERROR("embedder_new: failed to allocate %d sessions", n_seqs);
+        embedder_free(&e);
+        return e;
+    }
+
+    for (int i = 0; i < n_seqs; i++) {
+        e.seqs[i] = kv_seq_new(&e.pool, d);
+        if (!e.seqs[i].blocks) {
+            e.n_seqs = i;
+            embedder_free(&e);
+            return e;
+        }
+    }
+
+    e.v = v;
+    e.n_seqs = n_seqs;
+    e.pooling = pooling;
+    e.normalize = true;
+    return e;
+}
+
+void embedder_free(Embedder* e) {
+    if (e) {
+        for (int i = 0; e->seqs && i < e->n_seqs; i++) {
+            kv_seq_free(&e->pool, &e->seqs[i]);
+        }
+        free(e->seqs);
+        free(e->input);
+        free(e->cursor);
+        batch_free(&e->batch);
+        kv_pool_free(&e->pool);
+        *e = (Embedder) {0};
+    }
+}
+
+/** @} */
+
+/**
+ * @section Embedding
+ * @{
+ */
+
+bool embedder_encode(Embedder* e, const int* const* ids, const int* lens, int n, float* out) {
+    if (!e || !e->v || !ids || !lens || n < 0 || !out) {
+        return false;
+    }
+
+    const int d_model = e->v->dim.d_model;
+    Batch* b = &e->batch;
+    b->pool = &e->pool;  // Embedder is returned by value, so bind here
+
+    memset(out, 0, (size_t) n * d_model * sizeof(float));
+    for (int s = 0; s < e->n_seqs; s++) {
+        e->input[s] = -1;
+    }
+
+    int next = 0;  // next input to admit
+    int active = 0;  // sessions holding an input
+    while (true) {
+        // Admit pending inputs into idle sessions
+        for (int s = 0; s < e->n_seqs && next < n; s++) {
+            if (e->input[s] >= 0) {
+                continue;
+            }
+            while (next < n && embedder_len(e, lens, next) <= 0) {
+                next++;  // empty inputs keep their zero vector
+            }
+            if (next < n) {
+                e->input[s] = next++;
+                e->cursor[s] = 0;
+                active++;
+            }
+        }
+        if (active == 0) {
+            break;
+        }
+
+        // Round-robin one position per session until the batch is full
+        batch_clear(b);
+        bool pushed = true;
+        while (pushed && b->n < b->capacity) {
+            pushed = false;
+            for (int s = 0; s < e->n_seqs && b->n < b->capacity; s++) {
+                int input = e->input[s];
+                if (input < 0 || e->cursor[s] >= embedder_len(e, lens, input)) {
+                    continue;
+                }
+                int pos = e->cursor[s]++;
+                batch_push_paged(b, ids[input][pos], pos, &e->seqs[s], false);
+                pushed = true;
+            }
+        }
+
+        if (!forward_batch_hidden(e->v, b)) {
+            // Return the blocks of every session so the embedder stays reusable
+            for (int s = 0; s < e->n_seqs; s++) {
+                if (e->input[s] >= 0) {
+                    kv_seq_clear(&e->pool, &e->seqs[s]);
+                    e->input[s] = -1;
+                }
+            }
+            return false;
+        }
+
+        // Pool the normalized hidden states of each row into its input
+        for (int i = 0; i < b->n; i++) {
+            int s = (int) (b->seq[i] - e->seqs);
+            int input = e->input[s];
+            int len = embedder_len(e, lens, input);
+            float* vec = out + (size_t) input * d_model;
+            const float* h = tensor_view_row(&b->x_norm, i);
+
+            if (e->pooling == EMBED_POOL_MEAN) {
+                for (int k = 0; k < d_model; k++) {
+                    vec[k] += h[k];
+                }
+            } else if (b->pos[i] == len - 1) {
+                memcpy(vec, h, d_model * sizeof(float));
+            }
+        }
+
+        // Retire finished sessions
+        for (int s = 0; s < e->n_seqs; s++) {
+            int input = e->input[s];
+            if (input >= 0 && e->cursor[s] >= embedder_len(e, lens, input)) {
+                int len = embedder_len(e, lens, input);
+                embedder_finish(e, out + (size_t) input * d_model, len);
+                kv_seq_clear(&e->pool, &e->seqs[s]);
+                e->input[s] = -1;
+                active--;
+            }
+        }
+    }
+
+    return true;
+}
+
+/** @} */
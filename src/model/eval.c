@@ -0,0 +1,267 @@
+/**
+ * @file eval.c
+ * @brief Batched perplexity and continuation scoring.
+ * @copyright Copyright © 2025 Austin Berrio
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "core/logger.h"
+#include "model/valerie.h"
+#include "model/paged.h"
+#include "model/batch.h"
+#include "model/eval.h"
+
+/**
+ * @section Private
+ * @{
+ */
+
+// Position of the next window to hand out
+typedef struct EvalCursor {
+    int doc;
+    int begin;
+    int prev_end;  // end of the previous window of the document
+} EvalCursor;
+
+// log softmax(logits)[target] with one online log-sum-exp pass
+static float eval_logprob(const float* logits, int n, int target) {
+    float max = -INFINITY;
+    float sum = 0.0f;
+    for (int i = 0; i < n; i++) {
+        float x = logits[i];
+        if (x > max) {
+            sum = sum * expf(max - x) + 1.0f;
+            max = x;
+        } else {
+            sum += expf(x - max);
+        }
+    }
+    return logits[target] - max - logf(sum);
+}
+
+// Next window with at least one target to score; false when none is left
+static bool eval_next_window(
+    const Evaluator* e, EvalCursor* c, const int* lens, const int* offsets, int n, EvalWindow* w
+) {
+    while (c->doc < n) {
+        const int len = lens[c->doc];
+        const int first = offsets && offsets[c->doc] > 1 ? offsets[c->doc] : 1;
+
+        if (len < 2 || first >= len) {
+            *c = (EvalCursor) {c->doc + 1, 0, 0};
+            continue;
+        }
+
+        EvalWindow cur = {.doc = c->doc, .begin = c->begin};
+        cur.end = c->begin + e->window < len ? c->begin + e->window : len;
+        cur.score_from = c->begin + 1 > c->prev_end ? c->begin + 1 : c->prev_end;
+        cur.score_from = cur.score_from > first ? cur.score_from : first;
+        cur.cursor = cur.begin;
+
+        // Windows before the first target are skipped entirely
+        if (cur.end >= len) {
+            *c = (EvalCursor) {c->doc + 1, 0, 0};
+        } else {
+            c->prev_end = cur.end;
+            c->begin += e->stride;
+        }
+
+        if (cur.score_from < cur.end) {
+            *w = cur;
+            return true;
+        }
+    }
+    return false;
+}
+
+/** @} */
+
+/**
+ * @section Evaluator life-cycle
+ * @{
+ */
+
+Evaluator eval_new(Valerie* v, int n_seqs, int capacity, int window, int stride) {
+    Evaluator e = {0};
+    if (!v || n_seqs < 1 || capacity < 1 || window < 2) {
+        return e;
+    }
+
+    const Dim* d = &v->dim;
+    window = window < d->seq_len ? window : d->seq_len;
+    stride = stride < 1 ? 1 : (stride > window ? window : stride);
+    const int win_blocks = (window + KV_BLOCK_SIZE - 1) / KV_BLOCK_SIZE;
+
+    e.pool = kv_pool_new(d, win_blocks * n_seqs, KV_BLOCK_SIZE);
+    e.batch = batch_new(d, capacity);
+    e.seqs = calloc(n_seqs, sizeof(KVSeq));
+    e.windows = calloc(n_seqs, sizeof(EvalWindow));
+    e.targets = calloc(capacity, sizeof(int));
+    e.logprobs = calloc(capacity, sizeof(float));
+    if (0 == e.pool.max_blocks || 0 == e.batch.capacity || !e.seqs || !e.windows || !e.targets
+        || !e.logprobs) {
+        LOG_ERROR("eval_new: failed to allocate %d sessions", n_seqs);
+        eval_free(&e);
+        return e;
+    }
+
+    for (int i = 0; i < n_seqs; i++) {
+        e.seqs[i] = kv_seq_new(&e.pool, d);
+        if (!e.seqs[i].blocks) {
+            e.n_seqs = i;
+            eval_free(&e);
+            return e;
+        }
+    }
+
+    e.v = v;
+    e.n_seqs = n_seqs;
+    e.window = window;
+    e.stride = stride;
+    return e;
+}
+
+void eval_free(Evaluator* e) {
+    if (e) {
+        for (int i = 0; e->seqs && i < e->n_seqs; i++) {
+            kv_seq_free(&e->pool, &e->seqs[i]);
+        }
+        free(e->seqs);
+        free(e->windows);
+        free(e->targets);
+        free(e->logprobs);
+        batch_free(&e->batch);
+        kv_pool_free(&e->pool);
+        *e = (Evaluator) {0};
+    }
+}
+
+/** @} */
+
+/**
+ * @section Scoring
+ * @{
+ */
+
+bool eval_score(
+    Evaluator* e,
+    const int* const* ids,
+    const int* lens,
+    const int* offsets,
+    int n,
+    double* loglik,
+    int* n_tokens
+) {
+    if (!e || !e->v || !ids || !lens || n < 0 || !loglik) {
+        return false;
+    }
+
+    const int vocab_size = e->v->dim.vocab_size;
+    Batch* b = &e->batch;
+    b->pool = &e->pool;  // Evaluator is returned by value, so bind here
+
+    for (int i = 0; i < n; i++) {
+        loglik[i] = 0.0;
+        if (n_tokens) {
+            n_tokens[i] = 0;
+        }
+    }
+    for (int s = 0; s < e->n_seqs; s++) {
+        e->windows[s].doc = -1;
+    }
+    e->n_forward = 0;
+    e->n_scored = 0;
+
+    EvalCursor cursor = {0};
+    int active = 0;
+    while (true) {
+        // Hand out windows to idle sessions
+        for (int s = 0; s < e->n_seqs; s++) {
+            if (e->windows[s].doc < 0
+                && eval_next_window(e, &cursor, lens, offsets, n, &e->windows[s])) {
+                active++;
+            }
+        }
+        if (active == 0) {
+            break;
+        }
+
+        // Round-robin one position per window until the batch is full.
+        // Position t predicts t + 1; the last token of a window predicts nothing.
+        batch_clear(b);
+        bool pushed = true;
+        while (pushed && b->n < b->capacity) {
+            pushed = false;
+            for (int s = 0; s < e->n_seqs && b->n < b->capacity; s++) {
+                EvalWindow* w = &e->windows[s];
+                if (w->doc < 0 || w->cursor >= w->end - 1) {
+                    continue;
+                }
+                const int t = w->cursor++;
+                const bool want = t + 1 >= w->score_from;
+                int row = batch_push_paged(b, ids[w->doc][t], t - w->begin, &e->seqs[s], want);
+                e->targets[row] = want ? ids[w->doc][t + 1] : -1;
+                pushed = true;
+            }
+        }
+
+        if (!forward_batch(e->v, b)) {
+            // Return the blocks of every window so the evaluator stays reusable
+            for (int s = 0; s < e->n_seqs; s++) {
+                if (e->windows[s].doc >= 0) {
+                    kv_seq_clear(&e->pool, &e->seqs[s]);
+                    e->windows[s].doc = -1;
+                }
+            }
+            return false;
+        }
+        e->n_forward += b->n;
+
+        // Fused log-softmax and target gather
+#pragma omp parallel for
+        for (int i = 0; i < b->n; i++) {
+            if (e->targets[i] >= 0) {
+                e->logprobs[i] = eval_logprob(batch_logits(b, i), vocab_size, e->targets[i]);
+            }
+        }
+
+        for (int i = 0; i < b->n; i++) {
+            if (e->targets[i] < 0) {
+                continue;
+            }
+            const int doc = e->windows[b->seq[i] - e->seqs].doc;
+            loglik[doc] += (double) e->logprobs[i];
+            if (n_tokens) {
+                n_tokens[doc]++;
+            }
+            e->n_scored++;
+        }
+
+        // Retire finished windows
+        for (int s = 0; s < e->n_seqs; s++) {
+            EvalWindow* w = &e->windows[s];
+            if (w->doc >= 0 && w->cursor >= w->end - 1) {
+                kv_seq_clear(&e->pool, &e->seqs[s]);
+                w->doc = -1;
+                active--;
+            }
+        }
+    }
+
+    return true;
+}
+
+double eval_perplexity(const double* loglik, const int* n_tokens, int n) {
+    double sum = 0.0;
+    long count = 0;
+    for (int i = 0; i < n; i++) {
+        sum += loglik[i];
+        count += n_tokens[i];
+    }
+    return count > 0 ? exp(-sum / (double) count) : (double) NAN;
+}
+
+/** @} */
@@ -0,0 +1,976 @@
+/**
+ * @file grammar.c
+ * @brief Constrained decoding: restrict sampled tokens to a regular language.
+ * @copyright Copyright © 2025 Austin Berrio
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "core/logger.h"
+#include "core/map.h"
+#include "tokenizer/model.h"
+#include "model/grammar.h"
+
+#define GRAMMAR_DEAD (-1)  // no continuation
+#define GRAMMAR_UNKNOWN (-2)  // transition not computed yet
+
+/**
+ * @section Private types
+ * @{
+ */
+
+typedef struct ByteSet {
+    uint64_t bits[4];
+} ByteSet;
+
+typedef enum AstType {
+    AST_EMPTY,
+    AST_SET,
+    AST_CAT,
+    AST_ALT,
+    AST_REPEAT,
+} AstType;
+
+typedef struct Ast {
+    AstType type;
+    ByteSet set;  // AST_SET
+    struct Ast* a;  // CAT/ALT left, REPEAT child
+    struct Ast* b;  // CAT/ALT right
+    int min;  // REPEAT lower bound
+    int max;  // REPEAT upper bound (-1 is unbounded)
+} Ast;
+
+typedef struct Parser {
+    const char* src;
+    size_t pos;
+    bool error;
+} Parser;
+
+typedef enum NfaType {
+    NFA_SET,  // consume a byte in set, then go to out
+    NFA_SPLIT,  // epsilon to out and out1
+    NFA_MATCH,  // accepting
+} NfaType;
+
+typedef struct NfaNode {
+    NfaType type;
+    int out;
+    int out1;
+    ByteSet set;
+} NfaNode;
+
+typedef struct DfaState {
+    int* set;  // sorted NFA SET/MATCH nodes
+    int n;  // number of nodes in set
+    bool accept;  // contains NFA_MATCH
+    int next[256];  // byte transitions (GRAMMAR_UNKNOWN until computed)
+    uint64_t* mask;  // allowed tokens (lazily computed)
+} DfaState;
+
+struct Grammar {
+    Tokenizer* t;  // borrowed tokenizer
+
+    // Thompson NFA
+    NfaNode* nodes;
+    int n_nodes;
+    int cap_nodes;
+    int start;  // start node
+
+    // Lazy DFA
+    DfaState* states;
+    int n_states;
+    int cap_states;
+    int* table;  // open addressing: state set -> DFA id
+    int table_size;
+
+    // Closure scratch (n_nodes,)
+    int* stack;
+    int* list;
+    unsigned* mark;
+    unsigned generation;
+
+    // Vocabulary
+    size_t* token_len;  // byte length per token (vocab_size,)
+    bool* special;  // special token flags (vocab_size,)
+    int eos;  // end-of-sequence id
+    int words;  // mask words
+
+    // Decoding state
+    int state;  // current DFA state
+    bool done;  // eos accepted
+};
+
+/** @} */
+
+/**
+ * @section Byte sets
+ * @{
+ */
+
+static void set_add(ByteSet* s, unsigned c) {
+    s->bits[c >> 6] |= 1ull << (c & 63);
+}
+
+static void set_range(ByteSet* s, unsigned lo, unsigned hi) {
+    for (unsigned c = lo; c <= hi; c++) {
+        set_add(s, c);
+    }
+}
+
+static bool set_has(const ByteSet* s, unsigned c) {
+    return (s->bits[c >> 6] >> (c & 63)) & 1;
+}
+
+static void set_union(ByteSet* dst, const ByteSet* src) {
+    for (int i = 0; i < 4; i++) {
+        dst->bits[i] |= src->bits[i];
+    }
+}
+
+static void set_negate(ByteSet* s) {
+    for (int i = 0; i < 4; i++) {
+        s->bits[i] = ~s->bits[i];
+    }
+}
+
+/** @} */
+
+/**
+ * @section Parser
+ * @{
+ */
+
+static Ast* ast_new(AstType type, Ast* a, Ast* b) {
+    Ast* node = calloc(1, sizeof(Ast));
+    if (node) {
+        node->type = type;
+        node->a = a;
+        node->b = b;
+    }
+    return node;
+}
+
+static void ast_free(Ast* node) {
+    if (node) {
+        ast_free(node->a);
+        ast_free(node->b);
+        free(node);
+    }
+}
+
+static char parser_peek(Parser* p) {
+    return p->src[p->pos];
+}
+
+static bool parser_eat(Parser* p, char c) {
+    if (p->src[p->pos] == c) {
+        p->pos++;
+        return true;
+    }
+    return false;
+}
+
+static int parser_hex(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// Parse the escape after a backslash into a byte set
+static bool parser_escape(Parser* p, ByteSet* s) {
+    char c = p->src[p->pos++];
+    ByteSet e = {0};
+    bool negate = false;
+
+    switch (c) {
+        case '\0':
+            return false;
+        case 'D':
+            negate = true;
+            // fall through
+        case 'd':
+            set_range(&e, '0', '9');
+            break;
+        case 'W':
+            negate = true;
+            // fall through
+        case 'w':
+            set_range(&e, 'a', 'z');
+            set_range(&e, 'A', 'Z');
+            set_range(&e, '0', '9');
+            set_add(&e, '_');
+            break;
+        case 'S':
+            negate = true;
+            // fall through
+        case 's':
+            set_add(&e, ' ');
+            set_range(&e, '\t', '\r');
+            break;
+        case 'n':
+            set_add(&e, '\n');
+            break;
+        case 'r':
+            set_add(&e, '\r');
+            break;
+        case 't':
+            set_add(&e, '\t');
+            break;
+        case 'x': {
+            int hi = parser_hex(p->src[p->pos]);
+            int lo = hi < 0 ? -1 : parser_hex(p->src[p->pos + 1]);
+            if (lo < 0) {
+                return false;
+            }
+            p->pos += 2;
+            set_add(&e, (unsigned) (hi * 16 + lo));
+            break;
+        }
+        default:
+            set_add(&e, (unsigned char) c);  // escaped literal
+            break;
+    }
+
+    if (negate) {
+        set_negate(&e);
+    }
+    set_union(s, &e);
+    return true;
+}
+
+// Single byte of a class range endpoint; returns -1 for class escapes (\d etc.)
+static int parser_class_byte(Parser* p, ByteSet* s) {
+    char c = p->src[p->pos];
+    if (c == '\\') {
+        p->pos++;
+        char e = p->src[p->pos];
+        if (e == 'd' || e == 'D' || e == 'w' || e == 'W' || e == 's' || e == 'S') {
+            if (!parser_escape(p, s)) {
+                p->error = true;
+            }
+            return -1;
+        }
+        ByteSet one = {0};
+        if (!parser_escape(p, &one)) {
+            p->error = true;
+            return -1;
+        }
+        for (unsigned b = 0; b < 256; b++) {
+            if (set_has(&one, b)) {
+                return (int) b;
+            }
+        }
+        return -1;
+    }
+    p->pos++;
+    return (unsigned char) c;
+}
+
+static Ast* parser_class(Parser* p) {
+    Ast* node = ast_new(AST_SET, NULL, NULL);
+    if (!node) {
+        p->error = true;
+        return NULL;
+    }
+
+    bool negate = parser_eat(p, '^');
+    bool first = true;
+    while (!p->error && parser_peek(p) != '\0' && (first || parser_peek(p) != ']')) {
+        first = false;
+        int lo = parser_class_byte(p, &node->set);
+        if (lo < 0) {
+            continue;
+        }
+        if (parser_peek(p) == '-' && p->src[p->pos + 1] != ']' && p->src[p->pos + 1] != '\0') {
+            p->pos++;
+            int hi = parser_class_byte(p, &node->set);
+            if (hi < lo) {
+                p->error = true;
+                break;
+            }
+            set_range(&node->set, (unsigned) lo, (unsigned) hi);
+        } else {
+            set_add(&node->set, (unsigned) lo);
+        }
+    }
+
+    if (!parser_eat(p, ']')) {
+        p->error = true;
+    }
+    if (negate) {
+        set_negate(&node->set);
+    }
+    return node;
+}
+
+static Ast* parser_alt(Parser* p);
+
+static Ast* parser_atom(Parser* p) {
+    char c = parser_peek(p);
+    Ast* node = NULL;
+
+    switch (c) {
+        case '(':
+            p->pos++;
+            if (parser_peek(p) == '?' && p->src[p->pos + 1] == ':') {
+                p->pos += 2;  // non-capturing group
+            }
+            node = parser_alt(p);
+            if (!parser_eat(p, ')')) {
+                p->error = true;
+            }
+            return node;
+        case '[':
+            p->pos++;
+            return parser_class(p);
+        case '.':
+            p->pos++;
+            node = ast_new(AST_SET, NULL, NULL);
+            if (node) {
+                set_range(&node->set, 0, 255);
+                node->set.bits['\n' >> 6] &= ~(1ull << ('\n' & 63));
+            }
+            break;
+        case '\\':
+            p->pos++;
+            node = ast_new(AST_SET, NULL, NULL);
+            if (node && !parser_escape(p, &node->set)) {
+                p->error = true;
+            }
+            break;
+        case '*':
+        case '+':
+        case '?':
+        case '{':
+        case ')':
+        case '|':
+        case '\0':
+            p->error = true;
+            return NULL;
+        default:
+            p->pos++;
+            node = ast_new(AST_SET, NULL, NULL);
+            if (node) {
+                set_add(&node->set, (unsigned char) c);
+            }
+            break;
+    }
+
+    if (!node) {
+        p->error = true;
+    }
+    return node;
+}
+
+static bool parser_int(Parser* p, int* value) {
+    if (parser_peek(p) < '0' || parser_peek(p) > '9') {
+        return false;
+    }
+    int v = 0;
+    while (parser_peek(p) >= '0' && parser_peek(p) <= '9') {
+        v = v * 10 + (p->src[p->pos++] - '0');
+        if (v > GRAMMAR_MAX_REPEAT) {
+            return false;
+        }
+    }
+    *value = v;
+    return true;
+}
+
+static Ast* parser_repeat(Parser* p) {
+    Ast* node = parser_atom(p);
+
+    while (!p->error) {
+        int min = 0;
+        int max = -1;
+        char c = parser_peek(p);
+        if (c == '*') {
+            p->pos++;
+        } else if (c == '+') {
+            p->pos++;
+            min = 1;
+        } else if (c == '?') {
+            p->pos++;
+            max = 1;
+        } else if (c == '{') {
+            p->pos++;
+            if (!parser_int(p, &min)) {
+                p->error = true;
+                break;
+            }
+            max = min;
+            if (parser_eat(p, ',')) {
+                max = -1;
+                if (parser_peek(p) != '}' && (!parser_int(p, &max) || max < min)) {
+                    p->error = true;
+                    break;
+                }
+            }
+            if (!parser_eat(p, '}')) {
+                p->error = true;
+                break;
+            }
+        } else {
+            break;
+        }
+
+        Ast* repeat = ast_new(AST_REPEAT, node, NULL);
+        if (!repeat) {
+            p->error = true;
+            break;
+        }
+        repeat->min = min;
+        repeat->max = max;
+        node = repeat;
+    }
+
+    return node;
+}
+
+static Ast* parser_cat(Parser* p) {
+    Ast* node = ast_new(AST_EMPTY, NULL, NULL);
+    while (!p->error && node) {
+        char c = parser_peek(p);
+        if (c == '\0' || c == '|' || c == ')') {
+            break;
+        }
+        Ast* next = parser_repeat(p);
+        node = ast_new(AST_CAT, node, next);
+    }
+    if (!node) {
+        p->error = true;
+    }
+    return node;
+}
+
+static Ast* parser_alt(Parser* p) {
+    Ast* node = parser_cat(p);
+    while (!p->error && parser_eat(p, '|')) {
+        Ast* next = parser_cat(p);
+        node = ast_new(AST_ALT, node, next);
+        if (!node) {
+            p->error = true;
+        }
+    }
+    return node;
+}
+
+static Ast* parser_parse(const char* pattern) {
+    Parser p = {.src = pattern};
+    parser_eat(&p, '^');  // always anchored
+
+    Ast* root = parser_alt(&p);
+    parser_eat(&p, '$');
+    if (!p.error && parser_peek(&p) != '\0') {
+        p.error = true;  // unbalanced ')'
+    }
+
+    if (p.error) {
+        LOG_ERROR("grammar: invalid pattern at offset %zu: %s", p.pos, pattern);
+        ast_free(root);
+        return NULL;
+    }
+    return root;
+}
+
+/** @} */
+
+/**
+ * @section NFA
+ * @{
+ */
+
+static int nfa_add(Grammar* g, NfaType type, int out, int out1, const ByteSet* set) {
+    if (g->n_nodes == g->cap_nodes) {
+        int cap = g->cap_nodes ? g->cap_nodes * 2 : 64;
+        NfaNode* nodes = realloc(g->nodes, cap * sizeof(NfaNode));
+        if (!nodes) {
+            return -1;
+        }
+        g->nodes = nodes;
+        g->cap_nodes = cap;
+    }
+
+    NfaNode* n = &g->nodes[g->n_nodes];
+    n->type = type;
+    n->out = out;
+    n->out1 = out1;
+    n->set = set ? *set : (ByteSet) {0};
+    return g->n_nodes++;
+}
+
+// Compile with an explicit continuation: returns the entry node leading to next
+static int nfa_compile(Grammar* g, const Ast* node, int next) {
+    if (next < 0) {
+        return -1;
+    }
+
+    switch (node->type) {
+        case AST_EMPTY:
+            return next;
+        case AST_SET:
+            return nfa_add(g, NFA_SET, next, -1, &node->set);
+        case AST_CAT:
+            return nfa_compile(g, node->a, nfa_compile(g, node->b, next));
+        case AST_ALT: {
+            int a = nfa_compile(g, node->a, next);
+            int b = nfa_compile(g, node->b, next);
+            return (a < 0 || b < 0) ? -1 : nfa_add(g, NFA_SPLIT, a, b, NULL);
+        }
+        case AST_REPEAT: {
+            int tail = next;
+            if (node->max < 0) {
+                // x* : loop back through a split
+                int loop = nfa_add(g, NFA_SPLIT, -1, next, NULL);
+                int body = nfa_compile(g, node->a, loop);
+                if (loop < 0 || body < 0) {
+                    return -1;
+                }
+                g->nodes[loop].out = body;
+                tail = loop;
+            } else {
+                // (x(x)?)? : nested optional copies
+                for (int i = node->min; i < node->max && tail >= 0; i++) {
+                    int body = nfa_compile(g, node->a, tail);
+                    tail = body < 0 ? -1 : nfa_add(g, NFA_SPLIT, body, next, NULL);
+                }
+            }
+            for (int i = 0; i < node->min && tail >= 0; i++) {
+                tail = nfa_compile(g, node->a, tail);
+            }
+            return tail;
+        }
+    }
+
+    return -1;
+}
+
+/** @} */
+
+/**
+ * @section Lazy DFA
+ * @{
+ */
+
+static int int_compare(const void* a, const void* b) {
+    int x = *(const int*) a;
+    int y = *(const int*) b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t dfa_hash(const int* set, int n) {
+    uint64_t h = 1469598103934665603ull;  // FNV-1a
+    for (int i = 0; i < n; i++) {
+        h ^= (uint64_t) (unsigned) set[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// Epsilon closure of the seeds into g->list; returns the number of kept nodes
+static int dfa_closure(Grammar* g, const int* seeds, int n_seeds) {
+    if (++g->generation == 0) {
+        memset(g->mark, 0, g->n_nodes * sizeof(unsigned));
+        g->generation = 1;
+    }
+
+    int top = 0;
+    int n = 0;
+    for (int i = 0; i < n_seeds; i++) {
+        g->stack[top++] = seeds[i];
+    }
+
+    while (top > 0) {
+        int s = g->stack[--top];
+        if (g->mark[s] == g->generation) {
+            continue;
+        }
+        g->mark[s] = g->generation;
+
+        NfaNode* node = &g->nodes[s];
+        if (node->type == NFA_SPLIT) {
+            g->stack[top++] = node->out;
+            g->stack[top++] = node->out1;
+        } else {
+            g->list[n++] = s;
+        }
+    }
+
+    qsort(g->list, n, sizeof(int), int_compare);
+    return n;
+}
+
+static bool dfa_table_grow(Grammar* g) {
+    int size = g->table_size ? g->table_size * 2 : 256;
+    int* table = malloc(size * sizeof(int));
+    if (!table) {
+        return false;
+    }
+    for (int i = 0; i < size; i++) {
+        table[i] = -1;
+    }
+
+    for (int id = 0; id < g->n_states; id++) {
+        DfaState* st = &g->states[id];
+        size_t h = dfa_hash(st->set, st->n) & (size - 1);
+        while (table[h] >= 0) {
+            h = (h + 1) & (size - 1);
+        }
+        table[h] = id;
+    }
+
+    free(g->table);
+    g->table = table;
+    g->table_size = size;
+    return true;
+}
+
+// Find or add the DFA state for g->list[0, n)
+static int dfa_intern(Grammar* g, int n) {
+    if (n == 0) {
+        return GRAMMAR_DEAD;
+    }
+
+    if ((g->n_states + 1) * 2 > g->table_size && !dfa_table_grow(g)) {
+        return GRAMMAR_DEAD;
+    }
+
+    size_t h = dfa_hash(g->list, n) & (g->table_size - 1);
+    while (g->table[h] >= 0) {
+        DfaState* st = &g->states[g->table[h]];
+        if (st->n == n && memcmp(st->set, g->list, n * sizeof(int)) == 0) {
+            return g->table[h];
+        }
+        h = (h + 1) & (g->table_size - 1);
+    }
+
+    if (g->n_states >= GRAMMAR_MAX_STATES) {
+        LOG_ERROR("grammar: DFA exceeded %d states", GRAMMAR_MAX_STATES);
+        return GRAMMAR_DEAD;
+    }
+
+    if (g->n_states == g->cap_states) {
+        int cap = g->cap_states ? g->cap_states * 2 : 64;
+        DfaState* states = realloc(g->states, cap * sizeof(DfaState));
+        if (!states) {
+            return GRAMMAR_DEAD;
+        }
+        g->states = states;
+        g->cap_states = cap;
+    }
+
+    DfaState* st = &g->states[g->n_states];
+    st->set = malloc(n * sizeof(int));
+    if (!st->set) {
+        return GRAMMAR_DEAD;
+    }
+    memcpy(st->set, g->list, n * sizeof(int));
+    st->n = n;
+    st->mask = NULL;
+    st->accept = false;
+    for (int i = 0; i < n; i++) {
+        st->accept |= g->nodes[st->set[i]].type == NFA_MATCH;
+    }
+    for (int c = 0; c < 256; c++) {
+        st->next[c] = GRAMMAR_UNKNOWN;
+    }
+
+    g->table[h] = g->n_states;
+    return g->n_states++;
+}
+
+static int dfa_step(Grammar* g, int state, unsigned char c) {
+    if (state < 0) {
+        return GRAMMAR_DEAD;
+    }
+
+    int next = g->states[state].next[c];
+    if (next != GRAMMAR_UNKNOWN) {
+        return next;
+    }
+
+    // Seeds are the successors of every SET node that accepts c
+    DfaState* st = &g->states[state];
+    int n_seeds = 0;
+    int* seeds = malloc(st->n * sizeof(int));
+    if (!seeds) {
+        return GRAMMAR_DEAD;
+    }
+    for (int i = 0; i < st->n; i++) {
+        NfaNode* node = &g->nodes[st->set[i]];
+        if (node->type == NFA_SET && set_has(&node->set, c)) {
+            seeds[n_seeds++] = node->out;
+        }
+    }
+
+    next = dfa_intern(g, dfa_closure(g, seeds, n_seeds));
+    free(seeds);
+
+    g->states[state].next[c] = next;  // states may have moved
+    return next;
+}
+
+static int dfa_walk(Grammar* g, int state, const char* bytes, size_t len) {
+    for (size_t i = 0; i < len && state >= 0; i++) {
+        state = dfa_step(g, state, (unsigned char) bytes[i]);
+    }
+    return state;
+}
+
+/** @} */
+
+/**
+ * @section Grammar life-cycle
+ * @{
+ */
+
+Grammar* grammar_new(Tokenizer* t, const char* pattern) {
+    if (!t || !pattern) {
+        return NULL;
+    }
+
+    Ast* root = parser_parse(pattern);
+    if (!root) {
+        return NULL;
+    }
+
+    Grammar* g = calloc(1, sizeof(Grammar));
+    if (!g) {
+        ast_free(root);
+        return NULL;
+    }
+    g->t = t;
+    g->eos = -1;
+
+    int match = nfa_add(g, NFA_MATCH, -1, -1, NULL);
+    g->start = nfa_compile(g, root, match);
+    ast_free(root);
+    if (g->start < 0) {
+        LOG_ERROR("grammar: failed to compile pattern");
+        grammar_free(g);
+        return NULL;
+    }
+
+    // Closure scratch: seeds plus two successors per expanded split
+    g->stack = malloc(3 * g->n_nodes * sizeof(int));
+    g->list = malloc(g->n_nodes * sizeof(int));
+    g->mark = calloc(g->n_nodes, sizeof(unsigned));
+
+    // Token byte lengths and special flags
+    g->words = (t->vocab_size + 63) / 64;
+    g->token_len = calloc(t->vocab_size, sizeof(size_t));
+    g->special = calloc(t->vocab_size, sizeof(bool));
+    if (!g->stack || !g->list || !g->mark || !g->token_len || !g->special) {
+        grammar_free(g);
+        return NULL;
+    }
+
+    SpecialToken* sp = t->special;
+    for (int id = 0; id < t->vocab_size; id++) {
+        const char* token = t->id_to_token[id];
+        g->token_len[id] = strlen(token);
+        if (sp) {
+            g->special[id] = (sp->bos && strcmp(token, sp->bos) == 0)
+                             || (sp->eos && strcmp(token, sp->eos) == 0)
+                             || (sp->pad && strcmp(token, sp->pad) == 0)
+                             || (sp->unk && strcmp(token, sp->unk) == 0);
+        }
+    }
+    int* eos = sp && sp->eos ? hash_map_search(t->token_to_id, sp->eos) : NULL;
+    g->eos = eos ? *eos : -1;
+
+    g->state = dfa_intern(g, dfa_closure(g, &g->start, 1));
+    if (g->state < 0) {
+        grammar_free(g);
+        return NULL;
+    }
+
+    return g;
+}
+
+// JSON value with at most depth nested containers, as a pattern
+static char* grammar_json_value(int depth) {
+    static const char* ws = "[ \\t\\n\\r]*";
+    static const char* string = "\"([^\"\\\\\\x00-\\x1f]|\\\\[\"\\\\/bfnrt]|\\\\u[0-9a-fA-F]{4})*\"";
+    static const char* number = "-?(0|[1-9][0-9]*)(\\.[0-9]+)?([eE][+-]?[0-9]+)?";
+    static const char* leaf_fmt = "(%s|%s|true|false|null)";
+
+    if (depth <= 0) {
+        size_t len = (size_t) snprintf(NULL, 0, leaf_fmt, string, number) + 1;
+        char* out = malloc(len);
+        if (out) {
+            snprintf(out, len, leaf_fmt, string, number);
+        }
+        return out;
+    }
+
+    char* inner = grammar_json_value(depth - 1);
+    char* leaf = grammar_json_value(0);
+    if (!inner || !leaf) {
+        free(inner);
+        free(leaf);
+        return NULL;
+    }
+
+    // value | { ws (member (, member)*)? } | [ ws (value ws (, ws value ws)*)? ]
+    // member = string ws : ws value ws
+    const char* fmt = "(%s"
+                      "|\\{%s(%s%s:%s%s%s(,%s%s%s:%s%s%s)*)?\\}"
+                      "|\\[%s(%s%s(,%s%s%s)*)?\\])";
+    size_t len = (size_t) snprintf(NULL, 0, fmt, leaf, ws, string, ws, ws, inner, ws, ws, string, ws,
+                                   ws, inner, ws, ws, inner, ws, ws, inner, ws)
+                 + 1;
+    char* out = malloc(len);
+    if (out) {
+        snprintf(out, len, fmt, leaf, ws, string, ws, ws, inner, ws, ws, string, ws, ws, inner, ws, ws,
+                 inner, ws, ws, inner, ws);
+    }
+
+    free(inner);
+    free(leaf);
+    return out;
+}
+
+Grammar* grammar_json(Tokenizer* t, int depth) {
+    char* pattern = grammar_json_value(depth);
+    if (!pattern) {
+        return NULL;
+    }
+    Grammar* g = grammar_new(t, pattern);
+    free(pattern);
+    return g;
+}
+
+void grammar_free(Grammar* g) {
+    if (g) {
+        for (int i = 0; i < g->n_states; i++) {
+            free(g->states[i].set);
+            free(g->states[i].mask);
+        }
+        free(g->states);
+        free(g->table);
+        free(g->nodes);
+        free(g->stack);
+        free(g->list);
+        free(g->mark);
+        free(g->token_len);
+        free(g->special);
+        free(g);
+    }
+}
+
+void grammar_reset(Grammar* g) {
+    if (g) {
+        g->state = 0;  // start state is always interned first
+        g->done = false;
+    }
+}
+
+/** @} */
+
+/**
+ * @section Token masks
+ * @{
+ */
+
+const uint64_t* grammar_mask(Grammar* g) {
+    if (!g || g->state < 0) {
+        return NULL;
+    }
+
+    const int state = g->state;
+    if (g->states[state].mask) {
+        return g->states[state].mask;  // cached
+    }
+
+    uint64_t* mask = calloc(g->words, sizeof(uint64_t));
+    if (!mask) {
+        return NULL;
+    }
+
+    // Walking tokens may add states, so never hold a DfaState pointer here
+    for (int id = 0; id < g->t->vocab_size; id++) {
+        bool allowed;
+        if (g->special[id]) {
+            allowed = id == g->eos && g->states[state].accept;
+        } else {
+            allowed = g->token_len[id] > 0
+                      && dfa_walk(g, state, g->t->id_to_token[id], g->token_len[id]) >= 0;
+        }
+        if (allowed) {
+            mask[id >> 6] |= 1ull << (id & 63);
+        }
+    }
+
+    g->states[state].mask = mask;
+    return mask;
+}
+
+bool grammar_apply(Grammar* g, float* logits) {
+    const uint64_t* mask = g->done ? NULL : grammar_mask(g);
+    if (!mask) {
+        return false;
+    }
+
+    const int vocab_size = g->t->vocab_size;
+    uint64_t any = 0;
+    for (int w = 0; w < g->words; w++) {
+        uint64_t bits = mask[w];
+        any |= bits;
+        if (bits == UINT64_MAX) {
+            continue;  // every token in this word is allowed
+        }
+
+        int base = w * 64;
+        int end = base + 64 < vocab_size ? base + 64 : vocab_size;
+        for (int id = base; id < end; id++) {
+            if (!((bits >> (id - base)) & 1)) {
+                logits[id] = -INFINITY;
+            }
+        }
+    }
+
+    return any != 0;
+}
+
+bool grammar_accept(Grammar* g, int id) {
+    if (!g || g->done || g->state < 0 || id < 0 || id >= g->t->vocab_size) {
+        return false;
+    }
+
+    if (g->special[id]) {
+        if (id == g->eos && g->states[g->state].accept) {
+            g->done = true;
+            return true;
+        }
+        return false;
+    }
+
+    int next = dfa_walk(g, g->state, g->t->id_to_token[id], g->token_len[id]);
+    if (next < 0) {
+        return false;
+    }
+
+    g->state = next;
+    return true;
+}
+
+bool grammar_is_accepting(Grammar* g) {
+    return g && g->state >= 0 && g->states[g->state].accept;
+}
+
+bool grammar_is_done(const Grammar* g) {
+    return g && g->done;
+}
+
+/** @} */
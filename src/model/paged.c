@@ -0,0 +1,187 @@
+/**
+ * @file paged.c
+ * @brief Paged key/value cache with reference-counted, copy-on-write blocks.
+ * @copyright Copyright © 2025 Austin Berrio
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+
+#include "core/logger.h"
+#include "model/valerie.h"
+#include "model/paged.h"
+
+/**
+ * @section Pool life-cycle
+ * @{
+ */
+
+KVPool kv_pool_new(const Dim* d, int max_blocks, int block_size) {
+    assert(d && max_blocks > 0 && block_size > 0);
+
+    KVPool pool = {0};
+    pool.data = calloc(max_blocks, sizeof(float*));
+    pool.refs = calloc(max_blocks, sizeof(int));
+    pool.free = calloc(max_blocks, sizeof(int));
+    if (!pool.data || !pool.refs || !pool.free) {
+        LOG_ERROR("kv_pool_new: failed to allocate %d block slots", max_blocks);
+        kv_pool_free(&pool);
+        return pool;
+    }
+
+    pool.max_blocks = max_blocks;
+    pool.block_size = block_size;
+    pool.layers = d->layers;
+    pool.kv_dim = d->kv_dim;
+    return pool;
+}
+
+void kv_pool_free(KVPool* pool) {
+    if (pool) {
+        for (int i = 0; pool->data && i < pool->n_alloc; i++) {
+            free(pool->data[i]);
+        }
+        free(pool->data);
+        free(pool->refs);
+        free(pool->free);
+        *pool = (KVPool) {0};
+    }
+}
+
+/** @} */
+
+/**
+ * @section Blocks
+ * @{
+ */
+
+size_t kv_block_floats(const KVPool* pool) {
+    return (size_t) pool->layers * 2 * pool->block_size * pool->kv_dim;
+}
+
+int kv_pool_alloc(KVPool* pool) {
+    int id = -1;
+    if (pool->n_free > 0) {
+        id = pool->free[--pool->n_free];
+    } else if (pool->n_alloc < pool->max_blocks) {
+        float* data = malloc(kv_block_floats(pool) * sizeof(float));
+        if (!data) {
+            LOG_ERROR("kv_pool_alloc: failed to allocate a block");
+            return -1;
+        }
+        id = pool->n_alloc++;
+        pool->data[id] = data;
+    } else {
+        LOG_ERROR("kv_pool_alloc: pool exhausted (%d blocks)", pool->max_blocks);
+        return -1;
+    }
+
+    pool->refs[id] = 1;
+    if (++pool->used > pool->peak) {
+        pool->peak = pool->used;
+    }
+    return id;
+}
+
+void kv_pool_release(KVPool* pool, int id) {
+    assert(pool->refs[id] > 0);
+    if (--pool->refs[id] == 0) {
+        pool->free[pool->n_free++] = id;
+        pool->used--;
+    }
+}
+
+/** @} */
+
+/**
+ * @section Sequences
+ * @{
+ */
+
+KVSeq kv_seq_new(const KVPool* pool, const Dim* d) {
+    KVSeq seq = {0};
+    int capacity = (d->seq_len + pool->block_size - 1) / pool->block_size;
+    seq.blocks = calloc(capacity, sizeof(int));
+    if (!seq.blocks) {
+        LOG_ERROR("kv_seq_new: failed to allocate a block table");
+        return seq;
+    }
+    seq.capacity = capacity;
+    return seq;
+}
+
+void kv_seq_free(KVPool* pool, KVSeq* seq) {
+    if (seq) {
+        kv_seq_clear(pool, seq);
+        free(seq->blocks);
+        *seq = (KVSeq) {0};
+    }
+}
+
+void kv_seq_clear(KVPool* pool, KVSeq* seq) {
+    if (seq) {
+        for (int i = 0; i < seq->n_blocks; i++) {
+            kv_pool_release(pool, seq->blocks[i]);
+        }
+        seq->n_blocks = 0;
+    }
+}
+
+bool kv_seq_fork(KVPool* pool, KVSeq* dst, const KVSeq* src) {
+    if (!dst->blocks || dst->n_blocks != 0 || dst->capacity < src->n_blocks) {
+        return false;
+    }
+
+    for (int i = 0; i < src->n_blocks; i++) {
+        dst->blocks[i] = src->blocks[i];
+        pool->refs[src->blocks[i]]++;
+    }
+    dst->n_blocks = src->n_blocks;
+    return true;
+}
+
+bool kv_seq_reserve(KVPool* pool, KVSeq* seq, int pos) {
+    int b = pos / pool->block_size;
+    if (pos < 0 || b >= seq->capacity) {
+        return false;
+    }
+
+    // Map missing blocks up to pos
+    while (seq->n_blocks <= b) {
+        int id = kv_pool_alloc(pool);
+        if (id < 0) {
+            return false;
+        }
+        seq->blocks[seq->n_blocks++] = id;
+    }
+
+    // Copy on write
+    int id = seq->blocks[b];
+    if (pool->refs[id] > 1) {
+        int copy = kv_pool_alloc(pool);
+        if (copy < 0) {
+            return false;
+        }
+        memcpy(pool->data[copy], pool->data[id], kv_block_floats(pool) * sizeof(float));
+        kv_pool_release(pool, id);
+        seq->blocks[b] = copy;
+        pool->copies++;
+    }
+
+    return true;
+}
+
+float* kv_key(const KVPool* pool, const KVSeq* seq, int layer, int pos) {
+    const int bs = pool->block_size;
+    float* block = pool->data[seq->blocks[pos / bs]];
+    return block + ((size_t) (layer * 2) * bs + pos % bs) * pool->kv_dim;
+}
+
+float* kv_value(const KVPool* pool, const KVSeq* seq, int layer, int pos) {
+    const int bs = pool->block_size;
+    float* block = pool->data[seq->blocks[pos / bs]];
+    return block + ((size_t) (layer * 2 + 1) * bs + pos % bs) * pool->kv_dim;
+}
+
+/** @} */
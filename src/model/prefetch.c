@@ -0,0 +1,148 @@
+/**
+ * @file prefetch.c
+ * @brief Helper thread that warms the next layer's weights.
+ * @copyright Copyright © 2025 Austin Berrio
+ */
+
+#include <stdlib.h>
+
+#include "core/logger.h"
+#include "model/prefetch.h"
+
+/**
+ * @section Private
+ * @{
+ */
+
+// Load one byte per cache line so the lines are resident, not just hinted
+static unsigned prefetch_touch(const void* p, size_t len) {
+    const volatile unsigned char* c = (const volatile unsigned char*) p;
+    unsigned sum = 0;
+    for (size_t i = 0; i < len; i += PREFETCH_LINE) {
+        sum += c[i];
+    }
+    return sum;
+}
+
+static unsigned prefetch_tensor(const Tensor* W) {
+    if (!W->data) {
+        return 0;
+    }
+
+    const size_t rows = tensor_rows(W);
+    const size_t cols = tensor_cols(W);
+    if (W->id != TYPE_Q8) {
+        return prefetch_touch(W->data, rows * cols * type_size(W->id));
+    }
+
+    unsigned sum = 0;
+    for (size_t r = 0; r < rows; r++) {
+        const quant8_t* q = (const quant8_t*) tensor_view_row(W, r);
+        sum += prefetch_touch(q->q, cols);
+        sum += prefetch_touch(q->w, cols / Q8_BLOCK_SIZE);
+    }
+    return sum;
+}
+
+static void prefetch_warm(Prefetcher* p, int layer) {
+    if (layer == p->n_layers) {
+        prefetch_tensor(&p->output);
+        return;
+    }
+
+    // Same order as the forward pass
+    Layer* L = &p->layers[layer];
+    const Tensor* weights[] = {
+        &L->attn.Wq,
+        &L->attn.Wk,
+        &L->attn.Wv,
+        &L->attn.Wo,
+        &L->ffn.W1,
+        &L->ffn.W3,
+        &L->ffn.W2,
+    };
+    for (size_t i = 0; i < sizeof(weights) / sizeof(weights[0]); i++) {
+        prefetch_tensor(weights[i]);
+    }
+}
+
+static void* prefetch_worker(void* arg) {
+    Prefetcher* p = (Prefetcher*) arg;
+
+    pthread_mutex_lock(&p->lock);
+    while (!p->stop) {
+        if (p->pending < 0) {
+            pthread_cond_wait(&p->wake, &p->lock);
+            continue;
+        }
+
+        int layer = p->pending;
+        p->pending = -1;
+        pthread_mutex_unlock(&p->lock);
+
+        prefetch_warm(p, layer);
+        atomic_fetch_add_explicit(&p->warmed, 1, memory_order_relaxed);
+
+        pthread_mutex_lock(&p->lock);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+/** @} */
+
+/**
+ * @section Prefetcher
+ * @{
+ */
+
+Prefetcher* prefetch_new(const Valerie* v) {
+    Prefetcher* p = calloc(1, sizeof(Prefetcher));
+    if (!p) {
+        LOG_ERROR("prefetch_new: allocation failed");
+        return NULL;
+    }
+
+    p->layers = v->layers;
+    p->output = v->embed.token;
+    p->n_layers = v->dim.layers;
+    p->pending = -1;
+    atomic_init(&p->warmed, 0);
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->wake, NULL);
+
+    if (0 != pthread_create(&p->thread, NULL, prefetch_worker, p)) {
+        LOG_ERROR("prefetch_new: failed to start the helper thread");
+        pthread_mutex_destroy(&p->lock);
+        pthread_cond_destroy(&p->wake);
+        free(p);
+        return NULL;
+    }
+
+    return p;
+}
+
+void prefetch_free(Prefetcher* p) {
+    if (p) {
+        pthread_mutex_lock(&p->lock);
+        p->stop = true;
+        pthread_cond_signal(&p->wake);
+        pthread_mutex_unlock(&p->lock);
+
+        pthread_join(p->thread, NULL);
+        pthread_mutex_destroy(&p->lock);
+        pthread_cond_destroy(&p->wake);
+        free(p);
+    }
+}
+
+void prefetch_layer(Prefetcher* p, int layer) {
+    if (p && layer >= 0 && layer <= p->n_layers) {
+        pthread_mutex_lock(&p->lock);
+        p->pending = layer;
+        pthread_cond_signal(&p->wake);
+        pthread_mutex_unlock(&p->lock);
+    }
+}
+
+/** @} */
@@ -0,0 +1,314 @@
+/**
+ * @file session.c
+ * @brief Session snapshots: persist and restore the KV cache and token history.
+ * @copyright Copyright © 2025 Austin Berrio
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "core/logger.h"
+#include "core/path.h"
+#include "linear/q8.h"
+#include "linear/quant.h"
+#include "linear/type.h"
+#include "model/valerie.h"
+#include "model/session.h"
+
+/**
+ * @section Private
+ * @{
+ */
+
+/**
+ * @brief On-disk snapshot header.
+ * All fields are int32 so the struct has no padding.
+ */
+typedef struct SessionHeader {
+    int magic;
+    int version;
+    int dtype;  // TypeId of cached rows
+    int pos;  // number of cached rows (and history length)
+    int d_model;
+    int layers;
+    int kv_dim;
+    int seq_len;
+    int vocab_size;
+} SessionHeader;
+
+// Encoded size of a single cache row in bytes
+static size_t session_row_size(size_t len, TypeId dtype) {
+    if (dtype == TYPE_Q8) {
+        return len * sizeof(int8_t) + q8_block(len) * sizeof(int8_t);  // q | w
+    }
+    return len * type_size(dtype);
+}
+
+// Q8 rows are stored flat as [q[len] | w[len / Q8_BLOCK_SIZE]]
+static void session_row_encode(uint8_t* dst, const float* src, size_t len, TypeId dtype) {
+    switch (dtype) {
+        case TYPE_F32:
+            memcpy(dst, src, len * sizeof(float));
+            break;
+        case TYPE_Q8: {
+            quant8_t q8 = {.q = (int8_t*) dst, .w = (int8_t*) dst + len};
+            q8_vec_encode(&q8, src, len);
+            break;
+        }
+        default:
+            quant_vec(dst, src, len, dtype);
+            break;
+    }
+}
+
+static void session_row_decode(float* dst, const uint8_t* src, size_t len, TypeId dtype) {
+    switch (dtype) {
+        case TYPE_F32:
+            memcpy(dst, src, len * sizeof(float));
+            break;
+        case TYPE_Q8: {
+            // decode only reads through the view
+            quant8_t q8 = {.q = (int8_t*) src, .w = (int8_t*) src + len};
+            q8_vec_decode(dst, &q8, len);
+            break;
+        }
+        default:
+            dequant_vec(dst, src, len, dtype);
+            break;
+    }
+}
+
+static bool session_dtype_is_valid(const Dim* d, TypeId dtype) {
+    if (dtype >= TYPE_COUNT) {
+        return false;
+    }
+    if (dtype == TYPE_Q8 && (d->kv_dim < Q8_BLOCK_SIZE || d->kv_dim % Q8_BLOCK_SIZE != 0)) {
+        return false;
+    }
+    return true;
+}
+
+// Encode rows [0, pos) of a cache tensor and append them to the file
+static bool session_write_rows(FILE* file, uint8_t* buf, Tensor* t, int pos, TypeId dtype) {
+    const size_t cols = tensor_cols(t);
+    const size_t row_size = session_row_size(cols, dtype);
+
+#pragma omp parallel for
+    for (int r = 0; r < pos; r++) {
+        const float* src = tensor_view_row(t, r);
+        session_row_encode(buf + r * row_size, src, cols, dtype);
+    }
+
+    return fwrite(buf, row_size, pos, file) == (size_t) pos;
+}
+
+// Decode rows [0, pos) from a mapped buffer into a cache tensor
+static const uint8_t* session_read_rows(const uint8_t* src, Tensor* t, int pos, TypeId dtype) {
+    const size_t cols = tensor_cols(t);
+    const size_t row_size = session_row_size(cols, dtype);
+
+    if (dtype == TYPE_F32) {
+        memcpy(t->data, src, pos * row_size);  // rows are contiguous
+    } else {
+#pragma omp parallel for
+        for (int r = 0; r < pos; r++) {
+            float* dst = tensor_view_row(t, r);
+            session_row_decode(dst, src + r * row_size, cols, dtype);
+        }
+    }
+
+    return src + pos * row_size;
+}
+
+/** @} */
+
+/**
+ * @section Session life-cycle
+ * @{
+ */
+
+Session v_session_new(const Dim* d) {
+    Session s = {0};
+    s.ids = calloc(d->seq_len, sizeof(int));
+    if (!s.ids) {
+        LOG_ERROR("v_session_new: failed to allocate %d ids", d->seq_len);
+        return s;
+    }
+    s.capacity = d->seq_len;
+    return s;
+}
+
+void v_session_free(Session* s) {
+    if (s) {
+        free(s->ids);
+        s->ids = NULL;
+        s->pos = 0;
+        s->capacity = 0;
+    }
+}
+
+bool v_session_push(Session* s, int id) {
+    if (!s || !s->ids || s->pos >= s->capacity) {
+        return false;
+    }
+    s->ids[s->pos++] = id;
+    return true;
+}
+
+/** @} */
+
+/**
+ * @section Session persistence
+ * @{
+ */
+
+bool v_session_save(Valerie* v, Session* s, TypeId dtype, const char* path) {
+    if (!v || !s || !path) {
+        return false;
+    }
+
+    Dim* d = &v->dim;
+    if (s->pos < 0 || s->pos > d->seq_len) {
+        LOG_ERROR("v_session_save: invalid position %d (seq_len=%d)", s->pos, d->seq_len);
+        return false;
+    }
+
+    if (!session_dtype_is_valid(d, dtype)) {
+        LOG_ERROR("v_session_save: unsupported cache type %s", type_name(dtype));
+        return false;
+    }
+
+    char* dirname = path_dirname(path);
+    path_mkdir(dirname);
+    free(dirname);
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        LOG_ERROR("v_session_save: failed to open %s", path);
+        return false;
+    }
+
+    SessionHeader header = {
+        .magic = SESSION_MAGIC,
+        .version = SESSION_VERSION,
+        .dtype = dtype,
+        .pos = s->pos,
+        .d_model = d->d_model,
+        .layers = d->layers,
+        .kv_dim = d->kv_dim,
+        .seq_len = d->seq_len,
+        .vocab_size = d->vocab_size,
+    };
+
+    bool ok = fwrite(&header, sizeof(SessionHeader), 1, file) == 1;
+    ok = ok && fwrite(s->ids, sizeof(int), s->pos, file) == (size_t) s->pos;
+    ok = ok && fwrite(v->state.x.data, sizeof(float), d->d_model, file) == (size_t) d->d_model;
+
+    if (ok && s->pos > 0) {
+        // scratch buffer for one encoded cache tensor
+        uint8_t* buf = malloc(s->pos * session_row_size(d->kv_dim, dtype));
+        ok = buf != NULL;
+
+        for (int l = 0; ok && l < d->layers; l++) {
+            Cache* c = &v->layers[l].cache;
+            ok = session_write_rows(file, buf, &c->K, s->pos, dtype);
+            ok = ok && session_write_rows(file, buf, &c->V, s->pos, dtype);
+        }
+
+        free(buf);
+    }
+
+    ok = (0 == fclose(file)) && ok;
+    if (!ok) {
+        LOG_ERROR("v_session_save: failed to write %s", path);
+    }
+
+    return ok;
+}
+
+bool v_session_restore(Valerie* v, Session* s, const char* path) {
+    if (!v || !s || !s->ids || !path_is_file(path)) {
+        return false;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (-1 == fd) {
+        LOG_ERROR("v_session_restore: failed to open %s", path);
+        return false;
+    }
+
+    struct stat st;
+    if (-1 == fstat(fd, &st) || (size_t) st.st_size < sizeof(SessionHeader)) {
+        LOG_ERROR("v_session_restore: truncated session file %s", path);
+        close(fd);
+        return false;
+    }
+
+    const size_t size = st.st_size;
+    uint8_t* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // mapping holds its own reference
+    if (MAP_FAILED == map) {
+        LOG_ERROR("v_session_restore: failed to map %s", path);
+        return false;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    bool ok = false;
+    Dim* d = &v->dim;
+    const SessionHeader* h = (const SessionHeader*) map;
+
+    if (h->magic != SESSION_MAGIC || h->version != SESSION_VERSION) {
+        LOG_ERROR("v_session_restore: invalid session file %s", path);
+        goto exit;
+    }
+
+    if (h->d_model != d->d_model || h->layers != d->layers || h->kv_dim != d->kv_dim
+        || h->vocab_size != d->vocab_size || h->pos < 0 || h->pos > d->seq_len
+        || h->pos > s->capacity || !session_dtype_is_valid(d, (TypeId) h->dtype)) {
+        LOG_ERROR("v_session_restore: session does not match model dimensions");
+        goto exit;
+    }
+
+    const TypeId dtype = (TypeId) h->dtype;
+    const size_t row_size = session_row_size(d->kv_dim, dtype);
+    const size_t expected = sizeof(SessionHeader) + h->pos * sizeof(int)
+                            + d->d_model * sizeof(float)
+                            + (size_t) d->layers * 2 * h->pos * row_size;
+    if (size < expected) {
+        LOG_ERROR("v_session_restore: expected %zu bytes, got %zu", expected, size);
+        goto exit;
+    }
+
+    const uint8_t* src = map + sizeof(SessionHeader);
+
+    // token history
+    memcpy(s->ids, src, h->pos * sizeof(int));
+    s->pos = h->pos;
+    src += h->pos * sizeof(int);
+
+    // residual stream
+    memcpy(v->state.x.data, src, d->d_model * sizeof(float));
+    src += d->d_model * sizeof(float);
+
+    // layer caches
+    for (int l = 0; l < d->layers; l++) {
+        Cache* c = &v->layers[l].cache;
+        src = session_read_rows(src, &c->K, h->pos, dtype);
+        src = session_read_rows(src, &c->V, h->pos, dtype);
+    }
+
+    ok = true;
+
+exit:
+    munmap(map, size);
+    return ok;
+}
+
+/** @} */
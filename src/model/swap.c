@@ -0,0 +1,470 @@
+/**
+ * @file swap.c
+ * @brief Swap cold paged sequences out to a memory-mapped file.
+ * @copyright Copyright © 2025 Austin Berrio
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "core/logger.h"
+#include "core/memory.h"
+#include "linear/q8.h"
+#include "model/paged.h"
+#include "model/swap.h"
+
+#define KV_SWAP_RAM_RESERVE ((size_t) 1 << 28)  // 256 MiB
+
+/**
+ * @section Private
+ * @{
+ */
+
+static uint8_t* kv_swap_slot(KVSwap* sw, int slot) {
+    return sw->map + (size_t) slot * sw->slot_bytes;
+}
+
+static void kv_swap_write(KVSwap* sw, int slot, const float* src) {
+    const size_t n = kv_block_floats(sw->pool);
+    uint8_t* dst = kv_swap_slot(sw, slot);
+    if (sw->quantized) {
+        quant8_t q = {.q = (int8_t*) dst, .w = (int8_t*) dst + n};
+        q8_vec_encode(&q, src, n);
+    } else {
+        memcpy(dst, src, n * sizeof(float));
+    }
+    // Drop the pages from our working set; the kernel writes them back lazily
+    madvise(dst, sw->slot_bytes, MADV_DONTNEED);
+}
+
+static void kv_swap_read(KVSwap* sw, int slot, float* dst) {
+    const size_t n = kv_block_floats(sw->pool);
+    uint8_t* src = kv_swap_slot(sw, slot);
+    if (sw->quantized) {
+        quant8_t q = {.q = (int8_t*) src, .w = (int8_t*) src + n};
+        q8_vec_decode(dst, &q, n);
+    } else {
+        memcpy(dst, src, n * sizeof(float));
+    }
+}
+
+static KVSwapState kv_swap_state(KVSwap* sw, int entry) {
+    pthread_mutex_lock(&sw->lock);
+    KVSwapState state = sw->entries[entry].state;
+    pthread_mutex_unlock(&sw->lock);
+    return state;
+}
+
+// Background page-in: copy queued slots into their mapped blocks
+static void* kv_swap_worker(void* arg) {
+    KVSwap* sw = arg;
+
+    pthread_mutex_lock(&sw->lock);
+    while (true) {
+        while (0 == sw->n_queued && !sw->stop) {
+            pthread_cond_wait(&sw->work, &sw->lock);
+        }
+        if (0 == sw->n_queued) {
+            break;  // stopped and drained
+        }
+
+        KVSwapCopy c = sw->queue[sw->head];
+        sw->head = (sw->head + 1) % sw->n_slots;
+        sw->n_queued--;
+        float* dst = sw->pool->data[c.block];
+        pthread_mutex_unlock(&sw->lock);
+
+        kv_swap_read(sw, c.slot, dst);
+
+        pthread_mutex_lock(&sw->lock);
+        sw->free_slots[sw->n_free_slots++] = c.slot;
+        sw->swapped_in++;
+        KVSwapEntry* e = &sw->entries[c.entry];
+        if (0 == --e->pending) {
+            // A prefetch that ran out of blocks leaves the rest swapped out
+            bool out = false;
+            for (int b = 0; b < e->seq->n_blocks; b++) {
+                out = out || e->slots[b] >= 0;
+            }
+            e->state = out ? KV_SWAP_OUT : KV_SWAP_RESIDENT;
+            pthread_cond_broadcast(&sw->done);
+        }
+    }
+    pthread_mutex_unlock(&sw->lock);
+    return NULL;
+}
+
+// Blocks the pool can hand out without exceeding max_blocks or free RAM
+static int kv_swap_available(KVSwap* sw) {
+    const KVPool* pool = sw->pool;
+    const size_t block_bytes = kv_block_floats(pool) * sizeof(float);
+    const size_t ram = memory_ram_free();
+
+    size_t spare = ram > sw->ram_reserve ? (ram - sw->ram_reserve) / block_bytes : 0;
+    size_t grow = (size_t) (pool->max_blocks - pool->n_alloc);
+    grow = grow < spare ? grow : spare;
+    return pool->n_free + (int) grow;
+}
+
+// Coldest evictable entry other than keep: lowest priority, then least recently used
+static int kv_swap_victim(KVSwap* sw, int keep) {
+    const KVPool* pool = sw->pool;
+    int best = -1;
+
+    pthread_mutex_lock(&sw->lock);
+    for (int i = 0; i < sw->max_entries; i++) {
+        KVSwapEntry* e = &sw->entries[i];
+        if (i == keep || !e->seq || e->pins > 0 || e->state != KV_SWAP_RESIDENT) {
+            continue;
+        }
+
+        bool owns = false;
+        for (int b = 0; b < e->seq->n_blocks && !owns; b++) {
+            owns = pool->refs[e->seq->blocks[b]] == 1;
+        }
+        if (!owns) {
+            continue;  // nothing to gain
+        }
+
+        KVSwapEntry* v = best >= 0 ? &sw->entries[best] : NULL;
+        if (!v || e->priority < v->priority
+            || (e->priority == v->priority && e->last_used < v->last_used)) {
+            best = i;
+        }
+    }
+    pthread_mutex_unlock(&sw->lock);
+
+    return best;
+}
+
+static bool kv_swap_make_room(KVSwap* sw, int n_blocks, int keep) {
+    while (kv_swap_available(sw) < n_blocks) {
+        int victim = kv_swap_victim(sw, keep);
+        if (victim < 0 || 0 == kv_swap_out(sw, victim)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** @} */
+
+/**
+ * @section Swap life-cycle
+ * @{
+ */
+
+KVSwap* kv_swap_new(KVPool* pool, const char* path, int n_slots, int max_entries, bool quantized) {
+    if (!pool || !path || n_slots < 1 || max_entries < 1) {
+        return NULL;
+    }
+
+    const size_t n = kv_block_floats(pool);
+    if (quantized && n % Q8_BLOCK_SIZE != 0) {
+        LOG_ERROR("kv_swap_new: block of %zu floats cannot be stored as Q8", n);
+        return NULL;
+    }
+
+    KVSwap* sw = calloc(1, sizeof(KVSwap));
+    if (!sw) {
+        return NULL;
+    }
+
+    const size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    const size_t raw = quantized ? n + n / Q8_BLOCK_SIZE : n * sizeof(float);
+
+    sw->pool = pool;
+    sw->quantized = quantized;
+    sw->n_slots = n_slots;
+    sw->max_entries = max_entries;
+    sw->slot_bytes = (raw + page - 1) / page * page;
+    sw->map_size = sw->slot_bytes * n_slots;
+    sw->ram_reserve = KV_SWAP_RAM_RESERVE;
+
+    sw->free_slots = calloc(n_slots, sizeof(int));
+    sw->queue = calloc(n_slots, sizeof(KVSwapCopy));
+    sw->entries = calloc(max_entries, sizeof(KVSwapEntry));
+    if (!sw->free_slots || !sw->queue || !sw->entries) {
+        LOG_ERROR("kv_swap_new: failed to allocate %d slots", n_slots);
+        goto fail;
+    }
+    for (int i = 0; i < n_slots; i++) {
+        sw->free_slots[i] = n_slots - 1 - i;  // pop slot 0 first
+    }
+    sw->n_free_slots = n_slots;
+
+    // The mapping outlives the descriptor and the name
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (-1 == fd) {
+        LOG_ERROR("kv_swap_new: failed to create '%s'", path);
+        goto fail;
+    }
+    unlink(path);
+    if (-1 == ftruncate(fd, (off_t) sw->map_size)) {
+        LOG_ERROR("kv_swap_new: failed to size '%s' to %zu bytes", path, sw->map_size);
+        close(fd);
+        goto fail;
+    }
+    sw->map = mmap(NULL, sw->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == sw->map) {
+        LOG_ERROR("kv_swap_new: failed to map '%s'", path);
+        sw->map = NULL;
+        goto fail;
+    }
+
+    pthread_mutex_init(&sw->lock, NULL);
+    pthread_cond_init(&sw->work, NULL);
+    pthread_cond_init(&sw->done, NULL);
+    if (0 != pthread_create(&sw->thread, NULL, kv_swap_worker, sw)) {
+        LOG_ERROR("kv_swap_new: failed to start the page-in thread");
+        pthread_cond_destroy(&sw->done);
+        pthread_cond_destroy(&sw->work);
+        pthread_mutex_destroy(&sw->lock);
+        goto fail;
+    }
+
+    return sw;
+
+fail:
+    if (sw->map) {
+        munmap(sw->map, sw->map_size);
+    }
+    free(sw->free_slots);
+    free(sw->queue);
+    free(sw->entries);
+    free(sw);
+    return NULL;
+}
+
+void kv_swap_free(KVSwap* sw) {
+    if (!sw) {
+        return;
+    }
+
+    for (int i = 0; i < sw->max_entries; i++) {
+        kv_swap_unregister(sw, i);
+    }
+
+    pthread_mutex_lock(&sw->lock);
+    sw->stop = true;
+    pthread_cond_signal(&sw->work);
+    pthread_mutex_unlock(&sw->lock);
+    pthread_join(sw->thread, NULL);
+
+    pthread_cond_destroy(&sw->done);
+    pthread_cond_destroy(&sw->work);
+    pthread_mutex_destroy(&sw->lock);
+    munmap(sw->map, sw->map_size);
+    free(sw->free_slots);
+    free(sw->queue);
+    free(sw->entries);
+    free(sw);
+}
+
+/** @} */
+
+/**
+ * @section Registration
+ * @{
+ */
+
+int kv_swap_register(KVSwap* sw, KVSeq* seq, int priority) {
+    if (!sw || !seq) {
+        return -1;
+    }
+
+    for (int i = 0; i < sw->max_entries; i++) {
+        KVSwapEntry* e = &sw->entries[i];
+        if (e->seq) {
+            continue;
+        }
+
+        e->slots = malloc(seq->capacity * sizeof(int));
+        if (!e->slots) {
+            return -1;
+        }
+        for (int b = 0; b < seq->capacity; b++) {
+            e->slots[b] = -1;
+        }
+        e->seq = seq;
+        e->priority = priority;
+        e->pins = 0;
+        e->pending = 0;
+        e->last_used = ++sw->clock;
+        e->state = KV_SWAP_RESIDENT;
+        return i;
+    }
+
+    LOG_ERROR("kv_swap_register: table is full (%d entries)", sw->max_entries);
+    return -1;
+}
+
+void kv_swap_unregister(KVSwap* sw, int entry) {
+    if (!sw || entry < 0 || entry >= sw->max_entries || !sw->entries[entry].seq) {
+        return;
+    }
+
+    KVSwapEntry* e = &sw->entries[entry];
+    pthread_mutex_lock(&sw->lock);
+    while (e->state == KV_SWAP_PAGING_IN) {
+        pthread_cond_wait(&sw->done, &sw->lock);
+    }
+
+    // Swapped blocks are dropped along with the rest of the sequence
+    if (e->state == KV_SWAP_OUT) {
+        for (int b = 0; b < e->seq->n_blocks; b++) {
+            if (e->slots[b] >= 0) {
+                sw->free_slots[sw->n_free_slots++] = e->slots[b];
+            } else {
+                kv_pool_release(sw->pool, e->seq->blocks[b]);
+            }
+        }
+        e->seq->n_blocks = 0;
+    }
+    pthread_mutex_unlock(&sw->lock);
+
+    free(e->slots);
+    *e = (KVSwapEntry) {0};
+}
+
+/** @} */
+
+/**
+ * @section Eviction and page-in
+ * @{
+ */
+
+int kv_swap_out(KVSwap* sw, int entry) {
+    if (!sw || entry < 0 || entry >= sw->max_entries) {
+        return 0;
+    }
+
+    KVSwapEntry* e = &sw->entries[entry];
+    if (!e->seq || e->pins > 0 || kv_swap_state(sw, entry) != KV_SWAP_RESIDENT) {
+        return 0;
+    }
+
+    KVPool* pool = sw->pool;
+    KVSeq* seq = e->seq;
+    int n = 0;
+    for (int b = 0; b < seq->n_blocks; b++) {
+        const int id = seq->blocks[b];
+        if (pool->refs[id] != 1) {
+            continue;  // shared blocks stay resident
+        }
+
+        pthread_mutex_lock(&sw->lock);
+        int slot = sw->n_free_slots > 0 ? sw->free_slots[--sw->n_free_slots] : -1;
+        pthread_mutex_unlock(&sw->lock);
+        if (slot < 0) {
+            LOG_ERROR("kv_swap_out: swap file is full (%d slots)", sw->n_slots);
+            break;
+        }
+
+        kv_swap_write(sw, slot, pool->data[id]);
+        kv_pool_release(pool, id);
+        seq->blocks[b] = -1;
+        e->slots[b] = slot;
+        n++;
+    }
+
+    if (n > 0) {
+        pthread_mutex_lock(&sw->lock);
+        e->state = KV_SWAP_OUT;
+        sw->swapped_out += n;
+        pthread_mutex_unlock(&sw->lock);
+    }
+    return n;
+}
+
+bool kv_swap_reserve(KVSwap* sw, int n_blocks) {
+    return sw && kv_swap_make_room(sw, n_blocks, -1);
+}
+
+bool kv_swap_prefetch(KVSwap* sw, int entry) {
+    if (!sw || entry < 0 || entry >= sw->max_entries || !sw->entries[entry].seq) {
+        return false;
+    }
+
+    KVSwapEntry* e = &sw->entries[entry];
+    if (kv_swap_state(sw, entry) != KV_SWAP_OUT) {
+        return true;  // resident or already on its way
+    }
+
+    int n = 0;
+    for (int b = 0; b < e->seq->n_blocks; b++) {
+        n += e->slots[b] >= 0;
+    }
+    if (!kv_swap_make_room(sw, n, entry)) {
+        return false;
+    }
+
+    // Map blocks here; the worker only copies
+    pthread_mutex_lock(&sw->lock);
+    for (int b = 0; b < e->seq->n_blocks; b++) {
+        const int slot = e->slots[b];
+        if (slot < 0) {
+            continue;
+        }
+
+        const int id = kv_pool_alloc(sw->pool);
+        if (id < 0) {
+            break;  // the remaining blocks stay swapped out
+        }
+        madvise(kv_swap_slot(sw, slot), sw->slot_bytes, MADV_WILLNEED);
+
+        const int tail = (sw->head + sw->n_queued) % sw->n_slots;
+        sw->queue[tail] = (KVSwapCopy) {.entry = entry, .slot = slot, .block = id};
+        sw->n_queued++;
+        e->seq->blocks[b] = id;
+        e->slots[b] = -1;
+        e->pending++;
+    }
+
+    bool ok = true;
+    for (int b = 0; b < e->seq->n_blocks; b++) {
+        ok = ok && e->slots[b] < 0;
+    }
+    if (e->pending > 0) {
+        e->state = KV_SWAP_PAGING_IN;
+        pthread_cond_signal(&sw->work);
+    }
+    pthread_mutex_unlock(&sw->lock);
+
+    return ok;
+}
+
+bool kv_swap_acquire(KVSwap* sw, int entry) {
+    if (!kv_swap_prefetch(sw, entry)) {
+        return false;
+    }
+
+    KVSwapEntry* e = &sw->entries[entry];
+    pthread_mutex_lock(&sw->lock);
+    while (e->state == KV_SWAP_PAGING_IN) {
+        pthread_cond_wait(&sw->done, &sw->lock);
+    }
+    bool resident = e->state == KV_SWAP_RESIDENT;
+    pthread_mutex_unlock(&sw->lock);
+
+    if (resident) {
+        e->pins++;
+        e->last_used = ++sw->clock;
+    }
+    return resident;
+}
+
+void kv_swap_release(KVSwap* sw, int entry) {
+    if (sw && entry >= 0 && entry < sw->max_entries && sw->entries[entry].pins > 0) {
+        KVSwapEntry* e = &sw->entries[entry];
+        e->pins--;
+        e->last_used = ++sw->clock;
+    }
+}
+
+/** @} */
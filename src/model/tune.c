@@ -0,0 +1,506 @@
+/**
+ * @file tune.c
+ * @brief Kernel autotuner with a per-machine tuning cache.
+ * @copyright Copyright © 2025 Austin Berrio
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <omp.h>
+
+#include <unistd.h>
+
+#include "core/logger.h"
+#include "core/metrics.h"
+#include "core/path.h"
+#include "linear/lehmer.h"
+#include "linear/q8.h"
+#include "linear/tensor.h"
+#include "linear/type.h"
+#include "model/valerie.h"
+#include "model/blocks.h"
+#include "model/tune.h"
+
+#define TUNE_REPS 5  // timed runs per candidate (best is kept)
+#define TUNE_CPU_MAX 128
+
+static TuneEntry tune_table[TUNE_MAX_ENTRIES];
+static int tune_count = 0;
+
+static const char* TUNE_OP_NAME[TUNE_OP_COUNT] = {"matmul", "matmul_batch", "ffn", "ffn_batch"};
+
+/**
+ * @section Private
+ * @{
+ */
+
+/**
+ * @brief Benchmark inputs of one kernel shape.
+ */
+typedef struct TuneBench {
+    TuneOp op;
+    Tensor* W;  // matmul weights
+    FeedForward* ffn;  // feed-forward weights
+    Tensor x;  // activations
+    Tensor y;  // outputs
+    size_t n;  // activation rows
+} TuneBench;
+
+static int tune_find(TuneOp op, TypeId dtype, size_t rows, size_t cols) {
+    for (int i = 0; i < tune_count; i++) {
+        const TuneEntry* e = &tune_table[i];
+        if (e->op == op && e->dtype == dtype && (size_t) e->rows == rows && (size_t) e->cols == cols) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// CPU model name from /proc/cpuinfo, or "unknown"
+static void tune_cpu_model(char* out, size_t size) {
+    snprintf(out, size, "unknown");
+
+    FILE* file = fopen("/proc/cpuinfo", "r");
+    if (!file) {
+        return;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        if (0 == strncmp(line, "model name", 10)) {
+            const char* value = strchr(line, ':');
+            if (value) {
+                value++;
+                while (*value == ' ' || *value == '\t') {
+                    value++;
+                }
+                snprintf(out, size, "%s", value);
+                out[strcspn(out, "\n")] = '\0';
+            }
+            break;
+        }
+    }
+    fclose(file);
+}
+
+static int tune_cores(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int) n : 1;
+}
+
+static TuneOp tune_op_id(const char* name) {
+    for (int op = 0; op < TUNE_OP_COUNT; op++) {
+        if (0 == strcmp(TUNE_OP_NAME[op], name)) {
+            return (TuneOp) op;
+        }
+    }
+    return TUNE_OP_COUNT;
+}
+
+// Best wall time of a kernel call under the current table (INFINITY if it fails)
+static double tune_time(TuneBench* b) {
+    double best = 0.0;
+    for (int rep = 0; rep <= TUNE_REPS; rep++) {
+        bool ok = true;
+        uint64_t start = metrics_now_ns();
+        switch (b->op) {
+            case TUNE_OP_MATMUL:
+                matmul(&b->y, b->W, &b->x);
+                break;
+            case TUNE_OP_MATMUL_BATCH:
+                matmul_batch(&b->y, b->W, &b->x, b->n);
+                break;
+            default:  // accumulates into y, which is only a sink here
+                ok = ffn_chunked((float*) b->y.data, b->ffn, (const float*) b->x.data, b->n);
+                break;
+        }
+        if (!ok) {
+            return INFINITY;  // a failed run must not look fast
+        }
+        double ns = (double) (metrics_now_ns() - start);
+        if (rep > 0 && (rep == 1 || ns < best)) {
+            best = ns;  // rep 0 warms up
+        }
+    }
+    return best;
+}
+
+// Keep the faster of the current best and a candidate; skip a candidate that failed
+static void tune_try(TuneEntry* best, TuneConfig candidate, TuneBench* b) {
+    TuneEntry trial = *best;
+    trial.config = candidate;
+    tune_set(&trial);
+
+    double ns = tune_time(b);
+    if (isfinite(ns) && ns < best->ns) {
+        best->config = candidate;
+        best->ns = ns;
+    }
+    tune_set(best);
+}
+
+// Coordinate descent over threads, tile, prefetch distance, then chunk
+static TuneEntry tune_shape(TuneOp op, Tensor* W, FeedForward* ffn) {
+    const bool is_ffn = op == TUNE_OP_FFN || op == TUNE_OP_FFN_BATCH;
+    Tensor* key = is_ffn ? &ffn->W1 : W;  // FFN entries are keyed by W1 (hidden, d_model)
+    const size_t rows = tensor_rows(key);
+    const size_t cols = tensor_cols(key);
+    const size_t n = op == TUNE_OP_MATMUL || op == TUNE_OP_FFN ? 1 : TUNE_BATCH_ROWS;
+    const size_t out = is_ffn ? cols : rows;  // FFN output rows are d_model wide
+    const int max_threads = omp_get_max_threads();
+
+    TuneBench b = {.op = op, .W = W, .ffn = ffn, .n = n};
+    if (op == TUNE_OP_MATMUL) {
+        b.x = tensor_new(shape_vec(cols), TYPE_F32);
+        b.y = tensor_new(shape_vec(out), TYPE_F32);
+    } else {
+        b.x = tensor_new(shape_mat(n, cols), TYPE_F32);
+        b.y = tensor_new(shape_mat(n, out), TYPE_F32);
+    }
+    float* xf = (float*) b.x.data;
+    for (size_t i = 0; i < n * cols; i++) {
+        xf[i] = lehmer_float() * 2.0f - 1.0f;
+    }
+
+    TuneEntry best = {.op = op, .dtype = key->id, .rows = (int) rows, .cols = (int) cols};
+    tune_set(&best);
+    best.ns = tune_time(&b);  // defaults
+
+    // Powers of two, then the maximum itself
+    for (int t = 1;; t *= 2) {
+        t = t > max_threads ? max_threads : t;
+        TuneConfig c = best.config;
+        c.threads = t;
+        tune_try(&best, c, &b);
+        if (t == max_threads) {
+            break;
+        }
+    }
+
+    // Tiles only pay off when several activation rows share them
+    if (op == TUNE_OP_MATMUL_BATCH) {
+        for (int tile = 2; tile <= 16; tile *= 2) {
+            TuneConfig c = best.config;
+            c.tile = tile;
+            tune_try(&best, c, &b);
+        }
+    }
+
+    // FFN tiles trade cache residency for fewer partial sums (Q8 block multiples)
+    if (is_ffn) {
+        for (int tile = 16; tile <= 256 && (size_t) tile <= rows; tile *= 2) {
+            if (tile % Q8_BLOCK_SIZE == 0) {
+                TuneConfig c = best.config;
+                c.tile = tile;
+                tune_try(&best, c, &b);
+            }
+        }
+    }
+
+    // Prefetch distance: off, then powers of two
+    for (int ahead = -1; ahead <= 32; ahead = ahead < 0 ? 1 : ahead * 2) {
+        TuneConfig c = best.config;
+        c.prefetch = ahead;
+        tune_try(&best, c, &b);
+    }
+
+    const int tile = best.config.tile > 0 ? best.config.tile : (is_ffn ? FFN_TILE : 1);
+    const int n_tiles = (int) ((rows + tile - 1) / tile);
+    for (int chunk = 1; chunk <= 64 && chunk <= n_tiles; chunk *= 2) {
+        TuneConfig c = best.config;
+        c.chunk = chunk;
+        tune_try(&best, c, &b);
+    }
+
+    tensor_free(&b.x);
+    tensor_free(&b.y);
+    return best;
+}
+
+/** @} */
+
+/**
+ * @section Table
+ * @{
+ */
+
+const char* tune_op_name(TuneOp op) {
+    return op >= 0 && op < TUNE_OP_COUNT ? TUNE_OP_NAME[op] : "unknown";
+}
+
+TuneConfig tune_config(TuneOp op, TypeId dtype, size_t rows, size_t cols) {
+    int i = tune_find(op, dtype, rows, cols);
+    return i < 0 ? (TuneConfig) {0} : tune_table[i].config;
+}
+
+bool tune_set(const TuneEntry* entry) {
+    int i = tune_find(entry->op, entry->dtype, entry->rows, entry->cols);
+    if (i < 0) {
+        if (tune_count >= TUNE_MAX_ENTRIES) {
+            LOG_ERROR("tune_set: table is full (%d entries)", TUNE_MAX_ENTRIES);
+            return false;
+        }
+        i = tune_count++;
+    }
+    tune_table[i] = *entry;
+    return true;
+}
+
+const TuneEntry* tune_entries(int* count) {
+    *count = tune_count;
+    return tune_table;
+}
+
+void tune_clear(void) {
+    tune_count = 0;
+}
+
+/** @} */
+
+/**
+ * @section Cache file
+ * @{
+ */
+
+char* tune_cache_path(void) {
+    char cpu[TUNE_CPU_MAX];
+    tune_cpu_model(cpu, sizeof(cpu));
+
+    // File-name safe key: alphanumerics, everything else collapsed to '-'
+    char key[TUNE_CPU_MAX + 16];
+    size_t n = 0;
+    for (const char* c = cpu; *c && n < TUNE_CPU_MAX - 1; c++) {
+        if (isalnum((unsigned char) *c)) {
+            key[n++] = (char) tolower((unsigned char) *c);
+        } else if (n > 0 && key[n - 1] != '-') {
+            key[n++] = '-';
+        }
+    }
+    while (n > 0 && key[n - 1] == '-') {
+        n--;
+    }
+    snprintf(key + n, sizeof(key) - n, "-%d", tune_cores());
+
+    char name[TUNE_CPU_MAX + 32];
+    snprintf(name, sizeof(name), "tune-%s.txt", key);
+
+    const char* xdg = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+    char* root = NULL;
+    if (xdg && *xdg) {
+        root = strdup(xdg);
+    } else if (home && *home) {
+        root = path_join(home, ".cache");
+    } else {
+        root = strdup(".");
+    }
+    if (!root) {
+        return NULL;
+    }
+
+    char* dir = path_join(root, "valerie");
+    char* path = dir ? path_join(dir, name) : NULL;
+    path_free(root);
+    path_free(dir);
+    return path;
+}
+
+bool tune_load(const char* path) {
+    FILE* file = path ? fopen(path, "r") : NULL;
+    if (!file) {
+        return false;
+    }
+
+    char cpu[TUNE_CPU_MAX];
+    tune_cpu_model(cpu, sizeof(cpu));
+
+    // Header: the machine the entries were measured on
+    char line[256];
+    char saved_cpu[TUNE_CPU_MAX] = {0};
+    int saved_cores = 0;
+    bool ok = fgets(line, sizeof(line), file) && 0 == strncmp(line, "# valerie tune", 14);
+    if (ok && fgets(line, sizeof(line), file) && 0 == strncmp(line, "cpu ", 4)) {
+        snprintf(saved_cpu, sizeof(saved_cpu), "%.*s", TUNE_CPU_MAX - 1, line + 4);
+        saved_cpu[strcspn(saved_cpu, "\n")] = '\0';
+    }
+    ok = ok && fgets(line, sizeof(line), file) && 1 == sscanf(line, "cores %d", &saved_cores);
+    if (!ok || 0 != strcmp(saved_cpu, cpu) || saved_cores != tune_cores()) {
+        LOG_WARN("tune_load: '%s' was measured on another machine", path);
+        fclose(file);
+        return false;
+    }
+
+    int loaded = 0;
+    while (fgets(line, sizeof(line), file)) {
+        char op[32], dtype[32];
+        TuneEntry e = {0};
+        if (9
+            != sscanf(
+                line,
+                "%31s %31s %d %d %d %d %d %d %lf",
+                op,
+                dtype,
+                &e.rows,
+                &e.cols,
+                &e.config.threads,
+                &e.config.chunk,
+                &e.config.tile,
+                &e.config.prefetch,
+                &e.ns
+            )) {
+            continue;
+        }
+        e.op = tune_op_id(op);
+        e.dtype = type_id(dtype);
+        if (e.op == TUNE_OP_COUNT || e.dtype == TYPE_COUNT) {
+            continue;
+        }
+        loaded += tune_set(&e);
+    }
+
+    fclose(file);
+    return loaded > 0;
+}
+
+bool tune_save(const char* path) {
+    if (!path) {
+        return false;
+    }
+
+    // Create the cache directory (and its parent) if needed
+    char* dir = path_dirname(path);
+    char* parent = dir ? path_dirname(dir) : NULL;
+    if (parent) {
+        path_mkdir(parent);
+    }
+    if (dir) {
+        path_mkdir(dir);
+    }
+    path_free(parent);
+    path_free(dir);
+
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        LOG_ERROR("tune_save: failed to open '%s'", path);
+        return false;
+    }
+
+    char cpu[TUNE_CPU_MAX];
+    tune_cpu_model(cpu, sizeof(cpu));
+    fprintf(file, "# valerie tune: op dtype rows cols threads chunk tile prefetch ns\n");
+    fprintf(file, "cpu %s\n", cpu);
+    fprintf(file, "cores %d\n", tune_cores());
+    for (int i = 0; i < tune_count; i++) {
+        const TuneEntry* e = &tune_table[i];
+        fprintf(
+            file,
+            "%s %s %d %d %d %d %d %d %.0f\n",
+            TUNE_OP_NAME[e->op],
+            type_name(e->dtype),
+            e->rows,
+            e->cols,
+            e->config.threads,
+            e->config.chunk,
+            e->config.tile,
+            e->config.prefetch,
+            e->ns
+        );
+    }
+
+    bool ok = 0 == ferror(file);
+    fclose(file);
+    return ok;
+}
+
+/** @} */
+
+/**
+ * @section Tuning
+ * @{
+ */
+
+int tune_model(Valerie* v) {
+    if (!v || !v->layers) {
+        return 0;
+    }
+
+    // Every weight shape of a layer is shared by all layers; W1, W2 and W3
+    // only run inside the fused feed-forward kernel
+    Layer* L = &v->layers[0];
+    Tensor* weights[] = {
+        &L->attn.Wq,
+        &L->attn.Wk,
+        &L->attn.Wo,
+        &v->embed.token,  // output projection
+    };
+    const int n_weights = (int) (sizeof(weights) / sizeof(weights[0]));
+
+    int tuned = 0;
+    for (int op = 0; op < TUNE_OP_COUNT; op++) {
+        const bool is_ffn = op == TUNE_OP_FFN || op == TUNE_OP_FFN_BATCH;
+        for (int i = 0; i < (is_ffn ? 1 : n_weights); i++) {
+            Tensor* W = is_ffn ? &L->ffn.W1 : weights[i];
+            const size_t rows = tensor_rows(W);
+            const size_t cols = tensor_cols(W);
+            if (tune_find((TuneOp) op, W->id, rows, cols) >= 0) {
+                continue;  // already tuned (or shares a shape)
+            }
+
+            TuneEntry e = tune_shape((TuneOp) op, is_ffn ? NULL : W, is_ffn ? &L->ffn : NULL);
+            if (!isfinite(e.ns)) {
+                LOG_WARN(
+                    "tune: %s %s (%zu, %zu) failed; using defaults",
+                    TUNE_OP_NAME[op],
+                    type_name(W->id),
+                    rows,
+                    cols
+                );
+                continue;
+            }
+            LOG_INFO(
+                "tune: %s %s (%zu, %zu): threads=%d chunk=%d tile=%d prefetch=%d, %.1f us",
+                TUNE_OP_NAME[op],
+                type_name(W->id),
+                rows,
+                cols,
+                e.config.threads,
+                e.config.chunk,
+                e.config.tile,
+                e.config.prefetch,
+                e.ns / 1e3
+            );
+            tuned++;
+        }
+    }
+
+    return tuned;
+}
+
+bool tune_init(Valerie* v, bool retune) {
+    char* path = tune_cache_path();
+    if (!path) {
+        return false;
+    }
+
+    if (retune) {
+        tune_clear();
+    } else if (tune_load(path)) {
+        LOG_INFO("tune: loaded %s", path);
+    }
+
+    bool ok = true;
+    if (tune_model(v) > 0) {
+        ok = tune_save(path);
+        if (ok) {
+            LOG_INFO("tune: saved %s", path);
+        }
+    }
+
+    path_free(path);
+    return ok;
+}
+
+/** @} */
@@ -8,6 +8,7 @@
 #include <math.h>
 #include "core/logger.h"
 #include "model/valerie.h"
+#include "model/prefetch.h"
 
 Params v_params_new(int vocab_size) {
     Params params = {0};
@@ -131,6 +132,31 @@ void v_cache_free(Cache* cache) {
     }
 }
 
+Cache* v_caches_new(const Dim* d) {
+    assert(d && d->layers > 0);
+
+    Cache* caches = calloc(d->layers, sizeof(Cache));
+    if (!caches) {
+        LOG_ERROR("v_caches_new: failed to allocate %d caches", d->layers);
+        return NULL;
+    }
+
+    for (int i = 0; i < d->layers; i++) {
+        caches[i] = v_cache_new(d);
+    }
+
+    return caches;
+}
+
+void v_caches_free(Cache* caches, size_t n) {
+    if (caches) {
+        for (size_t i = 0; i < n; i++) {
+            v_cache_free(&caches[i]);
+        }
+        free(caches);
+    }
+}
+
 Layer* v_layers_new(const Dim* d, TypeId dtype) {
     assert(d && d->layers > 0 && dtype < TYPE_COUNT);
 
@@ -233,9 +259,7 @@ State v_state_new(const Dim* d) {
     s.v = tensor_empty(shape_vec(d->kv_dim), TYPE_F32);  // Alias for value cache
     s.attn_scores = tensor_new(shape_mat(d->heads, d->seq_len), TYPE_F32);
     s.attn_out = tensor_new(shape_vec(d->d_model), TYPE_F32);
-    s.mlp_in = tensor_new(shape_vec(d->hidden), TYPE_F32);
-    s.mlp_gate = tensor_new(shape_vec(d->hidden), TYPE_F32);
-    s.logits = tensor_new(shape_vec(d->vocab_size), TYPE_F32);
+    s.logits = tensor_empty(shape_vec(d->vocab_size), TYPE_F32);  // allocated by the first forward()
     return s;
 }
 
@@ -248,8 +272,6 @@ void v_state_free(State* s) {
         // Do not free value alias
         tensor_free(&s->attn_scores);
         tensor_free(&s->attn_out);
-        tensor_free(&s->mlp_in);
-        tensor_free(&s->mlp_gate);
         tensor_free(&s->logits);
     }
 }
@@ -271,6 +293,9 @@ Valerie v_model_new(Tokenizer t, Params p, TypeId dtype) {
 
 void v_model_free(Valerie* v) {
     if (v) {
+        // Stop the helper first; a pending warm-up still reads the weights
+        prefetch_free(v->prefetch);
+        v->prefetch = NULL;
         tokenizer_free(&v->t);
         v_rotary_free(&v->rope);
         v_embed_free(&v->embed);
@@ -10,8 +10,12 @@
  *       (e.g., "l o o k e d"). Ownership of returned pointers is specified.
  */
 
+#include <stdint.h>
 #include <stdio.h>
 
+#include <omp.h>
+
+#include "core/logger.h"
 #include "core/path.h"
 #include "core/strext.h"
 #include "core/map.h"
@@ -233,87 +237,1062 @@ HashMap* bpe_merges(HashMap* vocab, const char* best_pair) {
     return new_vocab;
 }
 
-BPEModel* bpe_train(HashMap* vocab, size_t n_merges, bool verbose) {
-    // Create a shallow copy of the input vocab
-    HashMap* internal_vocab = vocab_map_copy(vocab);  // always copy!
-    if (!internal_vocab) {
+/**
+ * @section Incremental trainer
+ *
+ * Words are arrays of interned symbol ids. Pair counts are kept up to date as
+ * merges are applied: each pair lists the words it occurs in, so a merge only
+ * revisits those words and adjusts the counts of the pairs that changed in
+ * them. The best pair comes off a lazy max-heap ordered like bpe_best(): by
+ * frequency, then by the "A B" string. Counts only grow through new heap
+ * entries, so a popped entry whose count is out of date is re-queued with the
+ * current count.
+ *
+ * Word updates run in parallel: the words of a merge (and of the initial
+ * count) are shared out to the OpenMP threads, each of which collects its
+ * pair-count changes in a thread-local delta map. The maps are then applied
+ * in thread order. Counts are sums and the heap order is total, so the merges
+ * do not depend on the number of threads.
+ * @{
+ */
+
+#define BPE_PAIR_EMPTY UINT64_MAX  // symbol ids are non-negative
+#define BPE_PARALLEL_WORDS 256  // fewer words than this are updated serially
+
+/**
+ * @brief Vocabulary word as symbol ids.
+ */
+typedef struct BPEWord {
+    int* syms;  // symbol ids
+    int len;  // number of symbols
+    int freq;  // word frequency
+    size_t stamp;  // last merge step that visited the word
+} BPEWord;
+
+/**
+ * @brief Adjacent symbol pair with its count and the words it occurs in.
+ */
+typedef struct BPEPair {
+    int a;
+    int b;
+    int64_t count;  // sum of word frequencies over occurrences
+    size_t* words;  // words that contain (or once contained) the pair
+    size_t n_words;
+    size_t cap_words;
+} BPEPair;
+
+/**
+ * @brief Heap entry: a pair and its count when queued.
+ */
+typedef struct BPEHeapEntry {
+    int64_t count;
+    int pair;
+} BPEHeapEntry;
+
+/**
+ * @brief Net count change of one pair.
+ */
+typedef struct BPEChange {
+    uint64_t key;  // packed pair
+    int64_t delta;  // change in count
+} BPEChange;
+
+/**
+ * @brief Word that gained a pair it did not contain before.
+ */
+typedef struct BPEListing {
+    uint64_t key;  // packed pair
+    size_t word;
+} BPEListing;
+
+/**
+ * @brief Pair-count changes collected by one thread.
+ */
+typedef struct BPEDelta {
+    uint64_t* keys;  // open-addressed: packed pair -> changes[slots[i]]
+    int* slots;
+    size_t capacity;  // power of two
+
+    BPEChange* changes;
+    size_t n_changes;
+    size_t cap_changes;
+
+    BPEListing* listings;
+    size_t n_listings;
+    size_t cap_listings;
+
+    uint64_t* scratch;  // pair keys of one word, before and after a merge
+    size_t scratch_cap;
+} BPEDelta;
+
+/**
+ * @brief Trainer state.
+ */
+struct BPETrainer {
+    BPEModel* model;  // merges so far
+
+    HashMap* symbol_ids;  // symbol string -> int* id
+    char** symbols;  // id -> symbol string (owned by symbol_ids)
+    size_t n_symbols;
+    size_t cap_symbols;
+
+    BPEWord* words;
+    size_t n_words;
+
+    BPEPair* pairs;
+    size_t n_pairs;
+    size_t cap_pairs;
+
+    uint64_t* keys;  // pair index: packed (a, b) -> pairs[slots[i]]
+    int* slots;
+    size_t capacity;  // power of two
+
+    BPEHeapEntry* heap;
+    size_t heap_count;
+    size_t heap_cap;
+
+    BPEDelta* deltas;  // one per thread
+    int n_deltas;
+
+    size_t* visit;  // distinct words of the current merge
+    size_t cap_visit;
+};
+
+static inline uint64_t bpe_pair_key(int a, int b) {
+    return ((uint64_t) (uint32_t) a << 32) | (uint32_t) b;
+}
+
+static inline size_t bpe_pair_slot(const BPETrainer* tr, uint64_t key) {
+    return (size_t) (key * 0x9E3779B97F4A7C15ULL) & (tr->capacity - 1);
+}
+
+static bool bpe_index_grow(BPETrainer* tr) {
+    size_t capacity = tr->capacity ? 2 * tr->capacity : 1024;
+    uint64_t* keys = malloc(capacity * sizeof(uint64_t));
+    int* slots = malloc(capacity * sizeof(int));
+    if (!keys || !slots) {
+        free(keys);
+        free(slots);
+        return false;
+    }
+    memset(keys, 0xff, capacity * sizeof(uint64_t));  // all BPE_PAIR_EMPTY
+
+    uint64_t* old_keys = tr->keys;
+    int* old_slots = tr->slots;
+    size_t old_capacity = tr->capacity;
+    tr->keys = keys;
+    tr->slots = slots;
+    tr->capacity = capacity;
+
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_keys[i] != BPE_PAIR_EMPTY) {
+            size_t j = bpe_pair_slot(tr, old_keys[i]);
+            while (keys[j] != BPE_PAIR_EMPTY) {
+                j = (j + 1) & (capacity - 1);
+            }
+            keys[j] = old_keys[i];
+            slots[j] = old_slots[i];
+        }
+    }
+
+    free(old_keys);
+    free(old_slots);
+    return true;
+}
+
+// Index of the pair (a, b), created with a zero count if missing; -1 on failure
+static int bpe_pair_get(BPETrainer* tr, int a, int b) {
+    if (2 * (tr->n_pairs + 1) > tr->capacity && !bpe_index_grow(tr)) {
+        return -1;
+    }
+
+    const uint64_t key = bpe_pair_key(a, b);
+    size_t i = bpe_pair_slot(tr, key);
+    while (tr->keys[i] != BPE_PAIR_EMPTY) {
+        if (tr->keys[i] == key) {
+            return tr->slots[i];
+        }
+        i = (i + 1) & (tr->capacity - 1);
+    }
+
+    if (tr->n_pairs == tr->cap_pairs) {
+        size_t cap = tr->cap_pairs ? 2 * tr->cap_pairs : 1024;
+        BPEPair* pairs = realloc(tr->pairs, cap * sizeof(BPEPair));
+        if (!pairs) {
+            return -1;
+        }
+        tr->pairs = pairs;
+        tr->cap_pairs = cap;
+    }
+
+    int p = (int) tr->n_pairs++;
+    tr->pairs[p] = (BPEPair) {.a = a, .b = b};
+    tr->keys[i] = key;
+    tr->slots[i] = p;
+    return p;
+}
+
+// Grow an array of count elements of size bytes to hold one more
+static bool bpe_reserve(void** array, size_t* cap, size_t count, size_t size) {
+    if (count < *cap) {
+        return true;
+    }
+    size_t n = *cap ? 2 * *cap : 64;
+    void* grown = realloc(*array, n * size);
+    if (!grown) {
+        return false;
+    }
+    *array = grown;
+    *cap = n;
+    return true;
+}
+
+static bool bpe_delta_grow(BPEDelta* d) {
+    size_t capacity = d->capacity ? 2 * d->capacity : 256;
+    uint64_t* keys = malloc(capacity * sizeof(uint64_t));
+    int* slots = malloc(capacity * sizeof(int));
+    if (!keys || !slots) {
+        free(keys);
+        free(slots);
+        return false;
+    }
+    memset(keys, 0xff, capacity * sizeof(uint64_t));  // all BPE_PAIR_EMPTY
+
+    free(d->keys);
+    free(d->slots);
+    d->keys = keys;
+    d->slots = slots;
+    d->capacity = capacity;
+
+    // Re-index the changes collected so far
+    for (size_t c = 0; c < d->n_changes; c++) {
+        size_t i = (size_t) (d->changes[c].key * 0x9E3779B97F4A7C15ULL) & (capacity - 1);
+        while (keys[i] != BPE_PAIR_EMPTY) {
+            i = (i + 1) & (capacity - 1);
+        }
+        keys[i] = d->changes[c].key;
+        slots[i] = (int) c;
+    }
+    return true;
+}
+
+// Add to the change of a pair
+static bool bpe_delta_add(BPEDelta* d, uint64_t key, int64_t delta) {
+    if (2 * (d->n_changes + 1) > d->capacity && !bpe_delta_grow(d)) {
+        return false;
+    }
+
+    size_t i = (size_t) (key * 0x9E3779B97F4A7C15ULL) & (d->capacity - 1);
+    while (d->keys[i] != BPE_PAIR_EMPTY) {
+        if (d->keys[i] == key) {
+            d->changes[d->slots[i]].delta += delta;
+            return true;
+        }
+        i = (i + 1) & (d->capacity - 1);
+    }
+
+    if (!bpe_reserve((void**) &d->changes, &d->cap_changes, d->n_changes, sizeof(BPEChange))) {
+        return false;
+    }
+    d->keys[i] = key;
+    d->slots[i] = (int) d->n_changes;
+    d->changes[d->n_changes++] = (BPEChange) {key, delta};
+    return true;
+}
+
+static bool bpe_delta_list(BPEDelta* d, uint64_t key, size_t word) {
+    if (!bpe_reserve((void**) &d->listings, &d->cap_listings, d->n_listings, sizeof(BPEListing))) {
+        return false;
+    }
+    d->listings[d->n_listings++] = (BPEListing) {key, word};
+    return true;
+}
+
+// Empty the map, touching only the slots in use
+static void bpe_delta_clear(BPEDelta* d) {
+    for (size_t c = 0; c < d->n_changes; c++) {
+        // every key is present, so probing past emptied slots still finds it
+        uint64_t key = d->changes[c].key;
+        size_t i = (size_t) (key * 0x9E3779B97F4A7C15ULL) & (d->capacity - 1);
+        while (d->keys[i] != key) {
+            i = (i + 1) & (d->capacity - 1);
+        }
+        d->keys[i] = BPE_PAIR_EMPTY;
+    }
+    d->n_changes = 0;
+    d->n_listings = 0;
+}
+
+static void bpe_delta_free(BPEDelta* d) {
+    free(d->keys);
+    free(d->slots);
+    free(d->changes);
+    free(d->listings);
+    free(d->scratch);
+}
+
+static bool bpe_pair_add_word(BPEPair* pair, size_t word) {
+    if (pair->n_words > 0 && pair->words[pair->n_words - 1] == word) {
+        return true;  // already listed last
+    }
+    if (pair->n_words == pair->cap_words) {
+        size_t cap = pair->cap_words ? 2 * pair->cap_words : 4;
+        size_t* words = realloc(pair->words, cap * sizeof(size_t));
+        if (!words) {
+            return false;
+        }
+        pair->words = words;
+        pair->cap_words = cap;
+    }
+    pair->words[pair->n_words++] = word;
+    return true;
+}
+
+// Compare two pairs as their "A B" strings, like bpe_best()
+static int bpe_pair_cmp(const BPETrainer* tr, const BPEPair* x, const BPEPair* y) {
+    const char* xs[3] = {tr->symbols[x->a], " ", tr->symbols[x->b]};
+    const char* ys[3] = {tr->symbols[y->a], " ", tr->symbols[y->b]};
+    int xi = 0;
+    int yi = 0;
+    const char* xc = xs[0];
+    const char* yc = ys[0];
+
+    while (true) {
+        while (!*xc && xi < 2) {
+            xc = xs[++xi];
+        }
+        while (!*yc && yi < 2) {
+            yc = ys[++yi];
+        }
+        if (*xc != *yc || !*xc) {
+            return (int) (unsigned char) *xc - (int) (unsigned char) *yc;
+        }
+        xc++;
+        yc++;
+    }
+}
+
+static bool bpe_heap_before(const BPETrainer* tr, const BPEHeapEntry* x, const BPEHeapEntry* y) {
+    if (x->count != y->count) {
+        return x->count > y->count;
+    }
+    return bpe_pair_cmp(tr, &tr->pairs[x->pair], &tr->pairs[y->pair]) < 0;
+}
+
+static void bpe_heap_sift_down(BPETrainer* tr, size_t i) {
+    BPEHeapEntry e = tr->heap[i];
+    while (true) {
+        size_t child = 2 * i + 1;
+        if (child >= tr->heap_count) {
+            break;
+        }
+        if (child + 1 < tr->heap_count && bpe_heap_before(tr, &tr->heap[child + 1], &tr->heap[child])) {
+            child++;
+        }
+        if (!bpe_heap_before(tr, &tr->heap[child], &e)) {
+            break;
+        }
+        tr->heap[i] = tr->heap[child];
+        i = child;
+    }
+    tr->heap[i] = e;
+}
+
+static bool bpe_heap_push(BPETrainer* tr, int pair) {
+    if (tr->heap_count == tr->heap_cap) {
+        size_t cap = tr->heap_cap ? 2 * tr->heap_cap : 1024;
+        BPEHeapEntry* heap = realloc(tr->heap, cap * sizeof(BPEHeapEntry));
+        if (!heap) {
+            return false;
+        }
+        tr->heap = heap;
+        tr->heap_cap = cap;
+    }
+
+    BPEHeapEntry e = {tr->pairs[pair].count, pair};
+    size_t i = tr->heap_count++;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!bpe_heap_before(tr, &e, &tr->heap[parent])) {
+            break;
+        }
+        tr->heap[i] = tr->heap[parent];
+        i = parent;
+    }
+    tr->heap[i] = e;
+    return true;
+}
+
+static BPEHeapEntry bpe_heap_pop(BPETrainer* tr) {
+    BPEHeapEntry top = tr->heap[0];
+    tr->heap[0] = tr->heap[--tr->heap_count];
+    if (tr->heap_count > 0) {
+        bpe_heap_sift_down(tr, 0);
+    }
+    return top;
+}
+
+// Best pair by count then string (as bpe_best), or -1 when none is left
+static int bpe_trainer_best(BPETrainer* tr) {
+    while (tr->heap_count > 0) {
+        BPEHeapEntry e = bpe_heap_pop(tr);
+        int64_t count = tr->pairs[e.pair].count;
+        if (e.count == count) {
+            return count > 0 ? e.pair : -1;
+        }
+        if (count > 0 && !bpe_heap_push(tr, e.pair)) {
+            return -1;  // stale: re-queue with the current count
+        }
+    }
+    return -1;
+}
+
+static int bpe_symbol_intern(BPETrainer* tr, const char* symbol) {
+    int* id = hash_map_search(tr->symbol_ids, symbol);
+    if (id) {
+        return *id;
+    }
+
+    if (tr->n_symbols == tr->cap_symbols) {
+        size_t cap = tr->cap_symbols ? 2 * tr->cap_symbols : 256;
+        char** symbols = realloc(tr->symbols, cap * sizeof(char*));
+        if (!symbols) {
+            return -1;
+        }
+        tr->symbols = symbols;
+        tr->cap_symbols = cap;
+    }
+
+    char* key = strdup(symbol);
+    id = malloc(sizeof(int));
+    if (!key || !id) {
+        free(key);
+        free(id);
+        return -1;
+    }
+    *id = (int) tr->n_symbols;
+    if (HASH_SUCCESS != hash_map_insert(tr->symbol_ids, key, id)) {
+        free(key);
+        free(id);
+        return -1;
+    }
+
+    tr->symbols[tr->n_symbols++] = key;
+    return *id;
+}
+
+void bpe_trainer_free(BPETrainer* tr) {
+    if (tr) {
+        bpe_free(tr->model);
+        vocab_map_free(tr->symbol_ids);  // owns the symbol strings
+        free(tr->symbols);
+        for (size_t i = 0; i < tr->n_words; i++) {
+            free(tr->words[i].syms);
+        }
+        free(tr->words);
+        for (size_t i = 0; i < tr->n_pairs; i++) {
+            free(tr->pairs[i].words);
+        }
+        free(tr->pairs);
+        free(tr->keys);
+        free(tr->slots);
+        free(tr->heap);
+        for (int i = 0; i < tr->n_deltas; i++) {
+            bpe_delta_free(&tr->deltas[i]);
+        }
+        free(tr->deltas);
+        free(tr->visit);
+        free(tr);
+    }
+}
+
+
+static int bpe_key_cmp(const void* x, const void* y) {
+    uint64_t a = *(const uint64_t*) x;
+    uint64_t b = *(const uint64_t*) y;
+    return (a > b) - (a < b);
+}
+
+// Collect the sorted pair keys of a word into out
+static size_t bpe_word_keys(const BPEWord* w, uint64_t* out) {
+    size_t n = 0;
+    for (int i = 0; i + 1 < w->len; i++) {
+        out[n++] = bpe_pair_key(w->syms[i], w->syms[i + 1]);
+    }
+    qsort(out, n, sizeof(uint64_t), bpe_key_cmp);
+    return n;
+}
+
+// Apply the changes collected by the threads, in thread order
+static bool bpe_trainer_apply(BPETrainer* tr, bool queue) {
+    for (int t = 0; t < tr->n_deltas; t++) {
+        BPEDelta* d = &tr->deltas[t];
+
+        for (size_t c = 0; c < d->n_changes; c++) {
+            if (d->changes[c].delta == 0) {
+                continue;
+            }
+            uint64_t key = d->changes[c].key;
+            int p = bpe_pair_get(tr, (int) (key >> 32), (int) (key & UINT32_MAX));
+            if (p < 0) {
+                return false;
+            }
+            tr->pairs[p].count += d->changes[c].delta;
+            if (queue && d->changes[c].delta > 0 && !bpe_heap_push(tr, p)) {
+                return false;
+            }
+        }
+
+        for (size_t l = 0; l < d->n_listings; l++) {
+            uint64_t key = d->listings[l].key;
+            int p = bpe_pair_get(tr, (int) (key >> 32), (int) (key & UINT32_MAX));
+            if (p < 0 || !bpe_pair_add_word(&tr->pairs[p], d->listings[l].word)) {
+                return false;
+            }
+        }
+
+        bpe_delta_clear(d);
+    }
+    return true;
+}
+
+// Count the pairs of one word into a delta
+static bool bpe_word_count(BPEDelta* d, const BPEWord* w, size_t index) {
+    for (int i = 0; i + 1 < w->len; i++) {
+        uint64_t key = bpe_pair_key(w->syms[i], w->syms[i + 1]);
+        // repeats of a pair in one word are listed once by bpe_pair_add_word()
+        if (!bpe_delta_add(d, key, w->freq) || !bpe_delta_list(d, key, index)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Allocate an empty trainer for up to n_words words
+static BPETrainer* bpe_trainer_alloc(size_t n_words) {
+    BPETrainer* tr = calloc(1, sizeof(BPETrainer));
+    if (!tr) {
         return NULL;
     }
 
-    // Create a new BPE model
-    BPEModel* model = malloc(sizeof(BPEModel));
-    if (!model) {
-        vocab_map_free(internal_vocab);
+    tr->model = calloc(1, sizeof(BPEModel));
+    tr->symbol_ids = hash_map_create(1024, HASH_STR);
+    tr->words = calloc(n_words + 1, sizeof(BPEWord));
+    tr->n_deltas = omp_get_max_threads();
+    tr->deltas = calloc(tr->n_deltas, sizeof(BPEDelta));
+    if (!tr->model || !tr->symbol_ids || !tr->words || !tr->deltas || !bpe_index_grow(tr)) {
+        bpe_trainer_free(tr);
         return NULL;
     }
 
-    // Collect the best merge pairs (used to build the model)
-    model->count = 0;
-    model->capacity = 8;
-    model->merges = malloc(model->capacity * sizeof(BPEMerge));
-    if (!model->merges) {
-        vocab_map_free(internal_vocab);
-        bpe_free(model);
+    tr->model->capacity = 8;
+    tr->model->merges = malloc(tr->model->capacity * sizeof(BPEMerge));
+    if (!tr->model->merges) {
+        bpe_trainer_free(tr);
         return NULL;
     }
 
-    // Execute BPE merge steps
-    for (size_t i = 0; i < n_merges; i++) {
-        // Build symbol pairs from vocab
-        HashMap* pairs = bpe_pairs(internal_vocab);
-        if (verbose) {
-            vocab_map_log(pairs);  // debug
+    return tr;
+}
+
+// Count the pairs of every word and queue them
+static bool bpe_trainer_index(BPETrainer* tr) {
+    // Count pairs over contiguous shards of words, one per thread
+    bool ok = true;
+#pragma omp parallel num_threads(tr->n_deltas) reduction(&& : ok)
+    {
+        BPEDelta* d = &tr->deltas[omp_get_thread_num()];
+
+#pragma omp for schedule(static)
+        for (size_t w = 0; w < tr->n_words; w++) {
+            ok = ok && bpe_word_count(d, &tr->words[w], w);
         }
+    }
 
-        // Calculate the best pairs
-        int best_freq;
-        char* best_pair = bpe_best(pairs, &best_freq);
-        if (!best_pair) {
-            printf("[bpe] Exhausted all possible merge pairs at step %zu.\n", i);
-            vocab_map_free(pairs);
+    if (!ok || !bpe_trainer_apply(tr, false)) {
+        return false;
+    }
+
+    // Queue every pair, then heapify
+    if (tr->heap_cap < tr->n_pairs + 1) {
+        free(tr->heap);
+        tr->heap = malloc((tr->n_pairs + 1) * sizeof(BPEHeapEntry));
+        if (!tr->heap) {
+            return false;
+        }
+        tr->heap_cap = tr->n_pairs + 1;
+    }
+    for (size_t p = 0; p < tr->n_pairs; p++) {
+        tr->heap[tr->heap_count++] = (BPEHeapEntry) {tr->pairs[p].count, (int) p};
+    }
+    for (size_t i = tr->heap_count / 2; i-- > 0;) {
+        bpe_heap_sift_down(tr, i);
+    }
+
+    return true;
+}
+
+// Append a merge to the model (which takes ownership of pair)
+static bool bpe_model_append(BPEModel* model, char* pair, int freq) {
+    if (model->count == model->capacity) {
+        size_t new_cap = model->capacity * 2;
+        BPEMerge* temp = realloc(model->merges, new_cap * sizeof(BPEMerge));
+        if (!temp) {
+            return false;
+        }
+        model->merges = temp;
+        model->capacity = new_cap;
+    }
+
+    model->merges[model->count++] = (BPEMerge) {pair, freq};
+    return true;
+}
+
+// Merge (a, b) -> c in one word and collect the net change of each pair
+static bool bpe_word_merge(BPEDelta* d, BPEWord* w, size_t index, int a, int b, int c) {
+    bool found = false;
+    for (int i = 0; i + 1 < w->len && !found; i++) {
+        found = w->syms[i] == a && w->syms[i + 1] == b;
+    }
+    if (!found) {
+        return true;  // stale listing
+    }
+
+    if ((size_t) (2 * w->len) > d->scratch_cap) {
+        size_t cap = 2 * (size_t) w->len;
+        uint64_t* scratch = realloc(d->scratch, cap * sizeof(uint64_t));
+        if (!scratch) {
+            return false;
+        }
+        d->scratch = scratch;
+        d->scratch_cap = cap;
+    }
+    uint64_t* before = d->scratch;
+    size_t n_before = bpe_word_keys(w, before);
+
+    // Merge left to right, as bpe_merges() does
+    int len = 0;
+    for (int i = 0; i < w->len;) {
+        if (i + 1 < w->len && w->syms[i] == a && w->syms[i + 1] == b) {
+            w->syms[len++] = c;
+            i += 2;
+        } else {
+            w->syms[len++] = w->syms[i++];
+        }
+    }
+    w->len = len;
+
+    uint64_t* after = before + n_before;
+    size_t n_after = bpe_word_keys(w, after);
+
+    // Walk both sorted key lists and record the net change of each pair
+    size_t i = 0;
+    size_t j = 0;
+    while (i < n_before || j < n_after) {
+        uint64_t key = (j >= n_after || (i < n_before && before[i] < after[j])) ? before[i] : after[j];
+        int64_t old_n = 0;
+        int64_t new_n = 0;
+        while (i < n_before && before[i] == key) {
+            old_n++;
+            i++;
+        }
+        while (j < n_after && after[j] == key) {
+            new_n++;
+            j++;
+        }
+        if (old_n == new_n) {
+            continue;
+        }
+
+        if (!bpe_delta_add(d, key, (new_n - old_n) * w->freq)) {
+            return false;
+        }
+        if (old_n == 0 && !bpe_delta_list(d, key, index)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Apply the merge of pair p to every word listed for it
+static bool bpe_trainer_merge(BPETrainer* tr, int p, size_t step) {
+    int a = tr->pairs[p].a;
+    int b = tr->pairs[p].b;
+
+    char* merged = string_concat(tr->symbols[a], tr->symbols[b]);
+    int c = merged ? bpe_symbol_intern(tr, merged) : -1;
+    free(merged);
+    if (c < 0) {
+        return false;
+    }
+
+    // Detach the list; the merged pair is gone from every word afterwards
+    size_t* words = tr->pairs[p].words;
+    size_t n_words = tr->pairs[p].n_words;
+    tr->pairs[p].words = NULL;
+    tr->pairs[p].n_words = tr->pairs[p].cap_words = 0;
+
+    // Distinct words, so no two threads touch the same word
+    if (n_words > tr->cap_visit) {
+        size_t* visit = realloc(tr->visit, n_words * sizeof(size_t));
+        if (!visit) {
+            free(words);
+            return false;
+        }
+        tr->visit = visit;
+        tr->cap_visit = n_words;
+    }
+    size_t n_visit = 0;
+    for (size_t i = 0; i < n_words; i++) {
+        BPEWord* w = &tr->words[words[i]];
+        if (w->stamp != step + 1) {
+            w->stamp = step + 1;
+            tr->visit[n_visit++] = words[i];
+        }
+    }
+    free(words);
+
+    bool ok = true;
+#pragma omp parallel num_threads(tr->n_deltas) if (n_visit >= BPE_PARALLEL_WORDS) reduction(&& : ok)
+    {
+        BPEDelta* d = &tr->deltas[omp_get_thread_num()];
+
+#pragma omp for schedule(dynamic, 64)
+        for (size_t i = 0; i < n_visit; i++) {
+            size_t index = tr->visit[i];
+            ok = ok && bpe_word_merge(d, &tr->words[index], index, a, b, c);
+        }
+    }
+
+    return ok && bpe_trainer_apply(tr, true);
+}
+
+BPETrainer* bpe_trainer_new(HashMap* vocab) {
+    if (!vocab) {
+        return NULL;
+    }
+
+    BPETrainer* tr = bpe_trainer_alloc(hash_count(vocab));
+    if (!tr) {
+        return NULL;
+    }
+
+    // Intern the symbols of every word
+    HashEntry* entry;
+    HashIt it = hash_iter(vocab);
+    while ((entry = hash_iter_next(&it))) {
+        size_t sym_count = 0;
+        char** syms = string_split_delim(entry->key, " ", &sym_count);
+        BPEWord* w = &tr->words[tr->n_words];
+        w->syms = malloc((sym_count + 1) * sizeof(int));
+        if (!syms || !w->syms) {
+            string_split_free(syms, sym_count);
+            bpe_trainer_free(tr);
+            return NULL;
+        }
+
+        for (size_t i = 0; i < sym_count; i++) {
+            w->syms[w->len++] = bpe_symbol_intern(tr, syms[i]);
+        }
+        w->freq = *(int*) entry->value;
+        tr->n_words++;
+        string_split_free(syms, sym_count);
+    }
+
+    if (!bpe_trainer_index(tr)) {
+        bpe_trainer_free(tr);
+        return NULL;
+    }
+
+    return tr;
+}
+
+size_t bpe_trainer_run(BPETrainer* tr, size_t n_merges) {
+    size_t done = 0;
+    for (; done < n_merges; done++) {
+        size_t step = tr->model->count;
+
+        // Calculate the best pair
+        int p = bpe_trainer_best(tr);
+        if (p < 0) {
+            printf("[bpe] Exhausted all possible merge pairs at step %zu.\n", step);
             break;
         }
 
+        const BPEPair* best = &tr->pairs[p];
+        const char* tuple[] = {tr->symbols[best->a], tr->symbols[best->b]};
+        char* best_pair = string_join((char**) tuple, 2, " ");
+        int best_freq = (int) best->count;
+        if (!best_pair) {
+            return SIZE_MAX;
+        }
+
         // Observe the best merge pair
-        printf("[bpe] step=%zu, best_freq=%d, best_pair=%s\n", i, best_freq, best_pair);
-
-        // Grow array if needed
-        if (model->count == model->capacity) {
-            size_t new_cap = model->capacity * 2;
-            BPEMerge* temp = realloc(model->merges, new_cap * sizeof(BPEMerge));
-            if (!temp) {
-                // Free everything up to now
-                free(best_pair);
-                vocab_map_free(pairs);
-                vocab_map_free(internal_vocab);
-                bpe_free(model);
-                return NULL;
+        printf("[bpe] step=%zu, best_freq=%d, best_pair=%s\n", step, best_freq, best_pair);
+
+        // Append the best merge pair (the model owns it)
+        if (!bpe_model_append(tr->model, best_pair, best_freq)) {
+            free(best_pair);
+            return SIZE_MAX;
+        }
+
+        // Merge all matching pairs
+        if (!bpe_trainer_merge(tr, p, step)) {
+            return SIZE_MAX;
+        }
+    }
+
+    return done;
+}
+
+BPEModel* bpe_trainer_model(BPETrainer* tr) {
+    return tr ? tr->model : NULL;
+}
+
+// Checkpoint I/O: every field is a fixed-width native-endian integer
+static bool bpe_write(FILE* file, const void* data, size_t size) {
+    return size == 0 || 1 == fwrite(data, size, 1, file);
+}
+
+static bool bpe_read(FILE* file, void* data, size_t size) {
+    return size == 0 || 1 == fread(data, size, 1, file);
+}
+
+static bool bpe_write_string(FILE* file, const char* s) {
+    int32_t len = (int32_t) strlen(s);
+    return bpe_write(file, &len, sizeof(len)) && bpe_write(file, s, (size_t) len);
+}
+
+// Read a length-prefixed string; NULL on a short read or a bad length
+static char* bpe_read_string(FILE* file) {
+    int32_t len;
+    if (!bpe_read(file, &len, sizeof(len)) || len < 0) {
+        return NULL;
+    }
+    char* s = malloc((size_t) len + 1);
+    if (!s || !bpe_read(file, s, (size_t) len)) {
+        free(s);
+        return NULL;
+    }
+    s[len] = '\0';
+    return s;
+}
+
+static bool bpe_trainer_write(const BPETrainer* tr, FILE* file) {
+    uint64_t n_pairs = 0;
+    for (size_t p = 0; p < tr->n_pairs; p++) {
+        n_pairs += tr->pairs[p].count > 0;
+    }
+
+    int32_t head[2] = {BPE_TRAINER_MAGIC, BPE_TRAINER_VERSION};
+    uint64_t counts[4] = {tr->n_symbols, tr->n_words, n_pairs, tr->model->count};
+    if (!bpe_write(file, head, sizeof(head)) || !bpe_write(file, counts, sizeof(counts))) {
+        return false;
+    }
+
+    for (size_t i = 0; i < tr->n_symbols; i++) {
+        if (!bpe_write_string(file, tr->symbols[i])) {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < tr->n_words; i++) {
+        const BPEWord* w = &tr->words[i];
+        int32_t word[2] = {w->freq, w->len};
+        if (!bpe_write(file, word, sizeof(word))
+            || !bpe_write(file, w->syms, (size_t) w->len * sizeof(int32_t))) {
+            return false;
+        }
+    }
+
+    for (size_t p = 0; p < tr->n_pairs; p++) {
+        const BPEPair* pair = &tr->pairs[p];
+        if (pair->count <= 0) {
+            continue;
+        }
+        int32_t ab[2] = {pair->a, pair->b};
+        int64_t count = pair->count;
+        if (!bpe_write(file, ab, sizeof(ab)) || !bpe_write(file, &count, sizeof(count))) {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < tr->model->count; i++) {
+        int32_t freq = tr->model->merges[i].freq;
+        if (!bpe_write_string(file, tr->model->merges[i].pair)
+            || !bpe_write(file, &freq, sizeof(freq))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool bpe_trainer_save(const BPETrainer* tr, const char* path) {
+    if (!tr || !path) {
+        return false;
+    }
+
+    char* dirname = path_dirname(path);
+    path_mkdir(dirname);
+    free(dirname);
+
+    // Write beside the target, then rename, so an interrupted save keeps the last checkpoint
+    char* tmp_path = string_concat(path, ".tmp");
+    if (!tmp_path) {
+        return false;
+    }
+
+    FILE* file = fopen(tmp_path, "wb");
+    if (!file) {
+        LOG_ERROR("bpe_trainer_save: cannot open %s", tmp_path);
+        free(tmp_path);
+        return false;
+    }
+
+    bool ok = bpe_trainer_write(tr, file);
+    ok = (0 == fclose(file)) && ok;
+    ok = ok && 0 == rename(tmp_path, path);
+    if (!ok) {
+        LOG_ERROR("bpe_trainer_save: failed to write %s", path);
+        remove(tmp_path);
+    }
+
+    free(tmp_path);
+    return ok;
+}
+
+static bool bpe_trainer_read(BPETrainer* tr, FILE* file, const uint64_t counts[4]) {
+    for (uint64_t i = 0; i < counts[0]; i++) {
+        char* symbol = bpe_read_string(file);
+        int id = symbol ? bpe_symbol_intern(tr, symbol) : -1;
+        free(symbol);
+        if (id != (int) i) {
+            return false;  // short read or duplicate symbol
+        }
+    }
+
+    for (uint64_t i = 0; i < counts[1]; i++) {
+        int32_t word[2];
+        if (!bpe_read(file, word, sizeof(word)) || word[1] < 0) {
+            return false;
+        }
+
+        BPEWord* w = &tr->words[tr->n_words++];
+        w->freq = word[0];
+        w->len = word[1];
+        w->syms = malloc(((size_t) w->len + 1) * sizeof(int));
+        if (!w->syms || !bpe_read(file, w->syms, (size_t) w->len * sizeof(int32_t))) {
+            return false;
+        }
+        for (int j = 0; j < w->len; j++) {
+            if (w->syms[j] < 0 || (size_t) w->syms[j] >= tr->n_symbols) {
+                return false;
             }
-            model->merges = temp;
-            model->capacity = new_cap;
         }
+    }
 
-        // Append the best merge pair
-        model->merges[model->count++] = (BPEMerge) {strdup(best_pair), best_freq};
+    // Pair counts follow from the words; recount them and check against the saved ones
+    if (!bpe_trainer_index(tr)) {
+        return false;
+    }
 
-        // Merge all matching pairs
-        HashMap* new_vocab = bpe_merges(internal_vocab, best_pair);
-        if (verbose) {
-            vocab_map_log(new_vocab);
+    uint64_t n_pairs = 0;
+    for (size_t p = 0; p < tr->n_pairs; p++) {
+        n_pairs += tr->pairs[p].count > 0;
+    }
+    if (n_pairs != counts[2]) {
+        return false;
+    }
+    for (uint64_t i = 0; i < counts[2]; i++) {
+        int32_t ab[2];
+        int64_t count;
+        if (!bpe_read(file, ab, sizeof(ab)) || !bpe_read(file, &count, sizeof(count))) {
+            return false;
+        }
+        if (ab[0] < 0 || ab[1] < 0 || (size_t) ab[0] >= tr->n_symbols || (size_t) ab[1] >= tr->n_symbols) {
+            return false;
+        }
+        int p = bpe_pair_get(tr, ab[0], ab[1]);
+        if (p < 0 || tr->pairs[p].count != count) {
+            return false;
+        }
+    }
+
+    for (uint64_t i = 0; i < counts[3]; i++) {
+        int32_t freq;
+        char* pair = bpe_read_string(file);
+        if (!pair || !bpe_read(file, &freq, sizeof(freq)) || !bpe_model_append(tr->model, pair, freq)) {
+            free(pair);
+            return false;
         }
+    }
+
+    return true;
+}
+
+BPETrainer* bpe_trainer_load(const char* path) {
+    if (!path_is_file(path)) {
+        LOG_ERROR("bpe_trainer_load: %s is not a file", path ? path : "(null)");
+        return NULL;
+    }
+
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        LOG_ERROR("bpe_trainer_load: cannot open %s", path);
+        return NULL;
+    }
+
+    int32_t head[2];
+    uint64_t counts[4];  // symbols, words, pairs, merges
+    if (!bpe_read(file, head, sizeof(head)) || head[0] != BPE_TRAINER_MAGIC
+        || head[1] != BPE_TRAINER_VERSION || !bpe_read(file, counts, sizeof(counts))
+        || counts[0] > INT32_MAX || counts[1] > SIZE_MAX / sizeof(BPEWord) - 1) {
+        LOG_ERROR("bpe_trainer_load: %s is not a trainer checkpoint", path);
+        fclose(file);
+        return NULL;
+    }
+
+    BPETrainer* tr = bpe_trainer_alloc((size_t) counts[1]);
+    if (!tr) {
+        fclose(file);
+        return NULL;
+    }
+
+    if (!bpe_trainer_read(tr, file, counts)) {
+        LOG_ERROR("bpe_trainer_load: %s is truncated or corrupt", path);
+        bpe_trainer_free(tr);
+        tr = NULL;
+    }
 
-        // Clean up
-        free(best_pair);
-        vocab_map_free(pairs);
-        vocab_map_free(internal_vocab);
+    fclose(file);
+    return tr;
+}
+
+/** @} */
+
+BPEModel* bpe_train(HashMap* vocab, size_t n_merges, bool verbose) {
+    BPETrainer* tr = bpe_trainer_new(vocab);
+    if (!tr) {
+        return NULL;
+    }
+
+    if (verbose) {
+        printf("[bpe] words=%zu, symbols=%zu, pairs=%zu\n", tr->n_words, tr->n_symbols, tr->n_pairs);
+    }
 
-        // Update
-        internal_vocab = new_vocab;
+    // Execute BPE merge steps
+    if (SIZE_MAX == bpe_trainer_run(tr, n_merges)) {
+        bpe_trainer_free(tr);
+        return NULL;
     }
     printf("\n");
 
-    /// @note ASAN doesn't catch this.
-    vocab_map_free(internal_vocab);  // Always free before exiting.
+    // Keep the merges, drop the rest of the trainer
+    BPEModel* model = tr->model;
+    tr->model = NULL;
+    bpe_trainer_free(tr);
     return model;
 }
 
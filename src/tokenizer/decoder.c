@@ -0,0 +1,254 @@
+/**
+ * @file      tokenizer/decoder.c
+ * @brief     Streaming (incremental) detokenizer
+ * @copyright Copyright © 2025 Austin Berrio
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/logger.h"
+#include "tokenizer/model.h"
+#include "tokenizer/decoder.h"
+
+/**
+ * @section Private
+ * @{
+ */
+
+static bool decoder_reserve(Decoder* d, size_t len) {
+    if (len + 1 <= d->capacity) {
+        return true;
+    }
+
+    size_t capacity = d->capacity ? d->capacity : 64;
+    while (capacity < len + 1) {
+        capacity *= 2;
+    }
+
+    char* text = realloc(d->text, capacity);
+    if (!text) {
+        LOG_ERROR("Failed to grow decoder buffer to %zu bytes.", capacity);
+        return false;
+    }
+
+    d->text = text;
+    d->capacity = capacity;
+    return true;
+}
+
+static bool decoder_is_special(const Decoder* d, const char* token) {
+    const SpecialToken* s = d->t->special;
+    if (!s) {
+        return false;
+    }
+    return (s->bos && strcmp(token, s->bos) == 0) || (s->eos && strcmp(token, s->eos) == 0)
+           || (s->pad && strcmp(token, s->pad) == 0) || (s->unk && strcmp(token, s->unk) == 0);
+}
+
+// Incremental KMP step: returns true when the stop string completes
+static bool decoder_stop_feed(DecoderStop* stop, char c) {
+    while (stop->matched > 0 && stop->text[stop->matched] != c) {
+        stop->matched = stop->fail[stop->matched - 1];
+    }
+    if (stop->text[stop->matched] == c) {
+        stop->matched++;
+    }
+    return stop->matched == stop->len;
+}
+
+// Largest prefix of s[0, len) that does not end inside a UTF-8 sequence
+static size_t decoder_utf8_boundary(const char* s, size_t len) {
+    size_t i = len;
+    size_t n = 0;
+    while (i > 0 && n < 3 && ((unsigned char) s[i - 1] & 0xC0) == 0x80) {
+        i--;
+        n++;
+    }
+    if (i == 0) {
+        return len;  // no lead byte: invalid, pass through
+    }
+
+    unsigned char lead = (unsigned char) s[i - 1];
+    size_t need = 1;
+    if ((lead & 0xE0) == 0xC0) {
+        need = 2;
+    } else if ((lead & 0xF0) == 0xE0) {
+        need = 3;
+    } else if ((lead & 0xF8) == 0xF0) {
+        need = 4;
+    }
+
+    return (n + 1 < need) ? i - 1 : len;
+}
+
+// Hand out bytes [emitted, end)
+static const char* decoder_emit(Decoder* d, size_t end, size_t* len) {
+    if (end < d->emitted) {
+        end = d->emitted;
+    }
+    const char* out = d->text + d->emitted;
+    *len = end - d->emitted;
+    d->emitted = end;
+    return out;
+}
+
+/** @} */
+
+/**
+ * @section Decoder life-cycle
+ * @{
+ */
+
+Decoder decoder_new(Tokenizer* t) {
+    Decoder d = {0};
+    d.t = t;
+    d.stop = -1;
+    if (!t || !decoder_reserve(&d, 0)) {
+        return d;
+    }
+    d.text[0] = '\0';
+    return d;
+}
+
+void decoder_free(Decoder* d) {
+    if (d) {
+        for (size_t i = 0; i < d->n_stops; i++) {
+            free(d->stops[i].text);
+            free(d->stops[i].fail);
+        }
+        free(d->stops);
+        free(d->text);
+        *d = (Decoder) {.stop = -1};
+    }
+}
+
+void decoder_reset(Decoder* d) {
+    if (!d || !d->text) {
+        return;
+    }
+    d->len = 0;
+    d->emitted = 0;
+    d->stop = -1;
+    d->text[0] = '\0';
+    for (size_t i = 0; i < d->n_stops; i++) {
+        d->stops[i].matched = 0;
+    }
+}
+
+bool decoder_add_stop(Decoder* d, const char* text) {
+    if (!d || !text || !*text) {
+        return false;
+    }
+
+    DecoderStop stop = {0};
+    stop.len = strlen(text);
+    stop.text = strdup(text);
+    stop.fail = calloc(stop.len, sizeof(size_t));
+    if (!stop.text || !stop.fail) {
+        free(stop.text);
+        free(stop.fail);
+        return false;
+    }
+
+    // KMP prefix function over bytes
+    for (size_t i = 1, k = 0; i < stop.len; i++) {
+        while (k > 0 && stop.text[i] != stop.text[k]) {
+            k = stop.fail[k - 1];
+        }
+        if (stop.text[i] == stop.text[k]) {
+            k++;
+        }
+        stop.fail[i] = k;
+    }
+
+    DecoderStop* stops = realloc(d->stops, (d->n_stops + 1) * sizeof(DecoderStop));
+    if (!stops) {
+        free(stop.text);
+        free(stop.fail);
+        return false;
+    }
+
+    d->stops = stops;
+    d->stops[d->n_stops++] = stop;
+    return true;
+}
+
+/** @} */
+
+/**
+ * @section Streaming
+ * @{
+ */
+
+const char* decoder_push(Decoder* d, int id, size_t* len) {
+    if (!d || !d->text || !len) {
+        return NULL;
+    }
+
+    *len = 0;
+    if (d->stop >= 0) {
+        return d->text + d->emitted;  // output is closed
+    }
+
+    if (id < 0 || id >= d->t->vocab_size) {
+        LOG_ERROR("Invalid token id: %d (vocab_size=%d)", id, d->t->vocab_size);
+        return NULL;
+    }
+
+    const char* token = d->t->id_to_token[id];
+    if (d->skip_special && decoder_is_special(d, token)) {
+        return d->text + d->emitted;
+    }
+
+    // Append only the new token's bytes
+    size_t n = strlen(token);
+    if (!decoder_reserve(d, d->len + n)) {
+        return NULL;
+    }
+    size_t start = d->len;
+    memcpy(d->text + start, token, n);
+    d->len += n;
+    d->text[d->len] = '\0';
+
+    // Feed the new bytes to every stop matcher
+    for (size_t i = start; i < d->len && d->stop < 0; i++) {
+        for (size_t s = 0; s < d->n_stops; s++) {
+            if (decoder_stop_feed(&d->stops[s], d->text[i])) {
+                d->len = i + 1 - d->stops[s].len;  // cut the stop string
+                d->text[d->len] = '\0';
+                d->stop = (int) s;
+                break;
+            }
+        }
+    }
+
+    if (d->stop >= 0) {
+        return decoder_emit(d, d->len, len);
+    }
+
+    // Hold back a possible stop prefix and any partial UTF-8 sequence
+    size_t hold = 0;
+    for (size_t s = 0; s < d->n_stops; s++) {
+        if (d->stops[s].matched > hold) {
+            hold = d->stops[s].matched;
+        }
+    }
+
+    size_t end = decoder_utf8_boundary(d->text, d->len - hold);
+    return decoder_emit(d, end, len);
+}
+
+const char* decoder_flush(Decoder* d, size_t* len) {
+    if (!d || !d->text || !len) {
+        return NULL;
+    }
+    return decoder_emit(d, d->len, len);
+}
+
+bool decoder_stopped(const Decoder* d) {
+    return d && d->stop >= 0;
+}
+
+/** @} */
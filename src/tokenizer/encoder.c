@@ -0,0 +1,195 @@
+/**
+ * @file      tokenizer/encoder.c
+ * @brief     Streaming encoder with bounded memory
+ * @copyright Copyright © 2025 Austin Berrio
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "core/logger.h"
+#include "tokenizer/model.h"
+#include "tokenizer/encoder.h"
+
+/**
+ * @section Private
+ * @{
+ */
+
+// Double the buffer so a word longer than it can be carried whole
+static bool encoder_grow(Encoder* e) {
+    size_t capacity = 2 * e->capacity;
+    char* text = realloc(e->text, capacity);
+    if (!text) {
+        LOG_ERROR("Failed to grow the encoder to %zu bytes.", capacity);
+        return false;
+    }
+    e->text = text;
+
+    int* ids = realloc(e->ids, (capacity + 2) * sizeof(int));
+    if (!ids) {
+        LOG_ERROR("Failed to grow the encoder to %zu bytes.", capacity);
+        return false;
+    }
+    e->ids = ids;
+
+    e->capacity = capacity;
+    return true;
+}
+
+// Encode and emit the first cut bytes, keeping the rest for the next chunk
+static bool encoder_emit(Encoder* e, size_t cut, bool last) {
+    bool bos = e->add_bos && !e->started;
+    bool eos = e->add_eos && last;
+
+    size_t count = tokenizer_encode_span(e->t, e->text, cut, bos, eos, e->ids);
+    if (count == SIZE_MAX) {
+        LOG_ERROR("Failed to encode a %zu byte chunk.", cut);
+        return false;
+    }
+
+    e->started = true;
+    e->len -= cut;
+    memmove(e->text, e->text + cut, e->len);
+
+    e->n_ids += count;
+    return count == 0 || e->sink(e->ids, count, e->ctx);
+}
+
+// Encode a full buffer up to its last word boundary
+static bool encoder_drain(Encoder* e) {
+    size_t cut = tokenizer_boundary(e->t, e->text, e->len);
+    if (cut == 0) {
+        return encoder_grow(e);  // one word fills the buffer
+    }
+    return encoder_emit(e, cut, false);
+}
+
+/** @} */
+
+/**
+ * @section Encoder life-cycle
+ * @{
+ */
+
+Encoder encoder_new(Tokenizer* t, size_t capacity, EncoderSink sink, void* ctx) {
+    Encoder e = {0};
+    if (!t || !sink) {
+        LOG_ERROR("Encoder needs a tokenizer and a sink.");
+        return e;
+    }
+
+    e.t = t;
+    e.capacity = capacity > 0 ? capacity : ENCODER_CAPACITY;
+    e.sink = sink;
+    e.ctx = ctx;
+    e.text = malloc(e.capacity);
+    e.ids = malloc((e.capacity + 2) * sizeof(int));
+    if (!e.text || !e.ids) {
+        LOG_ERROR("Failed to allocate a %zu byte encoder.", e.capacity);
+        encoder_free(&e);
+    }
+
+    return e;
+}
+
+void encoder_free(Encoder* e) {
+    if (e) {
+        free(e->text);
+        free(e->ids);
+        e->text = NULL;
+        e->ids = NULL;
+    }
+}
+
+/** @} */
+
+/**
+ * @section Streaming
+ * @{
+ */
+
+bool encoder_push(Encoder* e, const char* bytes, size_t len) {
+    if (!e || !e->text || (!bytes && len > 0)) {
+        return false;
+    }
+
+    while (len > 0) {
+        size_t n = e->capacity - e->len;
+        n = n < len ? n : len;
+
+        memcpy(e->text + e->len, bytes, n);
+        e->len += n;
+        e->n_bytes += n;
+        bytes += n;
+        len -= n;
+
+        if (e->len == e->capacity && !encoder_drain(e)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool encoder_flush(Encoder* e) {
+    if (!e || !e->text) {
+        return false;
+    }
+    return encoder_emit(e, e->len, true);
+}
+
+bool encoder_read_fd(Encoder* e, int fd) {
+    if (!e || !e->text || fd < 0) {
+        return false;
+    }
+
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    while (true) {
+        ssize_t n = read(fd, e->text + e->len, e->capacity - e->len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR("Failed to read input: %s", strerror(errno));
+            return false;
+        }
+        if (n == 0) {
+            break;  // end of input
+        }
+
+        e->len += (size_t) n;
+        e->n_bytes += (size_t) n;
+        if (e->len == e->capacity && !encoder_drain(e)) {
+            return false;
+        }
+    }
+
+    return encoder_flush(e);
+}
+
+bool encoder_read_file(Encoder* e, const char* path) {
+    int fd = path ? open(path, O_RDONLY) : -1;
+    if (fd < 0) {
+        LOG_ERROR("Failed to open %s", path ? path : "(null)");
+        return false;
+    }
+
+    bool ok = encoder_read_fd(e, fd);
+    close(fd);
+    return ok;
+}
+
+bool encoder_sink_file(const int* ids, size_t count, void* ctx) {
+    FILE* file = (FILE*) ctx;
+    return file && fwrite(ids, sizeof(int), count, file) == count;
+}
+
+/** @} */
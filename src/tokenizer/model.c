@@ -17,7 +17,12 @@
 #include <string.h>
 #include <math.h>
 #include <limits.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <omp.h>
 
+#include "core/checksum.h"
 #include "core/path.h"
 #include "core/strext.h"
 #include "core/logger.h"
@@ -28,6 +33,252 @@
 #include "tokenizer/bpe.h"
 #include "tokenizer/model.h"
 
+/**
+ * @section Merge table
+ *
+ * Encoding only ever asks "what do ids a and b merge into, and when?". The
+ * table answers that with one multiply-shift hash of the packed pair instead
+ * of building and hashing the concatenated string. It is derived from the
+ * vocabulary and scores: every split of a scored token into two vocabulary
+ * tokens is a merge, ranked by its score (equal scores share a rank).
+ * @{
+ */
+
+#define TOKEN_MERGE_EMPTY UINT64_MAX  // ids are non-negative, so no pair packs to this
+
+/**
+ * @brief Merge of a packed (id_a << 32 | id_b) pair.
+ */
+typedef struct TokenMergeEntry {
+    uint64_t key;  // packed pair, or TOKEN_MERGE_EMPTY
+    int id;  // merged token id
+    int rank;  // merge priority (lower merges first)
+} TokenMergeEntry;
+
+/**
+ * @brief Open-addressed pair table (linear probing, power-of-two capacity).
+ */
+typedef struct TokenMergeTable {
+    TokenMergeEntry* entries;
+    size_t capacity;
+    size_t count;
+    int shift;  // 64 - log2(capacity)
+    uint64_t serial;  // unique per table; tags encode cache entries
+    bool boundary[256];  // bytes whose symbol never merges (pre-token boundaries)
+    int bos;  // special ids resolved at load (-1 if unmapped)
+    int eos;
+} TokenMergeTable;
+
+static inline uint64_t token_pair(int a, int b) {
+    return ((uint64_t) (uint32_t) a << 32) | (uint32_t) b;
+}
+
+static inline size_t token_pair_slot(const TokenMergeTable* m, uint64_t key) {
+    return (size_t) ((key * 0x9E3779B97F4A7C15ULL) >> m->shift);
+}
+
+static const TokenMergeEntry* token_merge_find(const TokenMergeTable* m, int a, int b) {
+    const uint64_t key = token_pair(a, b);
+    const size_t mask = m->capacity - 1;
+    for (size_t i = token_pair_slot(m, key);; i = (i + 1) & mask) {
+        const TokenMergeEntry* e = &m->entries[i];
+        if (e->key == key) {
+            return e;
+        }
+        if (e->key == TOKEN_MERGE_EMPTY) {
+            return NULL;
+        }
+    }
+}
+
+static void token_merge_insert(TokenMergeTable* m, int a, int b, int id, int rank) {
+    const uint64_t key = token_pair(a, b);
+    const size_t mask = m->capacity - 1;
+    for (size_t i = token_pair_slot(m, key);; i = (i + 1) & mask) {
+        TokenMergeEntry* e = &m->entries[i];
+        if (e->key == key) {
+            return;  // splits of one token are unique pairs; keep the first
+        }
+        if (e->key == TOKEN_MERGE_EMPTY) {
+            *e = (TokenMergeEntry) {key, id, rank};
+            m->count++;
+            return;
+        }
+    }
+}
+
+static int token_score_cmp(const void* a, const void* b) {
+    float x = *(const float*) a;
+    float y = *(const float*) b;
+    return (x < y) - (x > y);  // descending
+}
+
+void token_merge_free(TokenMergeTable* m) {
+    if (m) {
+        free(m->entries);
+        free(m);
+    }
+}
+
+TokenMergeTable* token_merge_create(Tokenizer* t) {
+    // collect finite scores and the pair capacity they need
+    size_t score_count = 0;
+    size_t pair_count = 0;
+    float* scores = malloc((hash_count(t->scores) + 1) * sizeof(float));
+    if (!scores) {
+        return NULL;
+    }
+
+    HashEntry* entry;
+    HashIt it = hash_iter(t->scores);
+    while ((entry = hash_iter_next(&it))) {
+        float score = *(float*) entry->value;
+        size_t len = strlen(entry->key);
+        if (score != -INFINITY && len > 1) {
+            scores[score_count++] = score;
+            pair_count += len - 1;
+        }
+    }
+
+    // rank distinct scores: higher scores merge first
+    qsort(scores, score_count, sizeof(float), token_score_cmp);
+    size_t distinct = 0;
+    for (size_t i = 0; i < score_count; i++) {
+        if (distinct == 0 || scores[i] != scores[distinct - 1]) {
+            scores[distinct++] = scores[i];
+        }
+    }
+
+    TokenMergeTable* m = calloc(1, sizeof(TokenMergeTable));
+    if (!m) {
+        free(scores);
+        return NULL;
+    }
+
+    // keep the load factor at or below 1/2
+    m->capacity = 16;
+    m->shift = 60;
+    while (m->capacity < 2 * pair_count) {
+        m->capacity <<= 1;
+        m->shift--;
+    }
+    m->entries = malloc(m->capacity * sizeof(TokenMergeEntry));
+    if (!m->entries) {
+        free(scores);
+        free(m);
+        return NULL;
+    }
+    memset(m->entries, 0xff, m->capacity * sizeof(TokenMergeEntry));  // all TOKEN_MERGE_EMPTY
+
+    // every split of a scored token into two vocabulary tokens is a merge
+    char* buffer = NULL;
+    size_t buffer_len = 0;
+    it = hash_iter(t->scores);
+    while ((entry = hash_iter_next(&it))) {
+        float score = *(float*) entry->value;
+        int* id = hash_map_search(t->token_to_id, entry->key);
+        if (score == -INFINITY || !id) {
+            continue;
+        }
+
+        const char* token = entry->key;
+        size_t len = strlen(token);
+        if (len + 1 > buffer_len) {
+            char* grown = realloc(buffer, len + 1);
+            if (!grown) {
+                break;
+            }
+            buffer = grown;
+            buffer_len = len + 1;
+        }
+
+        float* rank = bsearch(&score, scores, distinct, sizeof(float), token_score_cmp);
+        for (size_t k = 1; k < len; k++) {
+            memcpy(buffer, token, k);
+            buffer[k] = '\0';
+            int* a = hash_map_search(t->token_to_id, buffer);
+            int* b = hash_map_search(t->token_to_id, token + k);
+            if (a && b) {
+                token_merge_insert(m, *a, *b, *id, (int) (rank - scores));
+            }
+        }
+    }
+
+    free(buffer);
+    free(scores);
+    return m;
+}
+
+int* token_byte_create(Tokenizer* t) {
+    int* bytes = malloc(256 * sizeof(int));
+    if (!bytes) {
+        return NULL;
+    }
+
+    int* unk = NULL;
+    if (t->special && t->special->unk) {
+        unk = hash_map_search(t->token_to_id, t->special->unk);
+    }
+
+    bytes[0] = -1;  // never part of a C string
+    for (int i = 1; i < 256; i++) {
+        char token[2] = {(char) i, 0};
+        int* id = hash_map_search(t->token_to_id, token);
+        bytes[i] = id ? *id : (unk ? *unk : -1);  // if -1, unk is not mapped!
+    }
+
+    return bytes;
+}
+
+// A byte is a boundary if its symbol is in no merge pair: it stays a single
+// symbol and nothing merges across it, so text can be encoded word by word.
+bool token_boundary_create(TokenMergeTable* m, const int* bytes, int vocab_size) {
+    bool* merges = calloc(vocab_size, sizeof(bool));
+    if (!merges) {
+        return false;
+    }
+
+    for (size_t i = 0; i < m->capacity; i++) {
+        uint64_t key = m->entries[i].key;
+        if (key != TOKEN_MERGE_EMPTY) {
+            merges[key >> 32] = true;
+            merges[key & UINT32_MAX] = true;
+        }
+    }
+
+    for (int i = 0; i < 256; i++) {
+        int id = bytes[i];
+        m->boundary[i] = id < 0 || id >= vocab_size || !merges[id];
+    }
+
+    free(merges);
+    return true;
+}
+
+// Build the encoder lookups of a tokenizer whose maps are populated
+bool token_lookup_create(Tokenizer* t) {
+    static atomic_uint_fast64_t serial = 1;
+
+    t->merges = token_merge_create(t);
+    t->byte_to_id = token_byte_create(t);
+    if (!t->merges || !t->byte_to_id) {
+        return false;
+    }
+
+    TokenMergeTable* m = t->merges;
+    m->serial = atomic_fetch_add(&serial, 1);
+    m->bos = m->eos = -1;
+    if (t->special) {
+        int* bos = t->special->bos ? hash_map_search(t->token_to_id, t->special->bos) : NULL;
+        int* eos = t->special->eos ? hash_map_search(t->token_to_id, t->special->eos) : NULL;
+        m->bos = bos ? *bos : -1;
+        m->eos = eos ? *eos : -1;
+    }
+    return token_boundary_create(m, t->byte_to_id, t->vocab_size);
+}
+
+/** @} */
+
 /**
  * @section Tokenizer clean up
  * @{
@@ -85,6 +336,8 @@ void tokenizer_free(Tokenizer* t) {
         token_score_free(t->scores);
         token_to_id_free(t->token_to_id);
         id_to_token_free(t->id_to_token, t->vocab_size);
+        token_merge_free(t->merges);
+        free(t->byte_to_id);
     }
 }
 
@@ -353,6 +606,11 @@ Tokenizer tokenizer_create(BPEModel* model, SpecialToken* special) {
     token_set_free(vocab);
     token_rank_free(ranks);
 
+    // Integer lookups for encoding
+    bool lookups = token_lookup_create(&t);
+    assert(lookups);
+    (void) lookups;
+
     return t;
 }
 
@@ -538,6 +796,12 @@ Tokenizer tokenizer_load(const char* path) {
     }
 
     fclose(file);
+
+    // Integer lookups for encoding
+    bool lookups = token_lookup_create(&t);
+    assert(lookups);
+    (void) lookups;
+
     return t;
 }
 
@@ -548,124 +812,330 @@ Tokenizer tokenizer_load(const char* path) {
  * @{
  */
 
-int* tokenizer_encode(Tokenizer* t, char* text, int* seq_len, bool add_bos, bool add_eos) {
-    if (!t || !text) {
-        return NULL;  // invalid input
-    }
+/**
+ * @brief Symbol of the encoder's linked list. Merging unlinks the right symbol.
+ */
+typedef struct TokenSymbol {
+    int id;  // token id (-1: unknown byte with no unk token)
+    int prev;  // index of the previous symbol, or -1
+    int next;  // index of the next symbol, or -1
+} TokenSymbol;
 
-    // Count ids
-    *seq_len = 0;
-    size_t id_count = 0;
+/**
+ * @brief Candidate merge of two adjacent symbols.
+ */
+typedef struct TokenMerge {
+    int rank;  // merge rank (lower merges first)
+    int left;  // index of the left symbol
+    int right;  // index of the right symbol
+    int a;  // id of the left symbol when queued
+    int b;  // id of the right symbol when queued
+    int id;  // id of the merged token
+} TokenMerge;
 
-    // Count number of bytes in text
-    size_t text_len = strlen(text);
+/**
+ * @brief Merge queue: a binary min-heap on rank, ties broken by position.
+ */
+typedef struct TokenQueue {
+    TokenMerge* heap;
+    size_t count;
+} TokenQueue;
+
+// Lower ranks first; equal ranks merge leftmost first
+static bool token_merge_before(const TokenMerge* x, const TokenMerge* y) {
+    return x->rank < y->rank || (x->rank == y->rank && x->left < y->left);
+}
 
-    // Allocate space to base ids
-    int* ids = calloc(text_len, sizeof(int));
-    if (!ids) {
-        return NULL;
+static void token_queue_push(TokenQueue* q, TokenMerge m) {
+    size_t i = q->count++;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!token_merge_before(&m, &q->heap[parent])) {
+            break;
+        }
+        q->heap[i] = q->heap[parent];
+        i = parent;
     }
+    q->heap[i] = m;
+}
 
-    // encode input text to ids
-    for (size_t i = 0; i < text_len; i++) {
-        char token[2] = {text[i], 0};
+static TokenMerge token_queue_pop(TokenQueue* q) {
+    TokenMerge top = q->heap[0];
+    TokenMerge last = q->heap[--q->count];
 
-        int* id = hash_map_search(t->token_to_id, token);
-        if (!id) {
-            int* unk_id = NULL;
-            if (t->special && t->special->unk) {
-                unk_id = hash_map_search(t->token_to_id, t->special->unk);
-            }
-            ids[id_count++] = (unk_id) ? *unk_id : -1;  // if -1, unk is not mapped!
-        } else {
-            ids[id_count++] = *id;
+    size_t i = 0;
+    while (true) {
+        size_t child = 2 * i + 1;
+        if (child >= q->count) {
+            break;
+        }
+        if (child + 1 < q->count && token_merge_before(&q->heap[child + 1], &q->heap[child])) {
+            child++;
+        }
+        if (!token_merge_before(&q->heap[child], &last)) {
+            break;
         }
+        q->heap[i] = q->heap[child];
+        i = child;
+    }
+    if (q->count > 0) {
+        q->heap[i] = last;
     }
 
-    // greed merges using scores
-    while (true) {
-        float best_score = -INFINITY;
-        int best_id = -1;
-
-        // scan for best merge pair
-        for (size_t i = 0; i < id_count - 1; i++) {
-            // get ids
-            int id_a = ids[i];  // current
-            int id_b = ids[i + 1];  // next
-
-            // token is unknown and there is no sub
-            if (id_a == -1 || id_b == -1) {
-                continue;
-            }
+    return top;
+}
 
-            // probe for a valid merge pair
-            char* a = t->id_to_token[id_a];
-            char* b = t->id_to_token[id_b];
-            char* merge = string_concat(a, b);
-
-            // probe for a valid score
-            float* score = hash_map_search(t->scores, merge);
-            free(merge);  // clean up
-            if (score && *score > best_score) {
-                best_score = *score;
-                best_id = i;
-            }
+// Queue the pair (left, right) if it merges
+static void token_queue_pair(const TokenMergeTable* m, TokenQueue* q, const TokenSymbol* symbols, int left, int right) {
+    if (left < 0 || right < 0) {
+        return;
+    }
+
+    int a = symbols[left].id;
+    int b = symbols[right].id;
+    if (a == -1 || b == -1) {
+        return;  // token is unknown and there is no sub
+    }
+
+    const TokenMergeEntry* e = token_merge_find(m, a, b);
+    if (e) {
+        token_queue_push(q, (TokenMerge) {e->rank, left, right, a, b, e->id});
+    }
+}
+
+/**
+ * @brief Scratch space of the word encoder, grown to the longest word seen.
+ */
+typedef struct TokenWork {
+    TokenSymbol* symbols;
+    TokenMerge* heap;
+    size_t capacity;  // bytes of the longest word that fits
+} TokenWork;
+
+static bool token_work_reserve(TokenWork* w, size_t len) {
+    if (len <= w->capacity) {
+        return true;
+    }
+
+    // Initial pairs plus at most two new pairs per merge
+    TokenSymbol* symbols = realloc(w->symbols, len * sizeof(TokenSymbol));
+    if (symbols) {
+        w->symbols = symbols;
+    }
+    TokenMerge* heap = realloc(w->heap, 3 * len * sizeof(TokenMerge));
+    if (heap) {
+        w->heap = heap;
+    }
+    if (!symbols || !heap) {
+        return false;
+    }
+
+    w->capacity = len;
+    return true;
+}
+
+// Greedy merges using ranks; only the neighbours of a merge change
+static size_t token_encode_word(Tokenizer* t, TokenWork* w, const char* word, size_t len, int* out) {
+    const TokenMergeTable* m = t->merges;
+    TokenSymbol* symbols = w->symbols;
+    TokenQueue q = {.heap = w->heap};
+
+    // encode input bytes to ids
+    for (size_t i = 0; i < len; i++) {
+        symbols[i].id = t->byte_to_id[(uint8_t) word[i]];
+        symbols[i].prev = (int) i - 1;
+        symbols[i].next = (i + 1 < len) ? (int) i + 1 : -1;
+    }
+
+    // queue every mergeable pair
+    for (size_t i = 0; i + 1 < len; i++) {
+        token_queue_pair(m, &q, symbols, (int) i, (int) i + 1);
+    }
+
+    while (q.count > 0) {
+        TokenMerge next = token_queue_pop(&q);
+
+        TokenSymbol* left = &symbols[next.left];
+        TokenSymbol* right = &symbols[next.right];
+        if (left->next != next.right || left->id != next.a || right->id != next.b) {
+            continue;  // stale: a neighbour merged since this pair was queued
         }
 
-        if (best_id == -1) {
-            break;  // no merges left
+        // merge right into left
+        left->id = next.id;
+        left->next = right->next;
+        if (right->next >= 0) {
+            symbols[right->next].prev = next.left;
         }
+        right->prev = right->next = -1;  // unlinked: pairs queued with it go stale
+
+        token_queue_pair(m, &q, symbols, left->prev, next.left);
+        token_queue_pair(m, &q, symbols, next.left, left->next);
+    }
 
-        // get token ids
-        int id_a = ids[best_id];  // current
-        int id_b = ids[best_id + 1];  // next
+    // walk the surviving symbols
+    size_t count = 0;
+    for (int i = len > 0 ? 0 : -1; i >= 0; i = symbols[i].next) {
+        out[count++] = symbols[i].id;
+    }
+    return count;
+}
 
-        // token is unknown and there is no sub
-        if (id_a == -1 || id_b == -1) {
-            continue;
-        }
+/**
+ * @brief One cached word: its bytes and the ids they encode to.
+ */
+typedef struct TokenCacheSlot {
+    uint64_t hash;  // checksum64 of the word
+    uint64_t serial;  // merge table the ids belong to (0: empty)
+    uint8_t len;  // word length in bytes
+    uint8_t count;  // number of ids
+    char word[TOKENIZER_CACHE_WORD];
+    int ids[TOKENIZER_CACHE_IDS];
+} TokenCacheSlot;
+
+/**
+ * @brief Direct-mapped per-thread encode cache.
+ */
+typedef struct TokenCache {
+    TokenCacheSlot slots[TOKENIZER_CACHE_SLOTS];
+    TokenizerCacheStats stats;
+} TokenCache;
 
-        // merge tokens
-        char* a = t->id_to_token[id_a];  // current
-        char* b = t->id_to_token[id_b];  // next
-        char* merge = string_concat(a, b);  // a + b
+static pthread_key_t token_cache_key;
+static pthread_once_t token_cache_once = PTHREAD_ONCE_INIT;
+static _Thread_local TokenCache* token_cache = NULL;
 
-        // get best merge id
-        int* merge_id = hash_map_search(t->token_to_id, merge);
-        free(merge);  // clean up
-        if (!merge_id) {
-            break;
+static void token_cache_key_create(void) {
+    pthread_key_create(&token_cache_key, free);  // freed on thread exit
+}
+
+// Cache of the calling thread, allocated on first use (NULL if that fails)
+static TokenCache* token_cache_get(void) {
+    if (!token_cache) {
+        pthread_once(&token_cache_once, token_cache_key_create);
+        token_cache = calloc(1, sizeof(TokenCache));
+        if (token_cache) {
+            pthread_setspecific(token_cache_key, token_cache);
         }
+    }
+    return token_cache;
+}
 
-        // update current best merge id
-        ids[best_id] = *merge_id;
-        // remove next best merge id
-        memmove(&ids[best_id + 1], &ids[best_id + 2], (id_count - best_id - 2) * sizeof(int));
-        // update count for removing next merge id
-        id_count--;
+static TokenCacheSlot* token_cache_slot(TokenCache* c, uint64_t hash) {
+    return &c->slots[hash & (TOKENIZER_CACHE_SLOTS - 1)];
+}
+
+static bool token_cache_match(const TokenCacheSlot* slot, uint64_t serial, uint64_t hash, const char* word, size_t len) {
+    return slot->serial == serial && slot->hash == hash && slot->len == len && 0 == memcmp(slot->word, word, len);
+}
+
+// Encode one word, through the cache when it is short enough to be kept
+static size_t token_encode_cached(Tokenizer* t, TokenCache* c, TokenWork* w, const char* word, size_t len, int* out) {
+    const TokenMergeTable* m = t->merges;
+    if (!c || len > TOKENIZER_CACHE_WORD) {
+        return token_encode_word(t, w, word, len, out);
+    }
+
+    uint64_t hash = checksum64(word, len, 0);
+    TokenCacheSlot* slot = token_cache_slot(c, hash);
+    if (token_cache_match(slot, m->serial, hash, word, len)) {
+        memcpy(out, slot->ids, slot->count * sizeof(int));
+        c->stats.hits++;
+        return slot->count;
+    }
+
+    size_t count = token_encode_word(t, w, word, len, out);
+    c->stats.misses++;
+    if (count <= TOKENIZER_CACHE_IDS) {
+        slot->hash = hash;
+        slot->serial = m->serial;
+        slot->len = (uint8_t) len;
+        slot->count = (uint8_t) count;
+        memcpy(slot->word, word, len);
+        memcpy(slot->ids, out, count * sizeof(int));
     }
+    return count;
+}
+
+TokenizerCacheStats tokenizer_cache_stats(void) {
+    return token_cache ? token_cache->stats : (TokenizerCacheStats) {0};
+}
+
+void tokenizer_cache_clear(void) {
+    if (token_cache) {
+        memset(token_cache, 0, sizeof(TokenCache));
+    }
+}
+
+// Encode len bytes of text into out (room for len + 2 ids); SIZE_MAX on failure
+static size_t token_encode_text(Tokenizer* t, TokenWork* w, const char* text, size_t len, bool add_bos, bool add_eos, int* out) {
+    const TokenMergeTable* m = t->merges;
+    TokenCache* cache = token_cache_get();
+    size_t id_count = 0;
 
     // insert special bos if enabled and present
     if (add_bos && t->special && t->special->bos) {
-        int* id = hash_map_search(t->token_to_id, t->special->bos);
-        for (size_t i = id_count; i > 0; --i) {
-            ids[i] = ids[i - 1];  // shift everything upward
+        out[id_count++] = m->bos;
+    }
+
+    // pre-tokenize: boundary bytes stand alone, the words between them are merged
+    size_t i = 0;
+    while (i < len) {
+        if (m->boundary[(uint8_t) text[i]]) {
+            out[id_count++] = t->byte_to_id[(uint8_t) text[i++]];
+            continue;
+        }
+
+        size_t end = i + 1;
+        while (end < len && !m->boundary[(uint8_t) text[end]]) {
+            end++;
+        }
+
+        if (!token_work_reserve(w, end - i)) {
+            return SIZE_MAX;
         }
-        ids[0] = id ? *id : -1;  // add bos
-        id_count++;
+
+        id_count += token_encode_cached(t, cache, w, text + i, end - i, out + id_count);
+        i = end;
     }
 
     // append special eos if enabled and present
     if (add_eos && t->special && t->special->eos) {
-        int* id = hash_map_search(t->token_to_id, t->special->eos);
-        ids[id_count] = id ? *id : -1;
-        id_count++;
+        out[id_count++] = m->eos;
     }
 
-    /// @todo Shrink the id buffer to fit id count.
-    /// Number of ids will always be less than the number of input bytes.
-    if (id_count < text_len) {
-        ids = realloc(ids, id_count * sizeof(int));
+    return id_count;
+}
+
+int* tokenizer_encode(Tokenizer* t, char* text, int* seq_len, bool add_bos, bool add_eos) {
+    if (!t || !t->merges || !t->byte_to_id || !text || !seq_len) {
+        return NULL;  // invalid input
+    }
+
+    *seq_len = 0;
+
+    // Count number of bytes in text
+    size_t text_len = strlen(text);
+
+    // Room for every byte plus bos and eos
+    int* ids = malloc((text_len + 2) * sizeof(int));
+    if (!ids) {
+        return NULL;
+    }
+
+    TokenWork work = {0};
+    size_t id_count = token_encode_text(t, &work, text, text_len, add_bos, add_eos, ids);
+    free(work.symbols);
+    free(work.heap);
+    if (id_count == SIZE_MAX) {
+        free(ids);
+        return NULL;
+    }
+
+    // Shrink the id buffer to fit id count
+    int* fit = realloc(ids, (id_count > 0 ? id_count : 1) * sizeof(int));
+    if (fit) {
+        ids = fit;
     }
 
     // Update final id count
@@ -675,32 +1145,141 @@ int* tokenizer_encode(Tokenizer* t, char* text, int* seq_len, bool add_bos, bool
     return ids;
 }
 
+size_t tokenizer_encode_span(Tokenizer* t, const char* text, size_t len, bool add_bos, bool add_eos, int* ids) {
+    if (!t || !t->merges || !t->byte_to_id || (!text && len > 0) || !ids) {
+        return SIZE_MAX;  // invalid input
+    }
+
+    TokenWork work = {0};
+    size_t id_count = token_encode_text(t, &work, text, len, add_bos, add_eos, ids);
+    free(work.symbols);
+    free(work.heap);
+    return id_count;
+}
+
+size_t tokenizer_boundary(Tokenizer* t, const char* text, size_t len) {
+    const TokenMergeTable* m = t && t->merges ? t->merges : NULL;
+    if (!m || !text) {
+        return 0;
+    }
+
+    while (len > 0 && !m->boundary[(uint8_t) text[len - 1]]) {
+        len--;
+    }
+    return len;
+}
+
+TokenBatch tokenizer_encode_batch(Tokenizer* t, char** texts, size_t n, bool add_bos, bool add_eos) {
+    TokenBatch batch = {0};
+    if (!t || !t->merges || !t->byte_to_id || !texts) {
+        return batch;  // invalid input
+    }
+
+    // Each document gets a slot of its worst case (one id per byte plus bos and eos)
+    size_t* slots = malloc((n + 1) * sizeof(size_t));
+    size_t* offsets = malloc((n + 1) * sizeof(size_t));
+    if (!slots || !offsets) {
+        free(slots);
+        free(offsets);
+        return batch;
+    }
+
+    slots[0] = 0;
+    for (size_t i = 0; i < n; i++) {
+        slots[i + 1] = slots[i] + (texts[i] ? strlen(texts[i]) : 0) + 2;
+    }
+
+    int* ids = malloc((slots[n] > 0 ? slots[n] : 1) * sizeof(int));
+    if (!ids) {
+        free(slots);
+        free(offsets);
+        return batch;
+    }
+
+    // Documents vary in length, so hand them out dynamically
+    bool ok = true;
+#pragma omp parallel reduction(&& : ok)
+    {
+        TokenWork work = {0};
+
+#pragma omp for schedule(dynamic, 16)
+        for (size_t i = 0; i < n; i++) {
+            size_t len = slots[i + 1] - slots[i] - 2;
+            size_t count = texts[i] ? token_encode_text(t, &work, texts[i], len, add_bos, add_eos, ids + slots[i]) : 0;
+            if (count == SIZE_MAX) {
+                ok = false;
+                count = 0;
+            }
+            offsets[i + 1] = count;  // lengths for now
+        }
+
+        free(work.symbols);
+        free(work.heap);
+    }
+
+    if (!ok) {
+        LOG_ERROR("tokenizer_encode_batch: out of memory");
+        free(ids);
+        free(slots);
+        free(offsets);
+        return batch;
+    }
+
+    // Close the gaps between slots, in order, so ids are back to back
+    offsets[0] = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t count = offsets[i + 1];
+        memmove(ids + offsets[i], ids + slots[i], count * sizeof(int));
+        offsets[i + 1] = offsets[i] + count;
+    }
+    free(slots);
+
+    int* fit = realloc(ids, (offsets[n] > 0 ? offsets[n] : 1) * sizeof(int));
+    batch.ids = fit ? fit : ids;
+    batch.offsets = offsets;
+    batch.count = n;
+    return batch;
+}
+
+void tokenizer_batch_free(TokenBatch* batch) {
+    if (batch) {
+        free(batch->ids);
+        free(batch->offsets);
+        *batch = (TokenBatch) {0};
+    }
+}
+
 char* tokenizer_decode(Tokenizer* t, int* ids, size_t seq_len) {
     if (!t || !ids || seq_len == 0) {
         return NULL;
     }
 
-    size_t text_count = 0;
-    char** text = calloc(1, sizeof(char*));
+    // Size the output once instead of growing it per token
+    size_t len = 0;
     for (size_t i = 0; i < seq_len; i++) {
         int id = ids[i];
         if (id < 0 || id >= t->vocab_size) {
             LOG_ERROR("Invalid id at index %zu: %d (seq_len=%zu)", i, id, seq_len);
-            string_split_free(text, text_count);
             return NULL;  // out of bounds!
         }
-
-        char* token = t->id_to_token[id];
-        text = string_append(strdup(token), text, &text_count);
+        len += strlen(t->id_to_token[id]);
     }
 
-    char* result = string_join(text, text_count, "");
-    string_split_free(text, text_count);
+    char* result = malloc(len + 1);
     if (!result) {
         LOG_ERROR("Failed to build decoded text.");
         return NULL;
     }
 
+    char* dst = result;
+    for (size_t i = 0; i < seq_len; i++) {
+        const char* token = t->id_to_token[ids[i]];
+        size_t n = strlen(token);
+        memcpy(dst, token, n);
+        dst += n;
+    }
+    *dst = '\0';
+
     return result;
 }
 
@@ -9,9 +9,20 @@
  * Format and serialization is designed for compact storage and fast loading.
  */
 
+#include <ctype.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdio.h>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <omp.h>
+
+#include "core/checksum.h"
+#include "core/logger.h"
 #include "core/path.h"
 #include "core/strext.h"
 #include "core/map.h"
@@ -254,6 +265,49 @@ char* vocab_read_text(const char* path) {
     return text;
 }
 
+VocabText vocab_text_open(const char* path) {
+    VocabText text = {0};
+
+    int fd = path ? open(path, O_RDONLY) : -1;
+    if (fd < 0) {
+        LOG_ERROR("vocab_text_open: failed to open '%s'", path ? path : "(null)");
+        return text;
+    }
+
+    struct stat st;
+    if (0 != fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        LOG_ERROR("vocab_text_open: '%s' is not a non-empty regular file", path);
+        close(fd);
+        return text;
+    }
+
+    const size_t size = (size_t) st.st_size;
+    void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // the mapping keeps the file open
+    if (MAP_FAILED == map) {
+        LOG_ERROR("vocab_text_open: failed to map '%s'", path);
+        return text;
+    }
+
+    // Read-ahead for one pass; huge pages where the file system supports them
+    madvise(map, size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    madvise(map, size, MADV_HUGEPAGE);
+#endif
+
+    text.data = (const char*) map;
+    text.len = size;
+    return text;
+}
+
+void vocab_text_close(VocabText* text) {
+    if (text && text->data) {
+        munmap((void*) text->data, text->len);
+        text->data = NULL;
+        text->len = 0;
+    }
+}
+
 /** @} */
 
 /**
@@ -261,36 +315,173 @@ char* vocab_read_text(const char* path) {
  * @{
  */
 
+#define VOCAB_CHUNK_MIN (1 << 16)  // fewest bytes of text worth a thread
+
+/**
+ * @brief Word counted in place: a slice of the input text.
+ */
+typedef struct VocabWord {
+    uint64_t hash;  // checksum64 of the word
+    const char* word;  // start in the text (not NUL-terminated), NULL if empty
+    size_t len;
+    int freq;
+} VocabWord;
+
+/**
+ * @brief Open-addressed word counts of one thread.
+ */
+typedef struct VocabCount {
+    VocabWord* slots;
+    size_t capacity;  // power of two
+    size_t count;
+} VocabCount;
+
+static bool vocab_count_grow(VocabCount* c) {
+    size_t capacity = c->capacity ? 2 * c->capacity : 1024;
+    VocabWord* slots = calloc(capacity, sizeof(VocabWord));
+    if (!slots) {
+        return false;
+    }
+
+    for (size_t i = 0; i < c->capacity; i++) {
+        const VocabWord* w = &c->slots[i];
+        if (w->word) {
+            size_t j = w->hash & (capacity - 1);
+            while (slots[j].word) {
+                j = (j + 1) & (capacity - 1);
+            }
+            slots[j] = *w;
+        }
+    }
+
+    free(c->slots);
+    c->slots = slots;
+    c->capacity = capacity;
+    return true;
+}
+
+static bool vocab_count_add(VocabCount* c, uint64_t hash, const char* word, size_t len, int freq) {
+    if (2 * (c->count + 1) > c->capacity && !vocab_count_grow(c)) {
+        return false;
+    }
+
+    size_t i = hash & (c->capacity - 1);
+    while (c->slots[i].word) {
+        VocabWord* w = &c->slots[i];
+        if (w->hash == hash && w->len == len && 0 == memcmp(w->word, word, len)) {
+            w->freq += freq;
+            return true;
+        }
+        i = (i + 1) & (c->capacity - 1);
+    }
+
+    c->slots[i] = (VocabWord) {hash, word, len, freq};
+    c->count++;
+    return true;
+}
+
+// Word separator: whitespace, or a NUL byte inside a span
+static inline bool vocab_is_space(char c) {
+    return '\0' == c || isspace((unsigned char) c);
+}
+
+// Count the whitespace-delimited words of [p, end)
+static bool vocab_count_scan(VocabCount* c, const char* p, const char* end) {
+    while (p < end) {
+        while (p < end && vocab_is_space(*p)) {
+            p++;
+        }
+
+        const char* start = p;
+        while (p < end && !vocab_is_space(*p)) {
+            p++;
+        }
+
+        if (p > start && !vocab_count_add(c, checksum64(start, p - start, 0), start, p - start, 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 // Create the word frequencies
 HashMap* vocab_create_frequencies(const char* text) {
-    // Pre-tokenize the input text
-    size_t pre_token_count = 0;
-    // Split text by whitespace (0x09, 0x0A, 0x0D, 0x20)
-    char** pre_tokens = string_split_space(text, &pre_token_count);
-
-    // Build word frequencies from pre-tokens
-    HashMap* freqs = hash_map_create(pre_token_count, HASH_STR);
-    for (size_t i = 0; i < pre_token_count; i++) {
-        int* value = hash_map_search(freqs, pre_tokens[i]);
-        if (!value) {
-            // Create a new key
-            char* key = strdup(pre_tokens[i]);
-
-            // Create a new value
-            value = malloc(sizeof(int));
-            *value = 1;
-
-            // Insert new mapping
-            hash_map_insert(freqs, key, value);
-        } else {
-            *value += 1;  // update current freq
+    return text ? vocab_create_frequencies_span(text, strlen(text)) : NULL;
+}
+
+HashMap* vocab_create_frequencies_span(const char* text, size_t length) {
+    if (!text) {
+        return NULL;
+    }
+
+    // One chunk per thread, each at least VOCAB_CHUNK_MIN bytes
+    int n_chunks = omp_get_max_threads();
+    if ((size_t) n_chunks > length / VOCAB_CHUNK_MIN) {
+        n_chunks = length / VOCAB_CHUNK_MIN > 0 ? (int) (length / VOCAB_CHUNK_MIN) : 1;
+    }
+
+    VocabCount* counts = calloc(n_chunks, sizeof(VocabCount));
+    size_t* bounds = malloc((n_chunks + 1) * sizeof(size_t));
+    if (!counts || !bounds) {
+        free(counts);
+        free(bounds);
+        return NULL;
+    }
+
+    // Move each cut forward to whitespace, so no word straddles two chunks
+    bounds[0] = 0;
+    for (int t = 1; t < n_chunks; t++) {
+        size_t cut = length / n_chunks * t;
+        cut = cut > bounds[t - 1] ? cut : bounds[t - 1];
+        while (cut < length && !vocab_is_space(text[cut])) {
+            cut++;
+        }
+        bounds[t] = cut;
+    }
+    bounds[n_chunks] = length;
+
+    // Count each chunk in place into its own table
+    bool ok = true;
+#pragma omp parallel for num_threads(n_chunks) schedule(static, 1) reduction(&& : ok)
+    for (int t = 0; t < n_chunks; t++) {
+        ok = vocab_count_scan(&counts[t], text + bounds[t], text + bounds[t + 1]) && ok;
+    }
+
+    // Fold the other tables into the first
+    VocabCount* total = &counts[0];
+    for (int t = 1; ok && t < n_chunks; t++) {
+        for (size_t i = 0; ok && i < counts[t].capacity; i++) {
+            const VocabWord* w = &counts[t].slots[i];
+            ok = !w->word || vocab_count_add(total, w->hash, w->word, w->len, w->freq);
+        }
+    }
+
+    // Copy out the distinct words
+    HashMap* freqs = ok ? hash_map_create(total->count, HASH_STR) : NULL;
+    for (size_t i = 0; freqs && i < total->capacity; i++) {
+        const VocabWord* w = &total->slots[i];
+        if (!w->word) {
+            continue;
         }
+
+        char* key = strndup(w->word, w->len);
+        int* value = malloc(sizeof(int));
+        if (!key || !value || HASH_SUCCESS != hash_map_insert(freqs, key, value)) {
+            free(key);
+            free(value);
+            vocab_map_free(freqs);
+            freqs = NULL;
+            break;
+        }
+        *value = w->freq;
     }
 
-    // Clean up pre-tokens
-    string_split_free(pre_tokens, pre_token_count);
+    for (int t = 0; t < n_chunks; t++) {
+        free(counts[t].slots);
+    }
+    free(counts);
+    free(bounds);
 
-    // Return hash map
     return freqs;  // text : words -> freqs
 }
 
@@ -340,8 +531,12 @@ HashMap* vocab_create_symbols(HashMap* words) {
 
 // Pre-tokenize the vocabulary
 HashMap* vocab_tokenize(const char* text) {
+    return text ? vocab_tokenize_span(text, strlen(text)) : NULL;
+}
+
+HashMap* vocab_tokenize_span(const char* text, size_t len) {
     // Create initial word-freq mapping
-    HashMap* words = vocab_create_frequencies(text);
+    HashMap* words = vocab_create_frequencies_span(text, len);
     if (!words) {
         return NULL;
     }
@@ -362,21 +557,21 @@ HashMap* vocab_tokenize(const char* text) {
 
 // Build the initial vocabulary
 HashMap* vocab_build(const char* path) {
-    // Read the vocab from a plain text file into memory
-    char* text = vocab_read_text(path);
-    if (!text) {
+    // Map the plain text file (words are counted in place)
+    VocabText text = vocab_text_open(path);
+    if (!text.data) {
         return NULL;
     }
 
     // Create the initial sym-freq map
-    HashMap* vocab = vocab_tokenize(text);
+    HashMap* vocab = vocab_tokenize_span(text.data, text.len);
     if (!vocab) {
-        free(text);
+        vocab_text_close(&text);
         return NULL;
     }
 
-    // Clean up plain text
-    free(text);
+    // Unmap plain text
+    vocab_text_close(&text);
 
     // Return a newly
     return vocab;